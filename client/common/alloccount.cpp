@@ -0,0 +1,151 @@
+#include "alloccount.h"
+
+#ifdef CLIENT_COUNT_ALLOCATIONS
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+// Plain TLS in the executable: initial-exec, so touching it never allocates
+thread_local uint64_t tAllocations = 0;
+thread_local int tUncounted = 0;
+
+inline void countAllocation()
+{
+    if (tUncounted == 0) tAllocations++;
+}
+
+// Units per report; the check itself tolerates no allocation at all
+const int kWindowUnits = 250;
+
+} // namespace
+
+#if defined(__GLIBC__)
+
+// Everything (operator new, Qt, libav*) ends up in the malloc family, so
+// counting there catches C and C++ allocations alike
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* ptr);
+
+void* malloc(size_t size)
+{
+    countAllocation();
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size)
+{
+    countAllocation();
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    countAllocation();
+    return __libc_realloc(ptr, size);
+}
+
+void* memalign(size_t alignment, size_t size)
+{
+    countAllocation();
+    return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+    countAllocation();
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size)
+{
+    countAllocation();
+    void* p = __libc_memalign(alignment, size);
+    if (!p) return ENOMEM;
+    *ptr = p;
+    return 0;
+}
+
+void free(void* ptr)
+{
+    __libc_free(ptr);
+}
+}
+
+#else
+
+void* operator new(size_t size)
+{
+    countAllocation();
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+#endif // __GLIBC__
+
+bool allocCountEnabled()
+{
+    return true;
+}
+
+uint64_t allocCountThread()
+{
+    return tAllocations;
+}
+
+UncountedAllocScope::UncountedAllocScope()
+{
+    tUncounted++;
+}
+
+UncountedAllocScope::~UncountedAllocScope()
+{
+    tUncounted--;
+}
+
+SteadyStateAllocCheck::SteadyStateAllocCheck(const char* stage, int warmupUnits)
+    : stage_(stage), warmupUnits_(warmupUnits), units_(0), windowStart_(tAllocations)
+{
+}
+
+void SteadyStateAllocCheck::unitDone()
+{
+    units_++;
+    // The first window starts where warm-up ends, not at thread start
+    if (units_ == warmupUnits_) windowStart_ = tAllocations;
+    if (units_ <= warmupUnits_) return;
+    if ((units_ - warmupUnits_) % kWindowUnits != 0) return;
+
+    const uint64_t allocations = tAllocations - windowStart_;
+    if (allocations > 0) {
+        fprintf(stderr, "Steady-state allocation check failed: stage '%s' made %llu heap allocations "
+                        "in %d units after warm-up\n",
+                stage_, static_cast<unsigned long long>(allocations), kWindowUnits);
+        abort();
+    }
+    windowStart_ = tAllocations;
+}
+
+#endif // CLIENT_COUNT_ALLOCATIONS
@@ -0,0 +1,69 @@
+#ifndef ALLOCCOUNT_H
+#define ALLOCCOUNT_H
+
+#include <stdint.h>
+
+// Heap allocation accounting for the steady-state test build
+// (cmake -DCLIENT_COUNT_ALLOCATIONS=ON). That build interposes the malloc
+// family (glibc) or global operator new (elsewhere) and counts allocations
+// per thread. In normal builds everything here compiles to nothing.
+//
+// Allocations made inside libav* and Qt event delivery are not ours to
+// remove (refcount wrappers around pooled data, queued signal events), so
+// the pipeline excludes those calls with UncountedAllocScope and the check
+// only sees what our own code allocates.
+
+#ifdef CLIENT_COUNT_ALLOCATIONS
+
+bool allocCountEnabled();
+// Allocations made by the calling thread so far
+uint64_t allocCountThread();
+
+class UncountedAllocScope
+{
+public:
+    UncountedAllocScope();
+    ~UncountedAllocScope();
+private:
+    UncountedAllocScope(const UncountedAllocScope&);
+    UncountedAllocScope& operator=(const UncountedAllocScope&);
+};
+
+// Per-stage check, fed once per unit of work (packet, frame, audio chunk).
+// After warm-up any counted allocation aborts, reported per window of
+// units. Expected one-offs (status messages, a reconnect, a new output
+// size) run in an UncountedAllocScope instead of being tolerated here.
+class SteadyStateAllocCheck
+{
+public:
+    SteadyStateAllocCheck(const char* stage, int warmupUnits);
+    void unitDone();
+
+private:
+    const char* stage_;
+    int warmupUnits_;
+    int64_t units_;
+    uint64_t windowStart_;
+};
+
+#else
+
+inline bool allocCountEnabled() { return false; }
+inline uint64_t allocCountThread() { return 0; }
+
+class UncountedAllocScope
+{
+public:
+    UncountedAllocScope() {}
+};
+
+class SteadyStateAllocCheck
+{
+public:
+    SteadyStateAllocCheck(const char*, int) {}
+    void unitDone() {}
+};
+
+#endif // CLIENT_COUNT_ALLOCATIONS
+
+#endif // ALLOCCOUNT_H
@@ -0,0 +1,54 @@
+#include "clientoptions.h"
+
+#include <cstdlib>
+
+ClientOptions::ClientOptions(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.size() > 2 && arg.compare(0, 2, "--") == 0) {
+            std::string::size_type eq = arg.find('=');
+            if (eq == std::string::npos) {
+                values_[arg.substr(2)] = "1";
+            } else {
+                values_[arg.substr(2, eq - 2)] = arg.substr(eq + 1);
+            }
+        } else {
+            positional_.push_back(arg);
+        }
+    }
+}
+
+bool ClientOptions::has(const std::string& key) const
+{
+    return values_.find(key) != values_.end();
+}
+
+std::string ClientOptions::get(const std::string& key, const std::string& fallback) const
+{
+    std::map<std::string, std::string>::const_iterator it = values_.find(key);
+    return it == values_.end() ? fallback : it->second;
+}
+
+int ClientOptions::getInt(const std::string& key, int fallback) const
+{
+    std::map<std::string, std::string>::const_iterator it = values_.find(key);
+    if (it == values_.end() || it->second.empty()) return fallback;
+    char* end = nullptr;
+    long v = std::strtol(it->second.c_str(), &end, 10);
+    return (end && *end == '\0') ? static_cast<int>(v) : fallback;
+}
+
+double ClientOptions::getDouble(const std::string& key, double fallback) const
+{
+    std::map<std::string, std::string>::const_iterator it = values_.find(key);
+    if (it == values_.end() || it->second.empty()) return fallback;
+    char* end = nullptr;
+    double v = std::strtod(it->second.c_str(), &end);
+    return (end && *end == '\0') ? v : fallback;
+}
+
+void ClientOptions::set(const std::string& key, const std::string& value)
+{
+    values_[key] = value;
+}
@@ -0,0 +1,31 @@
+#ifndef CLIENTOPTIONS_H
+#define CLIENTOPTIONS_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Command line options shared by all clients.
+// "--key=value" and bare "--flag" arguments are collected as options;
+// everything else stays positional, in order.
+class ClientOptions
+{
+public:
+    ClientOptions() {}
+    ClientOptions(int argc, char* argv[]);
+
+    const std::vector<std::string>& positional() const { return positional_; }
+
+    bool has(const std::string& key) const;
+    std::string get(const std::string& key, const std::string& fallback = std::string()) const;
+    int getInt(const std::string& key, int fallback) const;
+    double getDouble(const std::string& key, double fallback) const;
+
+    void set(const std::string& key, const std::string& value);
+
+private:
+    std::vector<std::string> positional_;
+    std::map<std::string, std::string> values_;
+};
+
+#endif // CLIENTOPTIONS_H
@@ -0,0 +1,255 @@
+#include "convertbench.h"
+#include "yuvconvert.h"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+namespace {
+
+// swscale and the kernels round differently; anything above this is a bug
+const int kMaxAllowedDiff = 3;
+
+struct Resolution {
+    int width;
+    int height;
+};
+
+// Correctness-only cases: sizes that are not a multiple of the vector width and
+// a crop whose origin and size are both off the SIMD and chroma grid
+struct CheckCase {
+    int width;
+    int height;
+    CropRect crop;
+};
+
+// Smooth chroma and mildly noisy luma, roughly what a camera produces
+void fillSynthetic(AVFrame* frame)
+{
+    const int w = frame->width;
+    const int h = frame->height;
+    unsigned seed = 12345;
+    for (int y = 0; y < h; ++y) {
+        uint8_t* row = frame->data[0] + y * frame->linesize[0];
+        for (int x = 0; x < w; ++x) {
+            seed = seed * 1103515245u + 12345u;
+            row[x] = static_cast<uint8_t>(((x + y) * 255 / (w + h)) ^ ((seed >> 16) & 0x07));
+        }
+    }
+
+    const int cw = (w + 1) / 2;
+    const int ch = (h + 1) / 2;
+    for (int y = 0; y < ch; ++y) {
+        for (int x = 0; x < cw; ++x) {
+            uint8_t u = static_cast<uint8_t>(64 + x * 128 / cw);
+            uint8_t v = static_cast<uint8_t>(64 + y * 128 / ch);
+            if (frame->format == AV_PIX_FMT_NV12) {
+                frame->data[1][y * frame->linesize[1] + 2 * x] = u;
+                frame->data[1][y * frame->linesize[1] + 2 * x + 1] = v;
+            } else {
+                frame->data[1][y * frame->linesize[1] + x] = u;
+                frame->data[2][y * frame->linesize[2] + x] = v;
+            }
+        }
+    }
+}
+
+int maxDiff(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b,
+            int width, int height, int stride, int bpp)
+{
+    int worst = 0;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width * bpp; ++x) {
+            // Alpha is not compared: swscale leaves it alone for RGB32 on some builds
+            if (bpp == 4 && (x & 3) == 3) continue;
+            int d = std::abs(a[y * stride + x] - b[y * stride + x]);
+            if (d > worst) worst = d;
+        }
+    }
+    return worst;
+}
+
+AVFrame* allocSynthetic(AVPixelFormat format, int width, int height)
+{
+    AVFrame* frame = av_frame_alloc();
+    frame->format = format;
+    frame->width = width;
+    frame->height = height;
+    if (av_frame_get_buffer(frame, 32) < 0) {
+        av_frame_free(&frame);
+        return nullptr;
+    }
+    fillSynthetic(frame);
+    return frame;
+}
+
+// Runs `crop` of `frame` through FrameConverter, the path digital zoom takes,
+// and compares it with swscale on the same source window. Returns -1 when the
+// converter did not use the kernels, which would make the comparison meaningless.
+int checkAgainstSwscale(const AVFrame* frame, CropRect crop, AVPixelFormat dst)
+{
+    const AVPixelFormat src = static_cast<AVPixelFormat>(frame->format);
+    const int width = crop.width;
+    const int height = crop.height;
+    const int bpp = dst == AV_PIX_FMT_RGB32 ? 4 : 3;
+    const int stride = FFALIGN(width * bpp, 32);
+    std::vector<uint8_t> reference(stride * height);
+    std::vector<uint8_t> output(stride * height);
+
+    FrameConverter converter;
+    if (!converter.convert(frame, crop, output.data(), stride, width, height, dst) ||
+        !converter.lastUsedSimd() || crop.width != width || crop.height != height) {
+        return -1;
+    }
+
+    // The converter moved the origin onto the chroma grid; read the same window
+    const bool nv12 = src == AV_PIX_FMT_NV12;
+    const uint8_t* srcData[4] = {
+        frame->data[0] + crop.y * frame->linesize[0] + crop.x,
+        frame->data[1] + (crop.y / 2) * frame->linesize[1] + (nv12 ? crop.x : crop.x / 2),
+        nv12 ? nullptr : frame->data[2] + (crop.y / 2) * frame->linesize[2] + crop.x / 2,
+        nullptr
+    };
+    SwsContext* sws = sws_getContext(width, height, src, width, height, dst,
+                                     SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!sws) return -1;
+    uint8_t* refData[4] = { reference.data(), nullptr, nullptr, nullptr };
+    int refStride[4] = { stride, 0, 0, 0 };
+    sws_scale(sws, srcData, frame->linesize, 0, height, refData, refStride);
+    sws_freeContext(sws);
+
+    return maxDiff(reference, output, width, height, stride, bpp);
+}
+
+template <typename Fn>
+double msPerFrame(Fn convertOnce, int iterations)
+{
+    convertOnce();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        convertOnce();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+}
+
+} // namespace
+
+int runConvertBenchmark()
+{
+    const AVPixelFormat srcFormats[] = { AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUVJ420P, AV_PIX_FMT_NV12 };
+    const AVPixelFormat dstFormats[] = { AV_PIX_FMT_RGB24, AV_PIX_FMT_BGR24, AV_PIX_FMT_RGB32 };
+    const Resolution resolutions[] = { {640, 360}, {1280, 720}, {1920, 1080}, {3840, 2160} };
+
+    const YuvSimdLevel detected = yuvSimdDetect();
+    std::cout << "CPU SIMD level: " << yuvSimdLevelName(detected) << std::endl;
+    if (detected == YUV_SIMD_NONE) {
+        std::cout << "No SIMD kernels on this CPU, every conversion uses swscale" << std::endl;
+        return 0;
+    }
+
+    std::cout << std::left << std::setw(10) << "src" << std::setw(8) << "dst"
+              << std::setw(11) << "size" << std::setw(8) << "level"
+              << std::setw(12) << "sws ms" << std::setw(12) << "simd ms"
+              << std::setw(10) << "speedup" << "maxdiff" << std::endl;
+
+    int failures = 0;
+    for (AVPixelFormat src : srcFormats) {
+        for (AVPixelFormat dst : dstFormats) {
+            for (const Resolution& res : resolutions) {
+                AVFrame* frame = allocSynthetic(src, res.width, res.height);
+                if (!frame) continue;
+
+                const int bpp = dst == AV_PIX_FMT_RGB32 ? 4 : 3;
+                const int stride = FFALIGN(res.width * bpp, 32);
+                std::vector<uint8_t> reference(stride * res.height);
+                std::vector<uint8_t> output(stride * res.height);
+
+                SwsContext* sws = sws_getContext(res.width, res.height, src, res.width, res.height, dst,
+                                                 SWS_BILINEAR, nullptr, nullptr, nullptr);
+                uint8_t* refData[4] = { reference.data(), nullptr, nullptr, nullptr };
+                int refStride[4] = { stride, 0, 0, 0 };
+                const int iterations = res.width >= 3840 ? 10 : 40;
+
+                double swsMs = msPerFrame([&]() {
+                    sws_scale(sws, frame->data, frame->linesize, 0, res.height, refData, refStride);
+                }, iterations);
+                sws_freeContext(sws);
+
+                for (int level = YUV_SIMD_SSE41; level <= detected; ++level) {
+                    yuvSetSimdLevel(static_cast<YuvSimdLevel>(level));
+                    double simdMs = msPerFrame([&]() {
+                        yuvSimdConvert(frame->data, frame->linesize, src, res.width, res.height,
+                                       output.data(), stride, dst);
+                    }, iterations);
+
+                    int diff = maxDiff(reference, output, res.width, res.height, stride, bpp);
+                    if (diff > kMaxAllowedDiff) failures++;
+
+                    std::cout << std::left << std::setw(10) << av_get_pix_fmt_name(src)
+                              << std::setw(8) << av_get_pix_fmt_name(dst)
+                              << std::setw(11) << (std::to_string(res.width) + "x" + std::to_string(res.height))
+                              << std::setw(8) << yuvSimdLevelName(static_cast<YuvSimdLevel>(level))
+                              << std::fixed << std::setprecision(3)
+                              << std::setw(12) << swsMs << std::setw(12) << simdMs
+                              << std::setprecision(2) << std::setw(10) << (simdMs > 0 ? swsMs / simdMs : 0.0)
+                              << diff << (diff > kMaxAllowedDiff ? "  FAIL" : "") << std::endl;
+                }
+                yuvSetSimdLevel(detected);
+                av_frame_free(&frame);
+            }
+        }
+    }
+
+    const CheckCase checks[] = {
+        { 1366, 767, { 0, 0, 1366, 767 } },
+        { 33, 17, { 0, 0, 33, 17 } },
+        { 1920, 1080, { 333, 201, 1001, 555 } },
+    };
+
+    std::cout << std::endl << std::left << std::setw(10) << "src" << std::setw(8) << "dst"
+              << std::setw(11) << "size" << std::setw(22) << "crop"
+              << std::setw(8) << "level" << "maxdiff" << std::endl;
+
+    for (AVPixelFormat src : srcFormats) {
+        for (AVPixelFormat dst : dstFormats) {
+            for (const CheckCase& check : checks) {
+                AVFrame* frame = allocSynthetic(src, check.width, check.height);
+                if (!frame) {
+                    failures++;
+                    continue;
+                }
+                const CropRect& crop = check.crop;
+                for (int level = YUV_SIMD_SSE41; level <= detected; ++level) {
+                    yuvSetSimdLevel(static_cast<YuvSimdLevel>(level));
+                    int diff = checkAgainstSwscale(frame, crop, dst);
+                    const bool failed = diff < 0 || diff > kMaxAllowedDiff;
+                    if (failed) failures++;
+
+                    std::cout << std::left << std::setw(10) << av_get_pix_fmt_name(src)
+                              << std::setw(8) << av_get_pix_fmt_name(dst)
+                              << std::setw(11) << (std::to_string(check.width) + "x" + std::to_string(check.height))
+                              << std::setw(22) << (std::to_string(crop.width) + "x" + std::to_string(crop.height) +
+                                                   "+" + std::to_string(crop.x) + "+" + std::to_string(crop.y))
+                              << std::setw(8) << yuvSimdLevelName(static_cast<YuvSimdLevel>(level))
+                              << (diff < 0 ? std::string("swscale path") : std::to_string(diff))
+                              << (failed ? "  FAIL" : "") << std::endl;
+                }
+                yuvSetSimdLevel(detected);
+                av_frame_free(&frame);
+            }
+        }
+    }
+
+    std::cout << (failures ? "FAILED: " : "OK: ") << failures
+              << " kernel/format combinations outside tolerance " << kMaxAllowedDiff << std::endl;
+    return failures ? 1 : 0;
+}
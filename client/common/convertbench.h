@@ -0,0 +1,9 @@
+#ifndef CONVERTBENCH_H
+#define CONVERTBENCH_H
+
+// Checks the SIMD YUV->RGB kernels against swscale on synthetic frames and
+// prints the speed-up per source format, destination format and resolution.
+// Returns 0 when every kernel stays within tolerance of swscale.
+int runConvertBenchmark();
+
+#endif // CONVERTBENCH_H
@@ -0,0 +1,299 @@
+#include "decodebench.h"
+#include "decoderselect.h"
+#include "decoderthreading.h"
+#include "clientoptions.h"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <ctime>
+#include <algorithm>
+#include <vector>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavutil/opt.h>
+#include <libswscale/swscale.h>
+}
+
+namespace {
+
+// Real-time encoders per codec, the first one the build has is used
+struct BenchCodec {
+    AVCodecID id;
+    std::vector<const char*> encoders;
+};
+
+// One encoded version of the source
+struct Encoding {
+    AVCodecID id;
+    const AVCodec* encoder = nullptr;
+    AVCodecContext* ctx = nullptr;
+    std::vector<AVPacket*> packets;
+    int64_t bytes = 0;
+};
+
+// Settings close to what a camera or the Qt client's publisher would use:
+// fastest preset, no lookahead, no B-frames
+void tuneEncoder(AVCodecContext* ctx, const AVCodec* encoder)
+{
+    const std::string name = encoder->name;
+    if (name == "libx264" || name == "libx265") {
+        av_opt_set(ctx->priv_data, "preset", "ultrafast", 0);
+        av_opt_set(ctx->priv_data, "tune", "zerolatency", 0);
+    } else if (name == "libsvtav1") {
+        av_opt_set(ctx->priv_data, "preset", "12", 0);
+    } else if (name == "librav1e") {
+        av_opt_set(ctx->priv_data, "speed", "10", 0);
+    } else if (name == "libaom-av1") {
+        av_opt_set(ctx->priv_data, "usage", "realtime", 0);
+        av_opt_set(ctx->priv_data, "cpu-used", "8", 0);
+    }
+}
+
+bool openEncoder(Encoding& enc, int width, int height, AVRational frameRate, int kbps)
+{
+    enc.ctx = avcodec_alloc_context3(enc.encoder);
+    enc.ctx->width = width;
+    enc.ctx->height = height;
+    enc.ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+    enc.ctx->time_base = av_inv_q(frameRate);
+    enc.ctx->framerate = frameRate;
+    enc.ctx->bit_rate = static_cast<int64_t>(kbps) * 1000;
+    enc.ctx->gop_size = 2 * frameRate.num / std::max(1, frameRate.den);
+    enc.ctx->max_b_frames = 0;
+    // Extradata out of band, so every decoder gets the parameter sets up front
+    enc.ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    tuneEncoder(enc.ctx, enc.encoder);
+    return avcodec_open2(enc.ctx, enc.encoder, nullptr) >= 0;
+}
+
+void drainEncoder(Encoding& enc)
+{
+    AVPacket* packet = av_packet_alloc();
+    while (avcodec_receive_packet(enc.ctx, packet) >= 0) {
+        enc.bytes += packet->size;
+        enc.packets.push_back(packet);
+        packet = av_packet_alloc();
+    }
+    av_packet_free(&packet);
+}
+
+struct DecodeResult {
+    bool ok = false;
+    std::string threading;
+    int64_t frames = 0;
+    double wallMs = 0.0;
+    double cpuMs = 0.0;
+    int maxDelay = 0;   // packets in, frames not yet out
+};
+
+DecodeResult decodeAll(const Encoding& enc, const AVCodec* decoder, const DecoderThreadingPolicy& threading)
+{
+    DecodeResult result;
+    AVCodecParameters* par = avcodec_parameters_alloc();
+    avcodec_parameters_from_context(par, enc.ctx);
+    AVCodecContext* ctx = avcodec_alloc_context3(decoder);
+    avcodec_parameters_to_context(ctx, par);
+    avcodec_parameters_free(&par);
+    applyDecoderThreading(ctx, threading);
+    applyCodecLowLatency(ctx);
+    if (avcodec_open2(ctx, decoder, nullptr) < 0) {
+        avcodec_free_context(&ctx);
+        return result;
+    }
+    result.threading = describeDecoderThreading(ctx);
+
+    AVFrame* frame = av_frame_alloc();
+    int64_t sent = 0;
+    bool failed = false;
+    const std::clock_t cpuStart = std::clock();
+    const auto wallStart = std::chrono::steady_clock::now();
+    for (size_t i = 0; i <= enc.packets.size() && !failed; ++i) {
+        // The last round flushes
+        if (avcodec_send_packet(ctx, i < enc.packets.size() ? enc.packets[i] : nullptr) < 0) {
+            failed = true;
+            break;
+        }
+        if (i < enc.packets.size()) sent++;
+        int ret;
+        while ((ret = avcodec_receive_frame(ctx, frame)) >= 0) {
+            result.frames++;
+            av_frame_unref(frame);
+        }
+        if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) failed = true;
+        if (i < enc.packets.size()) {
+            result.maxDelay = std::max(result.maxDelay, static_cast<int>(sent - result.frames));
+        }
+    }
+    const auto wallEnd = std::chrono::steady_clock::now();
+    const std::clock_t cpuEnd = std::clock();
+
+    av_frame_free(&frame);
+    avcodec_free_context(&ctx);
+    if (failed || result.frames == 0) return result;
+
+    result.ok = true;
+    result.wallMs = std::chrono::duration<double, std::milli>(wallEnd - wallStart).count() / result.frames;
+    result.cpuMs = 1000.0 * (cpuEnd - cpuStart) / CLOCKS_PER_SEC / result.frames;
+    return result;
+}
+
+} // namespace
+
+int runDecodeBenchmark(const std::string& path, const ClientOptions& options)
+{
+    const int maxFrames = std::max(1, options.getInt("bench-frames", 250));
+    const int kbps = std::max(50, options.getInt("bench-bitrate", 1000));
+    const DecoderThreadingPolicy threading = decoderThreadingFromOptions(options);
+    const DecoderSelection selection = decoderSelectionFromOptions(options);
+
+    AVFormatContext* fmt = nullptr;
+    if (avformat_open_input(&fmt, path.c_str(), nullptr, nullptr) < 0 ||
+        avformat_find_stream_info(fmt, nullptr) < 0) {
+        std::cerr << "Cannot read " << path << std::endl;
+        if (fmt) avformat_close_input(&fmt);
+        return 1;
+    }
+    const int streamIndex = av_find_best_stream(fmt, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    if (streamIndex < 0) {
+        std::cerr << "No video stream in " << path << std::endl;
+        avformat_close_input(&fmt);
+        return 1;
+    }
+    AVStream* stream = fmt->streams[streamIndex];
+    const AVCodec* sourceDecoder = selectDecoder(stream->codecpar->codec_id, selection);
+    AVCodecContext* source = sourceDecoder ? avcodec_alloc_context3(sourceDecoder) : nullptr;
+    if (!source || avcodec_parameters_to_context(source, stream->codecpar) < 0 ||
+        avcodec_open2(source, sourceDecoder, nullptr) < 0) {
+        std::cerr << "Cannot decode " << path << std::endl;
+        avcodec_free_context(&source);
+        avformat_close_input(&fmt);
+        return 1;
+    }
+
+    // 4:2:0 needs even dimensions
+    const int width = source->width & ~1;
+    const int height = source->height & ~1;
+    AVRational frameRate = stream->avg_frame_rate;
+    if (frameRate.num <= 0 || frameRate.den <= 0) frameRate = AVRational{25, 1};
+
+    const BenchCodec codecs[] = {
+        { AV_CODEC_ID_H264, { "libx264" } },
+        { AV_CODEC_ID_HEVC, { "libx265" } },
+        { AV_CODEC_ID_AV1, { "libsvtav1", "librav1e", "libaom-av1" } },
+    };
+    std::vector<Encoding> encodings;
+    for (const BenchCodec& codec : codecs) {
+        Encoding enc;
+        enc.id = codec.id;
+        for (const char* name : codec.encoders) {
+            enc.encoder = avcodec_find_encoder_by_name(name);
+            if (enc.encoder && openEncoder(enc, width, height, frameRate, kbps)) break;
+            avcodec_free_context(&enc.ctx);
+            enc.encoder = nullptr;
+        }
+        if (enc.encoder) {
+            encodings.push_back(enc);
+        } else {
+            std::cout << avcodec_get_name(codec.id) << ": no real-time encoder in this build, skipped" << std::endl;
+        }
+    }
+    if (encodings.empty()) {
+        avcodec_free_context(&source);
+        avformat_close_input(&fmt);
+        return 1;
+    }
+
+    // Decode the source once and feed every encoder the same frames
+    std::cout << "Encoding " << maxFrames << " frames of " << path << " (" << width << "x" << height
+              << ") at " << kbps << " kbps..." << std::endl;
+    SwsContext* sws = nullptr;
+    AVFrame* decoded = av_frame_alloc();
+    AVFrame* yuv = av_frame_alloc();
+    yuv->format = AV_PIX_FMT_YUV420P;
+    yuv->width = width;
+    yuv->height = height;
+    av_frame_get_buffer(yuv, 32);
+    AVPacket* packet = av_packet_alloc();
+    int64_t encoded = 0;
+    bool flushing = false;
+    while (encoded < maxFrames) {
+        if (!flushing) {
+            if (av_read_frame(fmt, packet) < 0) {
+                flushing = true;
+                avcodec_send_packet(source, nullptr);
+            } else {
+                if (packet->stream_index == streamIndex) avcodec_send_packet(source, packet);
+                av_packet_unref(packet);
+            }
+        }
+        int ret = 0;
+        while (encoded < maxFrames && (ret = avcodec_receive_frame(source, decoded)) >= 0) {
+            sws = sws_getCachedContext(sws, decoded->width, decoded->height,
+                                       static_cast<AVPixelFormat>(decoded->format),
+                                       width, height, AV_PIX_FMT_YUV420P, SWS_BILINEAR,
+                                       nullptr, nullptr, nullptr);
+            av_frame_make_writable(yuv);
+            sws_scale(sws, decoded->data, decoded->linesize, 0, decoded->height, yuv->data, yuv->linesize);
+            yuv->pts = encoded++;
+            for (size_t i = 0; i < encodings.size(); ++i) {
+                avcodec_send_frame(encodings[i].ctx, yuv);
+                drainEncoder(encodings[i]);
+            }
+            av_frame_unref(decoded);
+        }
+        if (flushing && ret == AVERROR_EOF) break;
+    }
+    for (size_t i = 0; i < encodings.size(); ++i) {
+        avcodec_send_frame(encodings[i].ctx, nullptr);
+        drainEncoder(encodings[i]);
+    }
+    av_packet_free(&packet);
+    av_frame_free(&yuv);
+    av_frame_free(&decoded);
+    sws_freeContext(sws);
+    avcodec_free_context(&source);
+    avformat_close_input(&fmt);
+    if (encoded == 0) {
+        std::cerr << "No frames decoded from " << path << std::endl;
+        for (size_t i = 0; i < encodings.size(); ++i) avcodec_free_context(&encodings[i].ctx);
+        return 1;
+    }
+
+    const double seconds = encoded * av_q2d(av_inv_q(frameRate));
+    std::cout << "Decoder threading: " << decoderThreadingModeName(threading.mode)
+              << ", * = decoder the clients select" << std::endl;
+    std::cout << std::left << std::setw(7) << "codec" << std::setw(13) << "encoder"
+              << std::setw(8) << "kbps" << std::setw(14) << "decoder"
+              << std::setw(34) << "threading" << std::setw(10) << "wall ms"
+              << std::setw(10) << "cpu ms" << std::setw(10) << "max fps" << "held" << std::endl;
+
+    for (size_t i = 0; i < encodings.size(); ++i) {
+        const Encoding& enc = encodings[i];
+        const AVCodec* selected = selectDecoder(enc.id, selection);
+        const std::vector<const AVCodec*> decoders = softwareDecoders(enc.id, selection);
+        const double actualKbps = enc.bytes * 8 / 1000.0 / seconds;
+        for (const AVCodec* decoder : decoders) {
+            const DecodeResult r = decodeAll(enc, decoder, threading);
+            std::cout << std::left << std::setw(7) << avcodec_get_name(enc.id)
+                      << std::setw(13) << enc.encoder->name
+                      << std::fixed << std::setprecision(0) << std::setw(8) << actualKbps
+                      << std::setw(14) << (std::string(decoder == selected ? "*" : " ") + decoder->name);
+            if (!r.ok) {
+                std::cout << "failed to decode" << std::endl;
+                continue;
+            }
+            std::cout << std::setw(34) << r.threading << std::setprecision(3)
+                      << std::setw(10) << r.wallMs << std::setw(10) << r.cpuMs
+                      << std::setprecision(0) << std::setw(10) << (r.wallMs > 0 ? 1000.0 / r.wallMs : 0.0)
+                      << r.maxDelay << std::endl;
+        }
+    }
+
+    for (size_t i = 0; i < encodings.size(); ++i) {
+        for (size_t j = 0; j < encodings[i].packets.size(); ++j) av_packet_free(&encodings[i].packets[j]);
+        avcodec_free_context(&encodings[i].ctx);
+    }
+    return 0;
+}
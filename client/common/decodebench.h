@@ -0,0 +1,19 @@
+#ifndef DECODEBENCH_H
+#define DECODEBENCH_H
+
+#include <string>
+
+class ClientOptions;
+
+// Encodes the first frames of a media file to H.264, HEVC and AV1 with the
+// real-time encoders this FFmpeg build has, at the same bitrate, then
+// decodes each result with every software decoder for that codec and
+// prints wall and CPU time per frame, frames held back and the bitrate.
+//
+// --bench-frames=N (default 250) and --bench-bitrate=kbps (default 1000,
+// what the Qt client publishes at); decoder threading and the
+// --decoder-<codec> preferences apply as in the clients.
+// Returns 0 when the file could be read and at least one codec ran.
+int runDecodeBenchmark(const std::string& path, const ClientOptions& options);
+
+#endif // DECODEBENCH_H
@@ -0,0 +1,100 @@
+#include "decodedegrade.h"
+
+#include <algorithm>
+
+namespace {
+
+// Behind: the packet backlog holds more than this share of the queue, or a
+// frame costs nearly its whole display interval
+const double kBacklogShare = 0.25;
+const double kOverloadCost = 0.9;
+// Headroom: the queue is (almost) empty and frames cost at most half their
+// interval at the current level, which leaves room for the next level up
+const int kIdleDepth = 2;
+const double kIdleCost = 0.5;
+
+const int64_t kStepDownUs = 300000;
+const int64_t kStepUpUs = 3000000;
+const int64_t kMaxStepUpUs = 30000000;
+const double kEwmaWeight = 0.1;
+
+} // namespace
+
+const char* degradeLevelName(DegradeLevel level)
+{
+    switch (level) {
+    case DEGRADE_NONE: return "full";
+    case DEGRADE_SKIP_LOOP_FILTER: return "no deblock";
+    case DEGRADE_SKIP_IDCT: return "no idct";
+    case DEGRADE_SKIP_NONREF: return "ref frames";
+    case DEGRADE_KEYFRAMES_ONLY: return "keyframes";
+    default: return "?";
+    }
+}
+
+void applyDegradeLevel(AVCodecContext* ctx, DegradeLevel level)
+{
+    ctx->skip_loop_filter = level >= DEGRADE_SKIP_LOOP_FILTER ? AVDISCARD_ALL : AVDISCARD_DEFAULT;
+    ctx->skip_idct = level >= DEGRADE_SKIP_IDCT ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+    if (level >= DEGRADE_KEYFRAMES_ONLY) {
+        ctx->skip_frame = AVDISCARD_NONKEY;
+    } else if (level >= DEGRADE_SKIP_NONREF) {
+        ctx->skip_frame = AVDISCARD_NONREF;
+    } else {
+        ctx->skip_frame = AVDISCARD_DEFAULT;
+    }
+}
+
+DecodeDegrader::DecodeDegrader()
+{
+    reset();
+}
+
+void DecodeDegrader::reset()
+{
+    level_ = DEGRADE_NONE;
+    avgDecodeMs_ = 0.0;
+    overloadedSinceUs_ = -1;
+    idleSinceUs_ = -1;
+    upHoldUs_ = kStepUpUs;
+    lastChangeWasUp_ = false;
+}
+
+bool DecodeDegrader::update(int queueDepth, int queueCapacity, double decodeMs, double frameIntervalMs, int64_t nowUs)
+{
+    avgDecodeMs_ = avgDecodeMs_ > 0 ? avgDecodeMs_ + kEwmaWeight * (decodeMs - avgDecodeMs_) : decodeMs;
+    if (frameIntervalMs <= 0) frameIntervalMs = 40.0;
+
+    const bool backlog = queueDepth > queueCapacity * kBacklogShare;
+    const bool overloaded = backlog || avgDecodeMs_ > frameIntervalMs * kOverloadCost;
+    const bool idle = queueDepth <= kIdleDepth && avgDecodeMs_ < frameIntervalMs * kIdleCost;
+
+    if (!overloaded) {
+        overloadedSinceUs_ = -1;
+    } else if (overloadedSinceUs_ < 0) {
+        overloadedSinceUs_ = nowUs;
+    }
+    if (!idle) {
+        idleSinceUs_ = -1;
+    } else if (idleSinceUs_ < 0) {
+        idleSinceUs_ = nowUs;
+    }
+
+    if (overloadedSinceUs_ >= 0 && nowUs - overloadedSinceUs_ >= kStepDownUs && level_ < DEGRADE_KEYFRAMES_ONLY) {
+        // Stepping up just now was premature: wait longer before the next try
+        if (lastChangeWasUp_) upHoldUs_ = std::min(upHoldUs_ * 2, kMaxStepUpUs);
+        level_ = static_cast<DegradeLevel>(level_ + 1);
+        lastChangeWasUp_ = false;
+    } else if (idleSinceUs_ >= 0 && nowUs - idleSinceUs_ >= upHoldUs_ && level_ > DEGRADE_NONE) {
+        level_ = static_cast<DegradeLevel>(level_ - 1);
+        lastChangeWasUp_ = true;
+    } else {
+        return false;
+    }
+
+    overloadedSinceUs_ = -1;
+    idleSinceUs_ = -1;
+    // The cost average describes the old level; start over
+    avgDecodeMs_ = 0.0;
+    return true;
+}
@@ -0,0 +1,53 @@
+#ifndef DECODEDEGRADE_H
+#define DECODEDEGRADE_H
+
+#include <stdint.h>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+// Steps of decode quality traded for speed, cheapest last
+enum DegradeLevel {
+    DEGRADE_NONE = 0,
+    DEGRADE_SKIP_LOOP_FILTER,   // no deblocking: blockier, ~20-30% cheaper
+    DEGRADE_SKIP_IDCT,          // + no IDCT on non-reference frames
+    DEGRADE_SKIP_NONREF,        // + drop non-reference frames entirely
+    DEGRADE_KEYFRAMES_ONLY,     // only decode keyframes
+    DEGRADE_LEVEL_COUNT
+};
+
+const char* degradeLevelName(DegradeLevel level);
+
+// Sets skip_loop_filter / skip_idct / skip_frame for a level. Safe on an
+// open decoder: libavcodec reads these per frame (and forwards them to the
+// frame-threading workers).
+void applyDegradeLevel(AVCodecContext* ctx, DegradeLevel level);
+
+// Load-aware controller for a decode stage. Fed once per decoded frame with
+// the backlog in front of the decoder and what the frame cost; steps down a
+// level quickly when the decoder falls behind real time and back up slowly
+// once there is clear headroom. Both holds are wall time, not frame counts:
+// at the lower levels only a few frames per GOP are decoded at all.
+class DecodeDegrader
+{
+public:
+    DecodeDegrader();
+
+    // Returns true when the level changed; the caller then applies it.
+    // nowUs is av_gettime_relative() when the frame was decoded.
+    bool update(int queueDepth, int queueCapacity, double decodeMs, double frameIntervalMs, int64_t nowUs);
+    void reset();
+
+    DegradeLevel level() const { return level_; }
+
+private:
+    DegradeLevel level_;
+    double avgDecodeMs_;   // EWMA
+    int64_t overloadedSinceUs_;   // -1 while not overloaded
+    int64_t idleSinceUs_;         // -1 while there is no headroom
+    int64_t upHoldUs_;            // grows each time a step up had to be undone
+    bool lastChangeWasUp_;
+};
+
+#endif // DECODEDEGRADE_H
@@ -0,0 +1,133 @@
+#include "decoderselect.h"
+#include "clientoptions.h"
+
+#include <cstdio>
+#include <cstring>
+
+extern "C" {
+#include <libavutil/opt.h>
+}
+
+namespace {
+
+// Codecs that take a --decoder-<name> override
+const char* const kConfigurableCodecs[] = { "h264", "hevc", "av1", "vp9" };
+
+// Fastest software decoder first. FFmpeg's own "av1" decoder only works
+// with a hardware accelerator, so AV1 relies on the library wrappers:
+// libdav1d is several times faster than libaom at the same output.
+std::vector<std::string> builtinPreference(AVCodecID id)
+{
+    switch (id) {
+    case AV_CODEC_ID_H264: return { "h264" };
+    case AV_CODEC_ID_HEVC: return { "hevc" };
+    case AV_CODEC_ID_AV1: return { "libdav1d", "libaom-av1" };
+    case AV_CODEC_ID_VP9: return { "vp9", "libvpx-vp9" };
+    default: return std::vector<std::string>();
+    }
+}
+
+bool isHardware(const AVCodec* codec)
+{
+    return (codec->capabilities & AV_CODEC_CAP_HARDWARE) != 0;
+}
+
+// FFmpeg's native AV1 decoder is registered as software but fails every
+// frame unless a hardware accelerator is attached
+bool needsHwaccel(const AVCodec* codec)
+{
+    return codec->id == AV_CODEC_ID_AV1 && strcmp(codec->name, "av1") == 0;
+}
+
+void addUnique(std::vector<const AVCodec*>& list, const AVCodec* codec)
+{
+    for (size_t i = 0; i < list.size(); ++i) {
+        if (list[i] == codec) return;
+    }
+    list.push_back(codec);
+}
+
+// A named decoder, if this build has it and it decodes the codec
+const AVCodec* findNamed(const std::string& name, AVCodecID id)
+{
+    const AVCodec* codec = avcodec_find_decoder_by_name(name.c_str());
+    return codec && codec->id == id ? codec : nullptr;
+}
+
+} // namespace
+
+DecoderSelection decoderSelectionFromOptions(const ClientOptions& options)
+{
+    DecoderSelection selection;
+    for (const char* codec : kConfigurableCodecs) {
+        const std::string value = options.get(std::string("decoder-") + codec);
+        std::vector<std::string> names;
+        size_t start = 0;
+        while (start <= value.size()) {
+            size_t end = value.find(',', start);
+            if (end == std::string::npos) end = value.size();
+            if (end > start) names.push_back(value.substr(start, end - start));
+            start = end + 1;
+        }
+        if (!names.empty()) selection.preferred[codec] = names;
+    }
+    return selection;
+}
+
+std::vector<const AVCodec*> softwareDecoders(AVCodecID id, const DecoderSelection& selection)
+{
+    std::vector<const AVCodec*> list;
+
+    // Configured names may also be hardware wrappers: whoever set them asked for it
+    std::map<std::string, std::vector<std::string> >::const_iterator configured =
+        selection.preferred.find(avcodec_get_name(id));
+    if (configured != selection.preferred.end()) {
+        for (size_t i = 0; i < configured->second.size(); ++i) {
+            const AVCodec* codec = findNamed(configured->second[i], id);
+            if (codec) {
+                addUnique(list, codec);
+            } else {
+                fprintf(stderr, "Decoder '%s' is not available for %s in this FFmpeg build\n",
+                        configured->second[i].c_str(), avcodec_get_name(id));
+            }
+        }
+    }
+
+    const std::vector<std::string> builtin = builtinPreference(id);
+    for (size_t i = 0; i < builtin.size(); ++i) {
+        const AVCodec* codec = findNamed(builtin[i], id);
+        if (codec) addUnique(list, codec);
+    }
+
+    // Anything else the build registered, in registration order
+    void* opaque = nullptr;
+    while (const AVCodec* codec = av_codec_iterate(&opaque)) {
+        if (codec->id == id && av_codec_is_decoder(codec) && !isHardware(codec) && !needsHwaccel(codec)) {
+            addUnique(list, codec);
+        }
+    }
+    return list;
+}
+
+const AVCodec* selectDecoder(AVCodecID id, const DecoderSelection& selection)
+{
+    const std::vector<const AVCodec*> candidates = softwareDecoders(id, selection);
+    if (!candidates.empty()) return candidates.front();
+    const AVCodec* codec = avcodec_find_decoder(id);
+    return codec && !needsHwaccel(codec) ? codec : nullptr;
+}
+
+void applyCodecLowLatency(AVCodecContext* ctx)
+{
+    if (!ctx->codec || !ctx->priv_data) return;
+    const bool lowDelay = (ctx->flags & AV_CODEC_FLAG_LOW_DELAY) != 0;
+
+    if (strcmp(ctx->codec->name, "libdav1d") == 0 && lowDelay) {
+        // dav1d pipelines several frames across its threads by default;
+        // with one frame in flight the threads split tiles and loop
+        // filtering of that frame instead. Older wrappers call it framethreads.
+        if (av_opt_set_int(ctx->priv_data, "max_frame_delay", 1, 0) < 0) {
+            av_opt_set_int(ctx->priv_data, "framethreads", 1, 0);
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef DECODERSELECT_H
+#define DECODERSELECT_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+class ClientOptions;
+
+// Which software decoder handles each codec.
+//
+// avcodec_find_decoder() returns whichever decoder the FFmpeg build
+// registered first, which is not always the fastest one and may even be a
+// hardware wrapper. For the codecs cameras send we keep an explicit order
+// instead (libdav1d before libaom for AV1, the native decoders for H.264
+// and HEVC); a per-codec override from the command line comes first.
+struct DecoderSelection {
+    // Codec name as avcodec_get_name() spells it ("h264", "hevc", "av1", "vp9")
+    // to decoder names, tried in order before the built-in preference
+    std::map<std::string, std::vector<std::string> > preferred;
+};
+
+// --decoder-h264=, --decoder-hevc=, --decoder-av1=, --decoder-vp9=, each a
+// comma-separated list of decoder names, e.g. --decoder-av1=libaom-av1
+DecoderSelection decoderSelectionFromOptions(const ClientOptions& options);
+
+// The first usable decoder for the codec: configured names, then the
+// built-in preference (software decoders only), then avcodec_find_decoder().
+// FFmpeg's native av1 decoder needs a hardware accelerator and is only used
+// when --decoder-av1 names it. Null when the build has no usable decoder.
+const AVCodec* selectDecoder(AVCodecID id, const DecoderSelection& selection);
+
+// Every software decoder this build has for the codec, preferred first
+std::vector<const AVCodec*> softwareDecoders(AVCodecID id, const DecoderSelection& selection);
+
+// Codec-private low-latency settings that the generic threading policy
+// cannot express. Follows the AV_CODEC_FLAG_LOW_DELAY decision that
+// applyDecoderThreading() made, so call it afterwards, before avcodec_open2().
+void applyCodecLowLatency(AVCodecContext* ctx);
+
+#endif // DECODERSELECT_H
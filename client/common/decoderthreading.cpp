@@ -0,0 +1,174 @@
+#include "decoderthreading.h"
+#include "clientoptions.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+extern "C" {
+#include <libavutil/cpu.h>
+}
+
+// Before FFmpeg 4.4 the same capability went by another name
+#ifndef AV_CODEC_CAP_OTHER_THREADS
+#define AV_CODEC_CAP_OTHER_THREADS AV_CODEC_CAP_AUTO_THREADS
+#endif
+
+namespace {
+
+// libavcodec itself refuses more than 16 automatic threads; beyond 8 the
+// extra latency of frame threading outweighs the gain for live viewing.
+const int kMaxFrameThreads = 8;
+const int kMaxSliceThreads = 8;
+
+// At and above this many pixels a single core cannot keep up with a
+// high-bitrate H.264 stream, so auto mode pays the frame-threading latency.
+const int kFrameThreadingPixels = 1920 * 1080;
+const int kUhdPixels = 3840 * 2160;
+
+bool supports(const AVCodecContext* ctx, int capability)
+{
+    return ctx->codec && (ctx->codec->capabilities & capability);
+}
+
+// Library wrappers such as libdav1d run their own thread pool: they take
+// thread_count and ignore thread_type
+bool ownThreads(const AVCodecContext* ctx)
+{
+    return supports(ctx, AV_CODEC_CAP_OTHER_THREADS) &&
+           !supports(ctx, AV_CODEC_CAP_FRAME_THREADS | AV_CODEC_CAP_SLICE_THREADS);
+}
+
+} // namespace
+
+bool parseDecoderThreadingMode(const std::string& text, DecoderThreadingMode* mode)
+{
+    if (text == "auto") {
+        *mode = DECODE_THREADING_AUTO;
+    } else if (text == "frame" || text == "throughput") {
+        *mode = DECODE_THREADING_FRAME;
+    } else if (text == "slice" || text == "low-latency") {
+        *mode = DECODE_THREADING_SLICE;
+    } else if (text == "off" || text == "none") {
+        *mode = DECODE_THREADING_OFF;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* decoderThreadingModeName(DecoderThreadingMode mode)
+{
+    switch (mode) {
+    case DECODE_THREADING_FRAME: return "frame";
+    case DECODE_THREADING_SLICE: return "slice";
+    case DECODE_THREADING_OFF: return "off";
+    default: return "auto";
+    }
+}
+
+DecoderThreadingPolicy decoderThreadingFromOptions(const ClientOptions& options)
+{
+    DecoderThreadingPolicy policy;
+    const std::string mode = options.get("decode-threading", "auto");
+    if (!parseDecoderThreadingMode(mode, &policy.mode)) {
+        fprintf(stderr, "Ignoring --decode-threading=%s, expected auto, frame, slice or off\n", mode.c_str());
+    }
+    policy.threads = std::max(0, options.getInt("decode-threads", 0));
+    return policy;
+}
+
+void applyDecoderThreading(AVCodecContext* ctx, const DecoderThreadingPolicy& policy)
+{
+    const int cores = std::max(1, av_cpu_count());
+    const int pixels = ctx->width * ctx->height;
+
+    DecoderThreadingMode mode = policy.mode;
+    int threads = policy.threads;
+
+    if (mode == DECODE_THREADING_AUTO) {
+        if (cores == 1) {
+            mode = DECODE_THREADING_OFF;
+        } else if (pixels >= kFrameThreadingPixels) {
+            mode = DECODE_THREADING_FRAME;
+            // 1080p: a few frames of latency; UHD: as much parallelism as we allow
+            if (threads == 0) threads = std::min(cores, pixels >= kUhdPixels ? kMaxFrameThreads : 4);
+        } else {
+            mode = DECODE_THREADING_SLICE;
+        }
+    }
+
+    // Fall back to whatever the decoder can actually do. Own-pool decoders
+    // keep the mode: it still decides the thread count and low-delay flags.
+    if (mode == DECODE_THREADING_FRAME && !supports(ctx, AV_CODEC_CAP_FRAME_THREADS) && !ownThreads(ctx)) {
+        mode = DECODE_THREADING_SLICE;
+    }
+    if (mode == DECODE_THREADING_SLICE && !supports(ctx, AV_CODEC_CAP_SLICE_THREADS) && !ownThreads(ctx)) {
+        mode = DECODE_THREADING_OFF;
+    }
+
+    switch (mode) {
+    case DECODE_THREADING_FRAME:
+        ctx->thread_type = FF_THREAD_FRAME;
+        ctx->thread_count = threads > 0 ? threads : std::min(cores, kMaxFrameThreads);
+        ctx->flags &= ~AV_CODEC_FLAG_LOW_DELAY;
+        ctx->flags2 &= ~AV_CODEC_FLAG2_CHUNKS;
+        break;
+    case DECODE_THREADING_SLICE:
+        ctx->thread_type = FF_THREAD_SLICE;
+        ctx->thread_count = threads > 0 ? threads : std::min(cores, kMaxSliceThreads);
+        ctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
+        ctx->flags2 |= AV_CODEC_FLAG2_CHUNKS;
+        break;
+    default:
+        ctx->thread_type = 0;
+        ctx->thread_count = 1;
+        ctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
+        ctx->flags2 |= AV_CODEC_FLAG2_CHUNKS;
+        break;
+    }
+}
+
+int decoderThreadingLatencyFrames(const AVCodecContext* ctx)
+{
+    if ((ctx->active_thread_type & FF_THREAD_FRAME) && ctx->thread_count > 1) {
+        return ctx->thread_count - 1;
+    }
+    // libdav1d keeps up to ceil(sqrt(threads)) frames in flight unless
+    // applyCodecLowLatency() limited it to one
+    if (ownThreads(ctx) && ctx->thread_count > 1 && !(ctx->flags & AV_CODEC_FLAG_LOW_DELAY) &&
+        strcmp(ctx->codec->name, "libdav1d") == 0) {
+        return std::min(8, static_cast<int>(std::ceil(std::sqrt(ctx->thread_count)))) - 1;
+    }
+    return 0;
+}
+
+std::string describeDecoderThreading(const AVCodecContext* ctx)
+{
+    std::ostringstream oss;
+    if (ctx->active_thread_type & FF_THREAD_FRAME) {
+        oss << "frame x" << ctx->thread_count;
+    } else if (ctx->active_thread_type & FF_THREAD_SLICE) {
+        oss << "slice x" << ctx->thread_count;
+    } else if (ownThreads(ctx) && ctx->thread_count > 1) {
+        oss << ctx->codec->name << " x" << ctx->thread_count;
+    } else {
+        oss << "single thread";
+    }
+    oss << ", +" << decoderThreadingLatencyFrames(ctx) << " frames latency";
+    return oss.str();
+}
+
+double DecodeRateMeter::msPerFrame() const
+{
+    const int64_t n = frames();
+    return n > 0 ? busyUs_.load(std::memory_order_relaxed) / 1000.0 / n : 0.0;
+}
+
+double DecodeRateMeter::capacityFps() const
+{
+    const double ms = msPerFrame();
+    return ms > 0 ? 1000.0 / ms : 0.0;
+}
@@ -0,0 +1,82 @@
+#ifndef DECODERTHREADING_H
+#define DECODERTHREADING_H
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+class ClientOptions;
+
+// How a video decoder spreads its work over threads.
+//
+// Frame threading decodes several frames in parallel and scales with any
+// stream, but every extra thread holds back one more frame. Slice threading
+// adds no latency but only helps when the encoder produced several slices
+// per frame (x264 --tune zerolatency does). Frame threading is incompatible
+// with AV_CODEC_FLAG_LOW_DELAY and AV_CODEC_FLAG2_CHUNKS, so the policy owns
+// those flags as well.
+enum DecoderThreadingMode {
+    DECODE_THREADING_AUTO = 0,  // pick from resolution and core count
+    DECODE_THREADING_FRAME,     // high-throughput profile
+    DECODE_THREADING_SLICE,     // low-latency profile
+    DECODE_THREADING_OFF        // single thread, low-delay flags on
+};
+
+struct DecoderThreadingPolicy {
+    DecoderThreadingMode mode = DECODE_THREADING_AUTO;
+    int threads = 0;  // 0 = derived from the core count
+};
+
+// Accepts auto/frame/slice/off and the profile names throughput/low-latency
+bool parseDecoderThreadingMode(const std::string& text, DecoderThreadingMode* mode);
+const char* decoderThreadingModeName(DecoderThreadingMode mode);
+
+// --decode-threading=<mode> and --decode-threads=<n>
+DecoderThreadingPolicy decoderThreadingFromOptions(const ClientOptions& options);
+
+// Sets thread_type, thread_count and the low-delay flags on a context that
+// already carries the stream parameters. Decoders with their own thread
+// pool (libdav1d) only take the count and the flags. Call before avcodec_open2().
+void applyDecoderThreading(AVCodecContext* ctx, const DecoderThreadingPolicy& policy);
+
+// Frames the decoder holds back because of threading, valid after avcodec_open2()
+int decoderThreadingLatencyFrames(const AVCodecContext* ctx);
+
+// e.g. "frame x4, +3 frames latency", valid after avcodec_open2()
+std::string describeDecoderThreading(const AVCodecContext* ctx);
+
+// Wall time the decode loop spends inside send/receive per decoded frame.
+// With frame threading this drops well below the single-thread decode time,
+// which is the throughput gain paid for with the latency above.
+class DecodeRateMeter
+{
+public:
+    DecodeRateMeter() : busyUs_(0), frames_(0) {}
+
+    void add(int64_t busyUs, int frames)
+    {
+        busyUs_.fetch_add(busyUs, std::memory_order_relaxed);
+        frames_.fetch_add(frames, std::memory_order_relaxed);
+    }
+
+    void reset()
+    {
+        busyUs_.store(0, std::memory_order_relaxed);
+        frames_.store(0, std::memory_order_relaxed);
+    }
+
+    int64_t frames() const { return frames_.load(std::memory_order_relaxed); }
+    double msPerFrame() const;
+    // Frame rate the decode stage could sustain at the measured cost
+    double capacityFps() const;
+
+private:
+    std::atomic<int64_t> busyUs_;
+    std::atomic<int64_t> frames_;
+};
+
+#endif // DECODERTHREADING_H
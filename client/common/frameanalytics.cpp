@@ -0,0 +1,208 @@
+#include "frameanalytics.h"
+#include "clientoptions.h"
+
+#include <algorithm>
+
+extern "C" {
+#include <libavutil/pixdesc.h>
+#include <libavutil/time.h>
+}
+
+namespace {
+
+// Per-pixel change (0-255) that counts as "changed"; below it is sensor noise
+const int kPixelChangeLevel = 25;
+// Frames above the threshold before an event starts, and quiet frames before it ends
+const int kStartFrames = 3;
+const int kEndFrames = 25;
+
+// Plane 0 is an 8-bit luma plane: every YUV/YUVJ/NV format the decoders output
+bool hasLumaPlane(const AVFrame* frame)
+{
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(static_cast<AVPixelFormat>(frame->format));
+    if (!desc) return false;
+    if (desc->flags & (AV_PIX_FMT_FLAG_RGB | AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_PAL)) return false;
+    return desc->comp[0].plane == 0 && desc->comp[0].step == 1 && desc->comp[0].depth == 8;
+}
+
+} // namespace
+
+AnalyticsConfig analyticsFromOptions(const ClientOptions& options)
+{
+    AnalyticsConfig config;
+    config.enabled = options.has("analytics");
+    config.workers = std::max(1, options.getInt("analytics-workers", config.workers));
+    config.queueFrames = std::max(1, options.getInt("analytics-queue", config.queueFrames));
+    config.analysisWidth = std::max(16, options.getInt("analytics-width", config.analysisWidth));
+    config.motionThreshold = options.getDouble("motion-threshold", config.motionThreshold);
+    return config;
+}
+
+MotionDetector::MotionDetector(int analysisWidth, double threshold)
+    : analysisWidth_(analysisWidth), threshold_(threshold),
+      above_(0), below_(0), inMotion_(false)
+{
+}
+
+cv::Mat MotionDetector::prepare(const AVFrame* frame)
+{
+    if (!hasLumaPlane(frame) || frame->width <= 0 || frame->height <= 0) return cv::Mat();
+
+    // Wraps the decoder's buffer; resize() reads it and writes a small copy
+    const cv::Mat luma(frame->height, frame->width, CV_8UC1, frame->data[0], frame->linesize[0]);
+    const int width = std::min(analysisWidth_, frame->width);
+    const int height = std::max(1, frame->height * width / frame->width);
+    cv::Mat small;
+    cv::resize(luma, small, cv::Size(width, height), 0, 0, cv::INTER_AREA);
+    cv::GaussianBlur(small, small, cv::Size(5, 5), 0);
+    return small;
+}
+
+double MotionDetector::process(int64_t seq, int64_t ptsUs, const cv::Mat& prepared,
+                               AnalyticsEvent* event, bool* hasEvent)
+{
+    *hasEvent = false;
+    if (prepared.empty()) return 0.0;
+    if (previous_.size() != prepared.size()) {
+        // First frame, or the stream changed size: nothing to compare with
+        previous_ = prepared;
+        above_ = 0;
+        return 0.0;
+    }
+
+    cv::absdiff(prepared, previous_, diff_);
+    cv::threshold(diff_, diff_, kPixelChangeLevel, 255, cv::THRESH_BINARY);
+    const double score = static_cast<double>(cv::countNonZero(diff_)) / diff_.total();
+    previous_ = prepared;
+
+    if (score >= threshold_) {
+        above_++;
+        below_ = 0;
+    } else {
+        below_++;
+        above_ = 0;
+    }
+
+    const bool started = !inMotion_ && above_ >= kStartFrames;
+    const bool ended = inMotion_ && below_ >= kEndFrames;
+    if (started || ended) {
+        inMotion_ = started;
+        event->seq = seq;
+        event->ptsUs = ptsUs;
+        event->analyzer = name();
+        event->what = started ? "motion started" : "motion ended";
+        event->active = started;
+        event->score = score;
+        *hasEvent = true;
+    }
+    return score;
+}
+
+FrameAnalytics::FrameAnalytics(const AnalyticsConfig& config, FrameAnalyzer* analyzer)
+    : config_(config), analyzer_(analyzer), stopping_(false), nextSeq_(0), nextToProcess_(0),
+      submitted_(0), dropped_(0), analyzed_(0), events_(0), busyUs_(0), lastScorePermille_(0)
+{
+    for (int i = 0; i < config_.workers; ++i) {
+        workers_.push_back(std::thread(&FrameAnalytics::workerLoop, this));
+    }
+}
+
+FrameAnalytics::~FrameAnalytics()
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        stopping_ = true;
+    }
+    queueCond_.notify_all();
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        workers_[i].join();
+    }
+    for (size_t i = 0; i < queue_.size(); ++i) {
+        av_frame_free(&queue_[i].frame);
+    }
+    delete analyzer_;
+}
+
+bool FrameAnalytics::submit(const AVFrame* frame, int64_t ptsUs)
+{
+    submitted_++;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        if (static_cast<int>(queue_.size()) >= config_.queueFrames) {
+            // Workers are behind: drop this frame rather than wait for them.
+            // Sequence numbers are only given to queued frames, so process()
+            // never waits for a frame that was dropped.
+            dropped_++;
+            return false;
+        }
+        AVFrame* ref = av_frame_clone(frame);
+        if (!ref) {
+            dropped_++;
+            return false;
+        }
+        Job job;
+        job.seq = nextSeq_++;
+        job.ptsUs = ptsUs;
+        job.frame = ref;
+        queue_.push_back(job);
+    }
+    queueCond_.notify_one();
+    return true;
+}
+
+void FrameAnalytics::workerLoop()
+{
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex_);
+            queueCond_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (stopping_) return;
+            job = queue_.front();
+            queue_.pop_front();
+        }
+
+        const int64_t start = av_gettime_relative();
+        cv::Mat prepared = analyzer_->prepare(job.frame);
+        av_frame_free(&job.frame);
+        deliver(job.seq, job.ptsUs, prepared);
+        busyUs_ += av_gettime_relative() - start;
+    }
+}
+
+void FrameAnalytics::deliver(int64_t seq, int64_t ptsUs, const cv::Mat& prepared)
+{
+    std::lock_guard<std::mutex> lock(orderMutex_);
+    pending_[seq] = std::make_pair(ptsUs, prepared);
+
+    // Whichever worker completes the next frame in order runs process() for
+    // it and for any later frames that were already waiting
+    while (!pending_.empty() && pending_.begin()->first == nextToProcess_) {
+        std::map<int64_t, std::pair<int64_t, cv::Mat> >::iterator it = pending_.begin();
+        AnalyticsEvent event;
+        bool hasEvent = false;
+        const double score = analyzer_->process(it->first, it->second.first, it->second.second,
+                                                &event, &hasEvent);
+        pending_.erase(it);
+        nextToProcess_++;
+        analyzed_++;
+        lastScorePermille_ = static_cast<int64_t>(score * 1000.0 + 0.5);
+        if (hasEvent) {
+            events_++;
+            if (callback_) callback_(event);
+        }
+    }
+}
+
+FrameAnalytics::Stats FrameAnalytics::stats() const
+{
+    Stats st;
+    st.submitted = submitted_;
+    st.dropped = dropped_;
+    st.analyzed = analyzed_;
+    st.events = events_;
+    st.lastScore = lastScorePermille_ / 1000.0;
+    st.msPerFrame = st.analyzed > 0 ? busyUs_ / 1000.0 / st.analyzed : 0.0;
+    st.workers = static_cast<int>(workers_.size());
+    return st;
+}
@@ -0,0 +1,155 @@
+#ifndef FRAMEANALYTICS_H
+#define FRAMEANALYTICS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+#include <opencv2/opencv.hpp>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+class ClientOptions;
+
+struct AnalyticsConfig {
+    bool enabled = false;
+    int workers = 2;              // worker threads
+    int queueFrames = 4;          // frames waiting for a worker; more are dropped
+    int analysisWidth = 160;      // frames are downscaled to this width first
+    double motionThreshold = 0.02; // changed fraction of the picture that counts as motion
+};
+
+// --analytics, --analytics-workers=<n>, --analytics-queue=<n>,
+// --analytics-width=<px>, --motion-threshold=<fraction>
+AnalyticsConfig analyticsFromOptions(const ClientOptions& options);
+
+// Something an analyzer noticed, reported in frame order
+struct AnalyticsEvent {
+    int64_t seq = 0;
+    int64_t ptsUs = 0;
+    std::string analyzer;
+    std::string what;     // e.g. "motion started"
+    bool active = false;  // whether the condition holds from this frame on
+    double score = 0.0;
+};
+
+// Split in two so the expensive part scales over the workers while
+// analyzers that compare frames still see them in order:
+// prepare() runs on any worker, for any frame, concurrently;
+// process() runs for one frame at a time, in decode order.
+class FrameAnalyzer
+{
+public:
+    virtual ~FrameAnalyzer() {}
+
+    virtual const char* name() const = 0;
+    // frame is a reference to the decoded picture, not a copy
+    virtual cv::Mat prepare(const AVFrame* frame) = 0;
+    // Returns the frame's score; fills *event and returns true in
+    // *hasEvent when something started or ended
+    virtual double process(int64_t seq, int64_t ptsUs, const cv::Mat& prepared,
+                           AnalyticsEvent* event, bool* hasEvent) = 0;
+};
+
+// Frame-difference motion detection on a downscaled, blurred luma plane.
+// The score is the fraction of pixels that changed by more than a fixed
+// level since the previous frame; a motion event starts after a few frames
+// above the threshold and ends after a quiet second or so.
+class MotionDetector : public FrameAnalyzer
+{
+public:
+    MotionDetector(int analysisWidth, double threshold);
+
+    const char* name() const override { return "motion"; }
+    cv::Mat prepare(const AVFrame* frame) override;
+    double process(int64_t seq, int64_t ptsUs, const cv::Mat& prepared,
+                   AnalyticsEvent* event, bool* hasEvent) override;
+
+private:
+    int analysisWidth_;
+    double threshold_;
+    cv::Mat previous_;   // process() only
+    cv::Mat diff_;
+    int above_;
+    int below_;
+    bool inMotion_;
+};
+
+// Runs an analyzer on a small worker pool next to the decode loop.
+//
+// submit() only takes a new reference to the decoded frame and never
+// waits: when the workers are behind and the queue is full, the frame is
+// dropped and counted. Events are delivered through the callback on a
+// worker thread.
+class FrameAnalytics
+{
+public:
+    typedef std::function<void(const AnalyticsEvent&)> EventCallback;
+
+    // Takes ownership of the analyzer
+    FrameAnalytics(const AnalyticsConfig& config, FrameAnalyzer* analyzer);
+    ~FrameAnalytics();
+
+    void setEventCallback(const EventCallback& callback) { callback_ = callback; }
+
+    // False when the frame was dropped
+    bool submit(const AVFrame* frame, int64_t ptsUs);
+
+    struct Stats {
+        int64_t submitted = 0;
+        int64_t dropped = 0;
+        int64_t analyzed = 0;
+        int64_t events = 0;
+        double lastScore = 0.0;
+        double msPerFrame = 0.0;   // worker time per analyzed frame
+        int workers = 0;
+    };
+    Stats stats() const;
+
+private:
+    FrameAnalytics(const FrameAnalytics&);
+    FrameAnalytics& operator=(const FrameAnalytics&);
+
+    struct Job {
+        int64_t seq;
+        int64_t ptsUs;
+        AVFrame* frame;
+    };
+
+    void workerLoop();
+    void deliver(int64_t seq, int64_t ptsUs, const cv::Mat& prepared);
+
+    AnalyticsConfig config_;
+    FrameAnalyzer* analyzer_;
+    EventCallback callback_;
+    std::vector<std::thread> workers_;
+
+    std::mutex queueMutex_;
+    std::condition_variable queueCond_;
+    std::deque<Job> queue_;
+    bool stopping_;
+    int64_t nextSeq_;
+
+    // Prepared frames waiting for their turn in process()
+    std::mutex orderMutex_;
+    std::map<int64_t, std::pair<int64_t, cv::Mat> > pending_;
+    int64_t nextToProcess_;
+
+    std::atomic<int64_t> submitted_;
+    std::atomic<int64_t> dropped_;
+    std::atomic<int64_t> analyzed_;
+    std::atomic<int64_t> events_;
+    std::atomic<int64_t> busyUs_;
+    std::atomic<int64_t> lastScorePermille_;
+};
+
+#endif // FRAMEANALYTICS_H
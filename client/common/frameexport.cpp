@@ -0,0 +1,88 @@
+#include "frameexport.h"
+#include "clientoptions.h"
+#include "alloccount.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+extern "C" {
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+FrameExportConfig frameExportFromOptions(const ClientOptions& options)
+{
+    FrameExportConfig config;
+    config.name = options.get("shm-export");
+    if (config.name == "1") config.name.clear(); // bare --shm-export carries no name
+    config.slotCount = std::max(2, options.getInt("shm-slots", config.slotCount));
+    if (options.has("shm-mode")) {
+        const std::string text = options.get("shm-mode");
+        char* end = nullptr;
+        const long mode = std::strtol(text.c_str(), &end, 8);
+        if (text.empty() || *end || mode < 0 || mode > 0777) {
+            fprintf(stderr, "Ignoring --shm-mode=%s, expected octal permissions such as 0640\n", text.c_str());
+        } else {
+            config.mode = static_cast<unsigned int>(mode);
+        }
+    }
+    return config;
+}
+
+FrameShmExporter::FrameShmExporter(const FrameExportConfig& config)
+    : config_(config), failedOpenBytes_(0), published_(0), failed_(0)
+{
+}
+
+bool FrameShmExporter::publish(const AVFrame* frame, int64_t ptsUs)
+{
+    const AVPixelFormat format = static_cast<AVPixelFormat>(frame->format);
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(format);
+    if (!desc || (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM | AV_PIX_FMT_FLAG_PAL))) {
+        failed_++;
+        return false;
+    }
+
+    FrameShmImage image;
+    image.width = frame->width;
+    image.height = frame->height;
+    image.format = frame->format;
+    image.formatName = desc->name;
+    image.planes = std::min(av_pix_fmt_count_planes(format), kFrameShmMaxPlanes);
+    int rowBytes[4] = {};
+    if (image.planes <= 0 || av_image_fill_linesizes(rowBytes, format, frame->width) < 0) {
+        failed_++;
+        return false;
+    }
+    for (int i = 0; i < image.planes; ++i) {
+        const bool chroma = i == 1 || i == 2;
+        image.data[i] = frame->data[i];
+        image.linesize[i] = frame->linesize[i];
+        image.rowBytes[i] = rowBytes[i];
+        image.rows[i] = chroma ? AV_CEIL_RSHIFT(frame->height, desc->log2_chroma_h) : frame->height;
+    }
+
+    const size_t bytes = frameShmImageBytes(image);
+    if (!writer_.isOpen() || bytes > writer_.maxImageBytes()) {
+        if (bytes == failedOpenBytes_) {
+            failed_++;
+            return false;
+        }
+        // Once per stream (or per resolution change), not per frame
+        UncountedAllocScope reopen;
+        if (!writer_.open(config_.name, config_.slotCount, bytes, config_.mode, &lastError_)) {
+            failedOpenBytes_ = bytes;
+            failed_++;
+            return false;
+        }
+        failedOpenBytes_ = 0;
+    }
+
+    if (!writer_.publish(image, ptsUs)) {
+        failed_++;
+        return false;
+    }
+    published_++;
+    return true;
+}
@@ -0,0 +1,54 @@
+#ifndef FRAMEEXPORT_H
+#define FRAMEEXPORT_H
+
+#include "frameshm.h"
+
+#include <atomic>
+#include <string>
+#include <stdint.h>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+class ClientOptions;
+
+struct FrameExportConfig {
+    std::string name;    // shared-memory segment, empty = off
+    int slotCount = 8;   // ring depth: how far a reader may lag before losing frames
+    unsigned int mode = 0600;   // segment permissions; the frames show what the camera sees
+};
+
+// --shm-export=<name>, --shm-slots=<n> and --shm-mode=<octal>, e.g. 0640
+FrameExportConfig frameExportFromOptions(const ClientOptions& options);
+
+// Publishes decoded AVFrames into a FrameShmWriter ring. The ring is
+// created at the first frame and recreated when a frame no longer fits
+// (resolution or format change); readers see the old one closed and reopen.
+class FrameShmExporter
+{
+public:
+    explicit FrameShmExporter(const FrameExportConfig& config);
+
+    const FrameExportConfig& config() const { return config_; }
+
+    // Returns false for frames that cannot be exported (hardware frames,
+    // bitstream/palette formats) or when the ring cannot be created
+    bool publish(const AVFrame* frame, int64_t ptsUs);
+
+    // Counters are safe to read from any thread
+    int64_t published() const { return published_.load(std::memory_order_relaxed); }
+    int64_t failed() const { return failed_.load(std::memory_order_relaxed); }
+    // Publishing thread only
+    const std::string& lastError() const { return lastError_; }
+
+private:
+    FrameExportConfig config_;
+    FrameShmWriter writer_;
+    size_t failedOpenBytes_;   // do not retry a ring size that could not be created
+    std::atomic<int64_t> published_;
+    std::atomic<int64_t> failed_;
+    std::string lastError_;
+};
+
+#endif // FRAMEEXPORT_H
@@ -0,0 +1,388 @@
+#include "frameshm.h"
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+namespace {
+
+const size_t kLineAlign = 64;
+
+size_t alignUp(size_t value, size_t align)
+{
+    return (value + align - 1) / align * align;
+}
+
+size_t headerBytes()
+{
+    return alignUp(sizeof(FrameShmHeader), kLineAlign);
+}
+
+size_t slotHeaderBytes()
+{
+    return alignUp(sizeof(FrameShmSlot), kLineAlign);
+}
+
+int64_t monotonicUs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+void setError(std::string* error, const std::string& what)
+{
+    if (error) *error = what + ": " + strerror(errno);
+}
+
+std::string segmentName(const std::string& name)
+{
+    return name.empty() || name[0] == '/' ? name : "/" + name;
+}
+
+// Shared (not private) futex: the waiters live in other processes
+void futexWake(std::atomic<uint32_t>* word)
+{
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#else
+    (void)word;
+#endif
+}
+
+void futexWait(const std::atomic<uint32_t>* word, uint32_t expected, int timeoutMs)
+{
+#ifdef __linux__
+    timespec timeout;
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_nsec = (timeoutMs % 1000) * 1000000L;
+    syscall(SYS_futex, reinterpret_cast<const uint32_t*>(word), FUTEX_WAIT, expected, &timeout, nullptr, 0);
+#else
+    (void)word;
+    (void)expected;
+    usleep(static_cast<useconds_t>(timeoutMs < 5 ? timeoutMs : 5) * 1000);
+#endif
+}
+
+} // namespace
+
+size_t frameShmImageBytes(const FrameShmImage& image)
+{
+    size_t bytes = 0;
+    for (int i = 0; i < image.planes && i < kFrameShmMaxPlanes; ++i) {
+        bytes += alignUp(static_cast<size_t>(image.rowBytes[i]), kLineAlign) * image.rows[i];
+    }
+    return bytes;
+}
+
+FrameShmWriter::FrameShmWriter()
+    : header_(nullptr), mapBytes_(0), maxImageBytes_(0), nextSeq_(1)
+{
+}
+
+FrameShmWriter::~FrameShmWriter()
+{
+    close();
+}
+
+bool FrameShmWriter::open(const std::string& name, int slotCount, size_t maxImageBytes, unsigned int mode,
+                          std::string* error)
+{
+    close();
+    if (slotCount < 2 || maxImageBytes == 0) {
+        if (error) *error = "need at least two slots and a non-empty image";
+        return false;
+    }
+
+    name_ = segmentName(name);
+    const size_t slotBytes = slotHeaderBytes() + alignUp(maxImageBytes, kLineAlign);
+    const size_t total = headerBytes() + slotBytes * slotCount;
+
+    // Replace any ring a previous writer left behind; its readers keep the
+    // old mapping until they notice it is closed
+    shm_unlink(name_.c_str());
+    int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        setError(error, "shm_open " + name_);
+        return false;
+    }
+    // Widened only on request, and exactly as asked rather than through the umask
+    if ((mode & 0777) != 0600 && fchmod(fd, static_cast<mode_t>((mode & 0777) | 0600)) != 0) {
+        setError(error, "fchmod " + name_);
+        ::close(fd);
+        shm_unlink(name_.c_str());
+        return false;
+    }
+    if (ftruncate(fd, static_cast<off_t>(total)) != 0) {
+        setError(error, "ftruncate " + name_);
+        ::close(fd);
+        shm_unlink(name_.c_str());
+        return false;
+    }
+    void* map = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        setError(error, "mmap " + name_);
+        shm_unlink(name_.c_str());
+        return false;
+    }
+
+    // Fresh pages are zero, so every slot starts out empty (seq 0)
+    FrameShmHeader* header = new (map) FrameShmHeader;
+    header->slotCount = static_cast<uint32_t>(slotCount);
+    header->headerBytes = static_cast<uint32_t>(headerBytes());
+    header->slotBytes = slotBytes;
+    header->writerPid = static_cast<int32_t>(getpid());
+    header->closed.store(0, std::memory_order_relaxed);
+    header->notify.store(0, std::memory_order_relaxed);
+    header->lastSeq.store(0, std::memory_order_relaxed);
+    header->version = kFrameShmVersion;
+    // Readers check the magic last
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = kFrameShmMagic;
+
+    header_ = header;
+    mapBytes_ = total;
+    maxImageBytes_ = maxImageBytes;
+    nextSeq_ = 1;
+    return true;
+}
+
+void FrameShmWriter::close()
+{
+    if (!header_) return;
+    header_->closed.store(1, std::memory_order_release);
+    header_->notify.fetch_add(1, std::memory_order_release);
+    futexWake(&header_->notify);
+    munmap(header_, mapBytes_);
+    shm_unlink(name_.c_str());
+    header_ = nullptr;
+    mapBytes_ = 0;
+    maxImageBytes_ = 0;
+}
+
+uint64_t FrameShmWriter::publish(const FrameShmImage& image, int64_t ptsUs)
+{
+    if (!header_ || image.planes <= 0 || image.planes > kFrameShmMaxPlanes) return 0;
+    if (frameShmImageBytes(image) > maxImageBytes_) return 0;
+
+    const uint64_t seq = nextSeq_++;
+    uint8_t* base = reinterpret_cast<uint8_t*>(header_) + header_->headerBytes;
+    uint8_t* slotBase = base + (seq % header_->slotCount) * header_->slotBytes;
+    FrameShmSlot* slot = reinterpret_cast<FrameShmSlot*>(slotBase);
+
+    // Open the write side of the sequence lock
+    slot->seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot->ptsUs = ptsUs;
+    slot->publishUs = monotonicUs();
+    slot->width = image.width;
+    slot->height = image.height;
+    slot->format = image.format;
+    strncpy(slot->formatName, image.formatName ? image.formatName : "", sizeof(slot->formatName) - 1);
+    slot->formatName[sizeof(slot->formatName) - 1] = '\0';
+    slot->planes = image.planes;
+
+    size_t offset = slotHeaderBytes();
+    for (int i = 0; i < kFrameShmMaxPlanes; ++i) {
+        if (i >= image.planes) {
+            slot->linesize[i] = 0;
+            slot->rows[i] = 0;
+            slot->offset[i] = 0;
+            continue;
+        }
+        const size_t linesize = alignUp(static_cast<size_t>(image.rowBytes[i]), kLineAlign);
+        slot->linesize[i] = static_cast<int32_t>(linesize);
+        slot->rows[i] = image.rows[i];
+        slot->offset[i] = offset;
+        const uint8_t* src = image.data[i];
+        uint8_t* dst = slotBase + offset;
+        if (image.linesize[i] == static_cast<int>(linesize)) {
+            memcpy(dst, src, linesize * image.rows[i]);
+        } else {
+            for (int y = 0; y < image.rows[i]; ++y) {
+                memcpy(dst + y * linesize, src + static_cast<ptrdiff_t>(y) * image.linesize[i], image.rowBytes[i]);
+            }
+        }
+        offset += linesize * image.rows[i];
+    }
+    slot->dataBytes = offset - slotHeaderBytes();
+
+    slot->seq.store(seq, std::memory_order_release);
+    header_->lastSeq.store(seq, std::memory_order_release);
+    header_->notify.fetch_add(1, std::memory_order_release);
+    futexWake(&header_->notify);
+    return seq;
+}
+
+FrameShmReader::FrameShmReader()
+    : header_(nullptr), mapBytes_(0), inode_(0)
+{
+}
+
+FrameShmReader::~FrameShmReader()
+{
+    close();
+}
+
+bool FrameShmReader::open(const std::string& name, std::string* error)
+{
+    close();
+    const std::string shmName = segmentName(name);
+    int fd = shm_open(shmName.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        setError(error, "shm_open " + shmName);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < headerBytes()) {
+        if (error) *error = shmName + " is not a frame ring (yet)";
+        ::close(fd);
+        return false;
+    }
+    // Read-only: a reader cannot disturb the writer or other readers
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        setError(error, "mmap " + shmName);
+        return false;
+    }
+
+    const FrameShmHeader* header = static_cast<const FrameShmHeader*>(map);
+    const bool valid = header->magic == kFrameShmMagic && header->version == kFrameShmVersion &&
+                       header->slotCount > 0 &&
+                       header->headerBytes + header->slotBytes * header->slotCount <= static_cast<uint64_t>(st.st_size);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (!valid) {
+        if (error) *error = shmName + " is not a frame ring (yet)";
+        munmap(map, st.st_size);
+        return false;
+    }
+
+    header_ = header;
+    mapBytes_ = st.st_size;
+    name_ = shmName;
+    inode_ = static_cast<uint64_t>(st.st_ino);
+    // A crashed writer leaves its ring behind; do not wait on it forever
+    if (!header_->closed.load(std::memory_order_acquire) && writerGone()) {
+        if (error) *error = "the writer of " + shmName + " has exited";
+        close();
+        return false;
+    }
+    return true;
+}
+
+void FrameShmReader::close()
+{
+    if (!header_) return;
+    munmap(const_cast<FrameShmHeader*>(header_), mapBytes_);
+    header_ = nullptr;
+    mapBytes_ = 0;
+    name_.clear();
+    inode_ = 0;
+}
+
+// The writer process no longer exists, or the name now refers to another
+// segment (unlinked, or replaced by a new writer)
+bool FrameShmReader::writerGone() const
+{
+    // EPERM: alive, just owned by another user
+    if (kill(static_cast<pid_t>(header_->writerPid), 0) != 0 && errno == ESRCH) return true;
+
+    int fd = shm_open(name_.c_str(), O_RDONLY, 0);
+    if (fd < 0) return errno == ENOENT;
+    struct stat st;
+    const bool replaced = fstat(fd, &st) == 0 && static_cast<uint64_t>(st.st_ino) != inode_;
+    ::close(fd);
+    return replaced;
+}
+
+uint64_t FrameShmReader::latestSeq() const
+{
+    return header_ ? header_->lastSeq.load(std::memory_order_acquire) : 0;
+}
+
+FrameShmReader::WaitResult FrameShmReader::waitNewer(uint64_t lastSeq, int timeoutMs)
+{
+    if (!header_) return WAIT_CLOSED;
+    const int64_t deadline = monotonicUs() + static_cast<int64_t>(timeoutMs) * 1000;
+    for (;;) {
+        // Read the futex word before the condition, so a publish in between
+        // changes the word and the wait returns at once
+        const uint32_t word = header_->notify.load(std::memory_order_acquire);
+        if (header_->closed.load(std::memory_order_acquire)) return WAIT_CLOSED;
+        if (header_->lastSeq.load(std::memory_order_acquire) > lastSeq) return WAIT_FRAME;
+
+        const int64_t left = deadline - monotonicUs();
+        if (left <= 0) return writerGone() ? WAIT_CLOSED : WAIT_TIMEOUT;
+        futexWait(&header_->notify, word, static_cast<int>((left + 999) / 1000));
+    }
+}
+
+bool FrameShmReader::latest(FrameShmFrame* frame) const
+{
+    const uint64_t seq = latestSeq();
+    return seq > 0 && get(seq, frame);
+}
+
+bool FrameShmReader::get(uint64_t seq, FrameShmFrame* frame) const
+{
+    if (!header_ || seq == 0) return false;
+    const uint8_t* base = reinterpret_cast<const uint8_t*>(header_) + header_->headerBytes;
+    const uint8_t* slotBase = base + (seq % header_->slotCount) * header_->slotBytes;
+    const FrameShmSlot* slot = reinterpret_cast<const FrameShmSlot*>(slotBase);
+
+    if (slot->seq.load(std::memory_order_acquire) != seq) return false;
+
+    FrameShmFrame f;
+    f.seq = seq;
+    f.ptsUs = slot->ptsUs;
+    f.publishUs = slot->publishUs;
+    f.width = slot->width;
+    f.height = slot->height;
+    f.format = slot->format;
+    memcpy(f.formatName, slot->formatName, sizeof(f.formatName));
+    f.formatName[sizeof(f.formatName) - 1] = '\0';
+    f.planes = slot->planes;
+    uint64_t offset[kFrameShmMaxPlanes];
+    for (int i = 0; i < kFrameShmMaxPlanes; ++i) {
+        f.linesize[i] = slot->linesize[i];
+        f.rows[i] = slot->rows[i];
+        offset[i] = slot->offset[i];
+    }
+    f.slot = slot;
+
+    // The metadata must be from one frame before it is trusted as pointers
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot->seq.load(std::memory_order_relaxed) != seq) return false;
+    if (f.planes <= 0 || f.planes > kFrameShmMaxPlanes) return false;
+    for (int i = 0; i < f.planes; ++i) {
+        const uint64_t end = offset[i] + static_cast<uint64_t>(f.linesize[i]) * f.rows[i];
+        if (f.linesize[i] <= 0 || f.rows[i] <= 0 || end > header_->slotBytes) return false;
+        f.data[i] = slotBase + offset[i];
+    }
+
+    *frame = f;
+    return true;
+}
+
+bool FrameShmReader::stillValid(const FrameShmFrame& frame) const
+{
+    if (!frame.slot) return false;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return frame.slot->seq.load(std::memory_order_relaxed) == frame.seq;
+}
@@ -0,0 +1,169 @@
+#ifndef FRAMESHM_H
+#define FRAMESHM_H
+
+#include <atomic>
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+
+// Decoded frames shared with other processes on the same host through a
+// POSIX shared-memory ring, so analytics processes map the frames the
+// viewer already decoded instead of opening and decoding the stream again.
+//
+// One writer, any number of readers. The segment is a header followed by
+// slotCount fixed-size slots; frame N goes to slot N % slotCount. Each slot
+// is guarded by a sequence lock: the writer zeroes the slot sequence, writes
+// metadata and pixels, then stores the frame number. Readers look at pixels
+// in place and check afterwards that the sequence did not change, so a slow
+// reader never blocks the writer; it only sees that it lost the frame.
+// Publishing bumps a futex word in the header that readers can sleep on.
+//
+// This header only needs libc, so external consumers build against the
+// frame_shm library alone, without FFmpeg.
+
+const uint32_t kFrameShmMagic = 0x4d485352; // "RSHM"
+const uint32_t kFrameShmVersion = 1;
+const int kFrameShmMaxPlanes = 4;
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2,
+              "the shared ring needs address-free atomics");
+
+struct FrameShmHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t headerBytes;       // offset of slot 0
+    uint64_t slotBytes;         // per slot, including FrameShmSlot
+    int32_t writerPid;
+    std::atomic<uint32_t> closed;   // set before the writer unlinks the segment
+    std::atomic<uint32_t> notify;   // futex word, incremented per published frame
+    std::atomic<uint64_t> lastSeq;  // newest complete frame, 0 before the first
+};
+
+struct FrameShmSlot {
+    std::atomic<uint64_t> seq;  // frame number when complete, 0 while written
+    int64_t ptsUs;              // stream time, or INT64_MIN when unknown
+    int64_t publishUs;          // CLOCK_MONOTONIC at publish
+    int32_t width;
+    int32_t height;
+    int32_t format;             // AVPixelFormat value
+    char formatName[16];        // e.g. "yuv420p", for readers without FFmpeg
+    int32_t planes;
+    int32_t linesize[kFrameShmMaxPlanes];
+    int32_t rows[kFrameShmMaxPlanes];
+    uint64_t offset[kFrameShmMaxPlanes]; // from the start of the slot
+    uint64_t dataBytes;
+};
+
+// A frame as the writer hands it in; rowBytes/rows describe the part of
+// each plane that is copied
+struct FrameShmImage {
+    int width = 0;
+    int height = 0;
+    int format = -1;
+    const char* formatName = "";
+    int planes = 0;
+    const uint8_t* data[kFrameShmMaxPlanes] = {};
+    int linesize[kFrameShmMaxPlanes] = {};
+    int rowBytes[kFrameShmMaxPlanes] = {};
+    int rows[kFrameShmMaxPlanes] = {};
+};
+
+// Bytes a slot needs for the image (lines padded to 64 bytes)
+size_t frameShmImageBytes(const FrameShmImage& image);
+
+class FrameShmWriter
+{
+public:
+    FrameShmWriter();
+    ~FrameShmWriter();
+
+    // Creates (or replaces) the segment, e.g. "/rtsp_cam1". Frames are
+    // readable by the owner only unless mode (e.g. 0640) says otherwise.
+    bool open(const std::string& name, int slotCount, size_t maxImageBytes, unsigned int mode = 0600,
+              std::string* error = nullptr);
+    // Marks the ring closed, wakes readers and unlinks the segment
+    void close();
+    bool isOpen() const { return header_ != nullptr; }
+
+    size_t maxImageBytes() const { return maxImageBytes_; }
+
+    // Copies the image into the next slot and wakes readers. Returns the
+    // frame number, or 0 when the image does not fit the slots.
+    uint64_t publish(const FrameShmImage& image, int64_t ptsUs);
+
+private:
+    FrameShmWriter(const FrameShmWriter&);
+    FrameShmWriter& operator=(const FrameShmWriter&);
+
+    std::string name_;
+    FrameShmHeader* header_;
+    size_t mapBytes_;
+    size_t maxImageBytes_;
+    uint64_t nextSeq_;
+};
+
+// A frame mapped in place. The pointers stay valid while the reader is
+// open, but the pixels may be overwritten once the writer has gone round
+// the ring; check stillValid() after using them.
+struct FrameShmFrame {
+    uint64_t seq = 0;
+    int64_t ptsUs = 0;
+    int64_t publishUs = 0;
+    int width = 0;
+    int height = 0;
+    int format = -1;
+    char formatName[16] = {};
+    int planes = 0;
+    const uint8_t* data[kFrameShmMaxPlanes] = {};
+    int linesize[kFrameShmMaxPlanes] = {};
+    int rows[kFrameShmMaxPlanes] = {};
+    const FrameShmSlot* slot = nullptr;
+};
+
+class FrameShmReader
+{
+public:
+    enum WaitResult {
+        WAIT_FRAME,     // something newer than the given frame is there
+        WAIT_TIMEOUT,
+        WAIT_CLOSED     // the writer closed, exited or replaced the ring; reopen
+    };
+
+    FrameShmReader();
+    ~FrameShmReader();
+
+    // Fails for a ring whose writer has exited without closing it
+    bool open(const std::string& name, std::string* error = nullptr);
+    void close();
+    bool isOpen() const { return header_ != nullptr; }
+
+    int slotCount() const { return header_ ? static_cast<int>(header_->slotCount) : 0; }
+    uint64_t latestSeq() const;
+
+    // Sleeps on the futex until a frame newer than lastSeq is published.
+    // A writer that crashed never sets closed, so on timeout the reader
+    // also checks that the writer process and the segment are still there.
+    WaitResult waitNewer(uint64_t lastSeq, int timeoutMs);
+
+    // Newest complete frame, or a given one while it is still in the ring
+    bool latest(FrameShmFrame* frame) const;
+    bool get(uint64_t seq, FrameShmFrame* frame) const;
+
+    // False when the writer reused the slot while the frame was being read;
+    // whatever was computed from its pixels must then be discarded
+    bool stillValid(const FrameShmFrame& frame) const;
+
+private:
+    FrameShmReader(const FrameShmReader&);
+    FrameShmReader& operator=(const FrameShmReader&);
+
+    bool writerGone() const;
+
+    const FrameShmHeader* header_;
+    size_t mapBytes_;
+    std::string name_;
+    uint64_t inode_;   // of the mapped segment; a replacement has another one
+};
+
+#endif // FRAMESHM_H
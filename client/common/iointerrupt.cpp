@@ -0,0 +1,61 @@
+#include "iointerrupt.h"
+#include "clientoptions.h"
+
+#include <algorithm>
+
+extern "C" {
+#include <libavutil/time.h>
+}
+
+IoTimeouts ioTimeoutsFromOptions(const ClientOptions& options)
+{
+    IoTimeouts timeouts;
+    timeouts.openMs = std::max(0, options.getInt("open-timeout", timeouts.openMs));
+    timeouts.readMs = std::max(0, options.getInt("read-timeout", timeouts.readMs));
+    return timeouts;
+}
+
+IoInterrupter::IoInterrupter(const IoTimeouts& timeouts)
+    : timeouts_(timeouts), keepRunning_(nullptr),
+      cancelled_(false), timedOut_(false), deadlineUs_(0)
+{
+}
+
+void IoInterrupter::install(AVFormatContext* ctx)
+{
+    ctx->interrupt_callback.callback = &IoInterrupter::callback;
+    ctx->interrupt_callback.opaque = this;
+}
+
+void IoInterrupter::reset()
+{
+    cancelled_.store(false, std::memory_order_release);
+    timedOut_.store(false, std::memory_order_relaxed);
+    deadlineUs_.store(0, std::memory_order_relaxed);
+}
+
+bool IoInterrupter::cancelled() const
+{
+    return cancelled_.load(std::memory_order_acquire) ||
+           (keepRunning_ && !keepRunning_->load(std::memory_order_acquire));
+}
+
+void IoInterrupter::arm(int timeoutMs)
+{
+    timedOut_.store(false, std::memory_order_relaxed);
+    deadlineUs_.store(timeoutMs > 0 ? av_gettime_relative() + int64_t(timeoutMs) * 1000 : 0,
+                      std::memory_order_relaxed);
+}
+
+int IoInterrupter::callback(void* opaque)
+{
+    IoInterrupter* self = static_cast<IoInterrupter*>(opaque);
+    if (self->cancelled()) return 1;
+
+    const int64_t deadline = self->deadlineUs_.load(std::memory_order_relaxed);
+    if (deadline && av_gettime_relative() > deadline) {
+        self->timedOut_.store(true, std::memory_order_relaxed);
+        return 1;
+    }
+    return 0;
+}
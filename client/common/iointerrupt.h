@@ -0,0 +1,66 @@
+#ifndef IOINTERRUPT_H
+#define IOINTERRUPT_H
+
+#include <atomic>
+#include <stdint.h>
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+class ClientOptions;
+
+// Deadlines for the blocking libavformat calls
+struct IoTimeouts {
+    int openMs = 10000; // avformat_open_input + stream probing (up to 5 s of analysis)
+    int readMs = 5000;  // a single av_read_frame
+};
+
+// --open-timeout=<ms> and --read-timeout=<ms>
+IoTimeouts ioTimeoutsFromOptions(const ClientOptions& options);
+
+// AVIOInterruptCB that aborts a blocking libavformat call when it is
+// cancelled from another thread (or a signal handler), when an optional
+// "keep running" flag goes false, or when the current deadline passes.
+//
+// libavformat polls the callback while it waits on the network (every
+// 100 ms at most in its socket wait loop), so cancel() takes effect
+// without waiting for the next packet to arrive.
+class IoInterrupter
+{
+public:
+    explicit IoInterrupter(const IoTimeouts& timeouts = IoTimeouts());
+
+    void setTimeouts(const IoTimeouts& timeouts) { timeouts_ = timeouts; }
+    const IoTimeouts& timeouts() const { return timeouts_; }
+
+    // Also abort once *flag reads false
+    void watch(const std::atomic<bool>* flag) { keepRunning_ = flag; }
+
+    // Hooks the callback into a context; call before avformat_open_input()
+    void install(AVFormatContext* ctx);
+
+    // Arm the deadline for the call that follows
+    void beginOpen() { arm(timeouts_.openMs); }
+    void beginRead() { arm(timeouts_.readMs); }
+
+    // Async-signal-safe
+    void cancel() { cancelled_.store(true, std::memory_order_release); }
+    void reset();
+
+    bool cancelled() const;
+    // The last aborted call ran out of time rather than being cancelled
+    bool timedOut() const { return timedOut_.load(std::memory_order_relaxed); }
+
+private:
+    static int callback(void* opaque);
+    void arm(int timeoutMs);
+
+    IoTimeouts timeouts_;
+    const std::atomic<bool>* keepRunning_;
+    std::atomic<bool> cancelled_;
+    std::atomic<bool> timedOut_;
+    std::atomic<int64_t> deadlineUs_;  // av_gettime_relative() clock, 0 = none
+};
+
+#endif // IOINTERRUPT_H
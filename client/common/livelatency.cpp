@@ -0,0 +1,89 @@
+#include "livelatency.h"
+#include "clientoptions.h"
+
+#include <algorithm>
+
+namespace {
+
+// Allowed sender/receiver clock drift, in microseconds per second
+const int64_t kDriftUsPerSecond = 500;
+
+} // namespace
+
+int targetLatencyFromOptions(const ClientOptions& options)
+{
+    return std::max(0, options.getInt("target-latency", 1000));
+}
+
+LiveLatencyTracker::LiveLatencyTracker()
+    : baselineUs_(0), valid_(false), lastArrivalUs_(0)
+{
+}
+
+void LiveLatencyTracker::reset()
+{
+    valid_.store(false, std::memory_order_release);
+    lastArrivalUs_ = 0;
+}
+
+void LiveLatencyTracker::packetArrived(int64_t ptsUs, int64_t arrivalUs)
+{
+    const int64_t offset = arrivalUs - ptsUs;
+    if (!valid_.load(std::memory_order_relaxed)) {
+        baselineUs_.store(offset, std::memory_order_relaxed);
+        lastArrivalUs_ = arrivalUs;
+        valid_.store(true, std::memory_order_release);
+        return;
+    }
+
+    int64_t baseline = baselineUs_.load(std::memory_order_relaxed);
+    if (offset < baseline) {
+        baseline = offset;
+    } else {
+        const int64_t creep = std::max<int64_t>(0, arrivalUs - lastArrivalUs_) * kDriftUsPerSecond / 1000000;
+        baseline = std::min(offset, baseline + creep);
+    }
+    baselineUs_.store(baseline, std::memory_order_relaxed);
+    lastArrivalUs_ = arrivalUs;
+}
+
+int64_t LiveLatencyTracker::latencyUs(int64_t ptsUs, int64_t nowUs) const
+{
+    if (!valid_.load(std::memory_order_acquire)) return -1;
+    return std::max<int64_t>(0, nowUs - ptsUs - baselineUs_.load(std::memory_order_relaxed));
+}
+
+const char* catchUpModeName(CatchUpMode mode)
+{
+    switch (mode) {
+    case CATCHUP_NONE: return "live";
+    case CATCHUP_DROP_NONREF: return "dropping non-ref";
+    case CATCHUP_SKIP_TO_KEYFRAME: return "skipping to keyframe";
+    default: return "?";
+    }
+}
+
+LiveLatencyController::LiveLatencyController(int targetMs)
+    : targetMs_(targetMs), mode_(CATCHUP_NONE)
+{
+}
+
+CatchUpMode LiveLatencyController::update(int64_t latencyMs)
+{
+    if (targetMs_ <= 0 || latencyMs < 0) {
+        mode_ = CATCHUP_NONE;
+        return mode_;
+    }
+
+    const int64_t skipAboveMs = std::max<int64_t>(2 * targetMs_, targetMs_ + 1000);
+    if (latencyMs > skipAboveMs) {
+        mode_ = CATCHUP_SKIP_TO_KEYFRAME;
+    } else if (latencyMs > targetMs_) {
+        mode_ = CATCHUP_DROP_NONREF;
+    } else if (latencyMs < targetMs_ * 3 / 4) {
+        mode_ = CATCHUP_NONE;
+    } else if (mode_ == CATCHUP_SKIP_TO_KEYFRAME) {
+        mode_ = CATCHUP_DROP_NONREF;
+    }
+    return mode_;
+}
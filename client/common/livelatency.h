@@ -0,0 +1,69 @@
+#ifndef LIVELATENCY_H
+#define LIVELATENCY_H
+
+#include <atomic>
+#include <stdint.h>
+
+class ClientOptions;
+
+// --target-latency=<ms>; 0 turns catching up off
+int targetLatencyFromOptions(const ClientOptions& options);
+
+// How far behind the live edge we are, from packet arrival against PTS.
+//
+// Every arrival gives an offset (arrival - pts). The least delayed packet
+// seen so far marks the live edge; content handled later than that edge
+// predicts is latency we added (network backlog or a slow pipeline). The
+// baseline may creep up by 500 ppm of wall time to follow clock drift
+// between sender and receiver, far too slowly to absorb a real backlog.
+class LiveLatencyTracker
+{
+public:
+    LiveLatencyTracker();
+
+    // Stream restarted: timestamps start over. Called by the arrival side.
+    void reset();
+
+    // Arrival side. Times in microseconds; arrival on av_gettime_relative().
+    void packetArrived(int64_t ptsUs, int64_t arrivalUs);
+
+    // Any thread: latency of content with this pts handled at nowUs, or -1
+    // until the first arrival
+    int64_t latencyUs(int64_t ptsUs, int64_t nowUs) const;
+
+private:
+    std::atomic<int64_t> baselineUs_;
+    std::atomic<bool> valid_;
+    int64_t lastArrivalUs_;
+};
+
+enum CatchUpMode {
+    CATCHUP_NONE = 0,
+    CATCHUP_DROP_NONREF,       // decode reference frames only until back on target
+    CATCHUP_SKIP_TO_KEYFRAME   // discard everything up to the next keyframe
+};
+
+const char* catchUpModeName(CatchUpMode mode);
+
+// Decides how hard to catch up: non-reference frames go once latency passes
+// the target, a jump to the next keyframe once it passes the target by more
+// than a second (or twice the target). Catching up stops below 3/4 of the
+// target so the mode does not flap around the threshold.
+class LiveLatencyController
+{
+public:
+    explicit LiveLatencyController(int targetMs = 1000);
+
+    void setTargetMs(int targetMs) { targetMs_ = targetMs; }
+    int targetMs() const { return targetMs_; }
+
+    CatchUpMode update(int64_t latencyMs);
+    CatchUpMode mode() const { return mode_; }
+    void reset() { mode_ = CATCHUP_NONE; }
+
+private:
+    int targetMs_;
+    CatchUpMode mode_;
+};
+
+#endif // LIVELATENCY_H
@@ -0,0 +1,210 @@
+#include "packetwriter.h"
+#include "clientoptions.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+extern "C" {
+#include <libavutil/time.h>
+}
+
+bool parseWriteQueuePolicy(const std::string& text, WriteQueuePolicy* policy)
+{
+    if (text == "block") {
+        *policy = WRITE_QUEUE_BLOCK;
+    } else if (text == "drop-nonkey") {
+        *policy = WRITE_QUEUE_DROP_NONKEY;
+    } else if (text == "drop-until-key") {
+        *policy = WRITE_QUEUE_DROP_UNTIL_KEY;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* writeQueuePolicyName(WriteQueuePolicy policy)
+{
+    switch (policy) {
+    case WRITE_QUEUE_DROP_NONKEY: return "drop-nonkey";
+    case WRITE_QUEUE_DROP_UNTIL_KEY: return "drop-until-key";
+    default: return "block";
+    }
+}
+
+PacketWriterConfig packetWriterFromOptions(const ClientOptions& options)
+{
+    PacketWriterConfig config;
+    config.maxBytes = static_cast<int64_t>(std::max(64, options.getInt("write-queue-kb",
+                                                                       static_cast<int>(config.maxBytes / 1024)))) * 1024;
+    const std::string policy = options.get("write-full", "block");
+    if (!parseWriteQueuePolicy(policy, &config.policy)) {
+        fprintf(stderr, "Ignoring --write-full=%s, expected block, drop-nonkey or drop-until-key\n", policy.c_str());
+    }
+    return config;
+}
+
+PacketWriter::PacketWriter(const PacketWriterConfig& config, const WriteFn& write)
+    : config_(config), write_(write), queuedBytes_(0), highWaterBytes_(0),
+      finishing_(false), stopping_(false), dropping_(false), written_(0), dropped_(0), writeErrors_(0),
+      maxWriteUs_(0), blockedUs_(0)
+{
+    thread_ = std::thread(&PacketWriter::writerLoop, this);
+}
+
+PacketWriter::~PacketWriter()
+{
+    finish();
+}
+
+// An empty queue takes any packet, so one oversized keyframe cannot wedge it
+bool PacketWriter::fits(int size) const
+{
+    return queue_.empty() || queuedBytes_ + size <= config_.maxBytes;
+}
+
+// Makes room for a keyframe by dropping the newest queued non-keyframes:
+// they end the GOP this keyframe replaces, so what stays queued still
+// decodes. Whatever is left over is admitted over budget.
+void PacketWriter::evictNonKey(int size)
+{
+    while (!fits(size) && !queue_.empty() && !(queue_.back()->flags & AV_PKT_FLAG_KEY)) {
+        AVPacket* evicted = queue_.back();
+        queue_.pop_back();
+        queuedBytes_ -= evicted->size;
+        av_packet_unref(evicted);
+        spare_.push_back(evicted);
+        dropped_++;
+    }
+}
+
+bool PacketWriter::push(const AVPacket* packet, const std::atomic<bool>& running)
+{
+    const bool key = (packet->flags & AV_PKT_FLAG_KEY) != 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    // The packets after a dropped one reference it; they are useless up to the next keyframe
+    if (dropping_ && !key) {
+        dropped_++;
+        return false;
+    }
+    if (!fits(packet->size)) {
+        if (config_.policy != WRITE_QUEUE_BLOCK) {
+            // Never wait under a drop policy: a disk stall must not reach the reader
+            if (!key) {
+                dropped_++;
+                dropping_ = config_.policy == WRITE_QUEUE_DROP_UNTIL_KEY;
+                return false;
+            }
+            evictNonKey(packet->size);
+        } else {
+            // Timed, so a stop request is noticed while the disk is stuck;
+            // the signal handler cannot notify the condition variable
+            const int64_t start = av_gettime_relative();
+            while (!fits(packet->size)) {
+                if (!running.load(std::memory_order_acquire) || stopping_) {
+                    blockedUs_ += av_gettime_relative() - start;
+                    dropped_++;
+                    return false;
+                }
+                notFull_.wait_for(lock, std::chrono::milliseconds(50));
+            }
+            blockedUs_ += av_gettime_relative() - start;
+        }
+    }
+    if (key) dropping_ = false;
+
+    AVPacket* queued = nullptr;
+    if (!spare_.empty()) {
+        queued = spare_.back();
+        spare_.pop_back();
+    } else {
+        queued = av_packet_alloc();
+    }
+    if (!queued || av_packet_ref(queued, packet) < 0) {
+        if (queued) spare_.push_back(queued);
+        dropped_++;
+        return false;
+    }
+    queue_.push_back(queued);
+    queuedBytes_ += queued->size;
+    highWaterBytes_ = std::max(highWaterBytes_, queuedBytes_);
+    lock.unlock();
+    notEmpty_.notify_one();
+    return true;
+}
+
+void PacketWriter::writerLoop()
+{
+    for (;;) {
+        AVPacket* packet = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            notEmpty_.wait(lock, [this] { return finishing_ || !queue_.empty(); });
+            if (queue_.empty()) return;   // finishing, and everything is written
+            packet = queue_.front();
+            queue_.pop_front();
+        }
+
+        // The muxer takes the payload reference, so remember the size first.
+        // The bytes stay counted until the write returns: that is what the
+        // disk still owes.
+        const int size = packet->size;
+        const int64_t start = av_gettime_relative();
+        const int ret = write_(packet);
+        const int64_t us = av_gettime_relative() - start;
+        av_packet_unref(packet);
+
+        int64_t slowest = maxWriteUs_.load(std::memory_order_relaxed);
+        while (us > slowest && !maxWriteUs_.compare_exchange_weak(slowest, us)) {
+        }
+        if (ret < 0) {
+            writeErrors_++;
+        } else {
+            written_++;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            spare_.push_back(packet);
+            queuedBytes_ -= size;
+        }
+        notFull_.notify_all();
+    }
+}
+
+void PacketWriter::finish()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!thread_.joinable()) return;
+        finishing_ = true;
+        stopping_ = true;
+    }
+    notEmpty_.notify_one();
+    notFull_.notify_all();
+    thread_.join();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < spare_.size(); ++i) {
+        av_packet_free(&spare_[i]);
+    }
+    spare_.clear();
+}
+
+PacketWriter::Stats PacketWriter::stats() const
+{
+    Stats st;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        st.queuedPackets = static_cast<int64_t>(queue_.size());
+        st.queuedBytes = queuedBytes_;
+        st.highWaterBytes = highWaterBytes_;
+    }
+    st.written = written_;
+    st.dropped = dropped_;
+    st.writeErrors = writeErrors_;
+    st.maxWriteMs = maxWriteUs_ / 1000.0;
+    st.blockedMs = blockedUs_ / 1000.0;
+    return st;
+}
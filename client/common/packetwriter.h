@@ -0,0 +1,106 @@
+#ifndef PACKETWRITER_H
+#define PACKETWRITER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+class ClientOptions;
+
+// What push() does when the queue has no room for a packet
+enum WriteQueuePolicy {
+    WRITE_QUEUE_BLOCK = 0,       // wait for the writer: nothing lost, reading stalls
+    WRITE_QUEUE_DROP_NONKEY,     // drop non-keyframes while full; keyframes evict queued ones
+    WRITE_QUEUE_DROP_UNTIL_KEY   // after a drop, drop everything up to the next keyframe
+};
+
+bool parseWriteQueuePolicy(const std::string& text, WriteQueuePolicy* policy);
+const char* writeQueuePolicyName(WriteQueuePolicy policy);
+
+struct PacketWriterConfig {
+    int64_t maxBytes = 8 * 1024 * 1024;   // queued payload; a few seconds of a camera stream
+    WriteQueuePolicy policy = WRITE_QUEUE_BLOCK;
+};
+
+// --write-queue-kb=<n> and --write-full=block|drop-nonkey|drop-until-key
+PacketWriterConfig packetWriterFromOptions(const ClientOptions& options);
+
+// Moves muxer writes off the thread that reads from the network.
+//
+// push() takes a new reference to the packet (av_packet_ref, no payload
+// copy) into a queue bounded in bytes; a writer thread hands the packets
+// to the write callback in order. A slow disk or an fsync stall then only
+// fills the queue instead of stopping av_read_frame(); under the drop
+// policies push() never waits. Queue packets are recycled, so steady-state
+// pushes do not allocate.
+class PacketWriter
+{
+public:
+    // Called on the writer thread; returns a negative AVERROR on failure
+    typedef std::function<int(AVPacket*)> WriteFn;
+
+    PacketWriter(const PacketWriterConfig& config, const WriteFn& write);
+    // Drains the queue like finish()
+    ~PacketWriter();
+
+    // false when the packet was dropped by the policy. Under the block
+    // policy it waits for room, and gives up (dropping the packet) once
+    // `running` goes false or finish() was called.
+    bool push(const AVPacket* packet, const std::atomic<bool>& running);
+
+    // Writes what is queued and stops the writer thread. Call before
+    // av_write_trailer(); push() must not be called afterwards.
+    void finish();
+
+    struct Stats {
+        int64_t queuedPackets = 0;   // current depth
+        int64_t queuedBytes = 0;
+        int64_t highWaterBytes = 0;
+        int64_t written = 0;
+        int64_t dropped = 0;
+        int64_t writeErrors = 0;
+        double maxWriteMs = 0.0;     // slowest single write so far
+        double blockedMs = 0.0;      // time push() spent waiting for room
+    };
+    // Safe to call from any thread
+    Stats stats() const;
+
+private:
+    bool fits(int size) const;
+    void evictNonKey(int size);
+    void writerLoop();
+
+    PacketWriterConfig config_;
+    WriteFn write_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable notEmpty_;
+    std::condition_variable notFull_;
+    std::deque<AVPacket*> queue_;
+    std::vector<AVPacket*> spare_;   // unreferenced packets for reuse
+    int64_t queuedBytes_;
+    int64_t highWaterBytes_;
+    bool finishing_;
+    std::atomic<bool> stopping_;     // finish() called: a blocked push() gives up
+    bool dropping_;                  // drop-until-key: a packet was dropped, no keyframe yet
+
+    std::atomic<int64_t> written_;
+    std::atomic<int64_t> dropped_;
+    std::atomic<int64_t> writeErrors_;
+    std::atomic<int64_t> maxWriteUs_;
+    std::atomic<int64_t> blockedUs_;
+
+    std::thread thread_;
+};
+
+#endif // PACKETWRITER_H
@@ -0,0 +1,71 @@
+#include "reconnect.h"
+
+#include <algorithm>
+#include <cstring>
+
+extern "C" {
+#include <libavutil/channel_layout.h>
+}
+
+StreamReconnector::StreamReconnector(int initialDelayMs, int maxDelayMs)
+    : state_(CONNECTED), initialDelayMs_(initialDelayMs), maxDelayMs_(maxDelayMs),
+      currentDelayMs_(initialDelayMs),
+      rng_(static_cast<unsigned>(Clock::now().time_since_epoch().count()))
+{
+}
+
+void StreamReconnector::streamLost()
+{
+    if (state_ != CONNECTED) return;
+    state_ = WAITING;
+    stats_.drops++;
+    stats_.attempts = 0;
+    currentDelayMs_ = initialDelayMs_;
+    lostAt_ = Clock::now();
+}
+
+int StreamReconnector::nextDelayMs()
+{
+    // The first attempt goes out right away: most drops are a server restart
+    // or a short network blip, and the backoff is for the ones that are not
+    int delay = 0;
+    if (stats_.attempts > 0) {
+        std::uniform_int_distribution<int> jitter(currentDelayMs_ / 2, currentDelayMs_);
+        delay = jitter(rng_);
+        currentDelayMs_ = std::min(currentDelayMs_ * 2, maxDelayMs_);
+    }
+    stats_.attempts++;
+    state_ = CONNECTING;
+    return delay;
+}
+
+void StreamReconnector::attemptFailed()
+{
+    state_ = WAITING;
+}
+
+int64_t StreamReconnector::recovered()
+{
+    const int64_t ms = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - lostAt_).count();
+    state_ = CONNECTED;
+    stats_.recoveries++;
+    stats_.lastRecoverMs = ms;
+    stats_.maxRecoverMs = std::max(stats_.maxRecoverMs, ms);
+    stats_.totalRecoverMs += ms;
+    return ms;
+}
+
+bool sameCodecParameters(const AVCodecParameters* a, const AVCodecParameters* b)
+{
+    if (!a || !b) return false;
+    if (a->codec_type != b->codec_type || a->codec_id != b->codec_id) return false;
+    if (a->width != b->width || a->height != b->height || a->format != b->format) return false;
+    if (a->sample_rate != b->sample_rate) return false;
+    if (av_channel_layout_compare(&a->ch_layout, &b->ch_layout) != 0) return false;
+    // Parameter sets that are only sent in-band leave extradata empty on one side
+    if (a->extradata_size > 0 && b->extradata_size > 0) {
+        if (a->extradata_size != b->extradata_size) return false;
+        if (std::memcmp(a->extradata, b->extradata, a->extradata_size) != 0) return false;
+    }
+    return true;
+}
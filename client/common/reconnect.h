@@ -0,0 +1,69 @@
+#ifndef RECONNECT_H
+#define RECONNECT_H
+
+#include <chrono>
+#include <random>
+#include <stdint.h>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+// Reconnect bookkeeping shared by the clients:
+//
+//   CONNECTED --streamLost()--> WAITING --nextDelayMs()--> CONNECTING
+//       ^                          ^                           |
+//       |                          +------attemptFailed()------+
+//       +----------------------------recovered()---------------+
+//
+// Delays grow exponentially from initialDelayMs up to maxDelayMs with
+// "full jitter" (uniform in [delay/2, delay]), so a camera that drops all of
+// its viewers at once is not hit by all of them in lockstep.
+class StreamReconnector
+{
+public:
+    enum State {
+        CONNECTED,
+        WAITING,
+        CONNECTING
+    };
+
+    struct Stats {
+        int drops = 0;              // streams lost
+        int recoveries = 0;         // streams regained
+        int attempts = 0;           // reconnect attempts during the current/last outage
+        int64_t lastRecoverMs = 0;  // stream lost -> stream back
+        int64_t maxRecoverMs = 0;
+        int64_t totalRecoverMs = 0;
+    };
+
+    explicit StreamReconnector(int initialDelayMs = 100, int maxDelayMs = 5000);
+
+    State state() const { return state_; }
+    const Stats& stats() const { return stats_; }
+
+    // Starts the outage clock; the first attempt follows nextDelayMs()
+    void streamLost();
+    // Delay before the next attempt; moves to CONNECTING
+    int nextDelayMs();
+    void attemptFailed();
+    // Returns the time to recover of the outage that just ended
+    int64_t recovered();
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    State state_;
+    Stats stats_;
+    int initialDelayMs_;
+    int maxDelayMs_;
+    int currentDelayMs_;
+    Clock::time_point lostAt_;
+    std::minstd_rand rng_;
+};
+
+// Whether a decoder opened for `a` can carry on with a stream described by
+// `b` after a flush, i.e. codec, geometry, sample format and extradata agree
+bool sameCodecParameters(const AVCodecParameters* a, const AVCodecParameters* b);
+
+#endif // RECONNECT_H
@@ -0,0 +1,180 @@
+#include "segmentrecorder.h"
+#include "clientoptions.h"
+
+#include <algorithm>
+#include <cstdio>
+
+extern "C" {
+#include <libavutil/time.h>
+}
+
+SegmentConfig segmentConfigFromOptions(const ClientOptions& options)
+{
+    SegmentConfig config;
+    config.seconds = std::max(0, options.getInt("segment-seconds", 0));
+    config.maxBytes = static_cast<int64_t>(std::max(0, options.getInt("segment-mb", 0))) * 1024 * 1024;
+    config.format = options.get("segment-format", "fmp4") == "ts" ? SEGMENT_MPEGTS : SEGMENT_FMP4;
+    return config;
+}
+
+const char* segmentExtension(SegmentFormat format)
+{
+    return format == SEGMENT_MPEGTS ? ".ts" : ".mp4";
+}
+
+SegmentRecorder::SegmentRecorder(const SegmentConfig& config, const NameFn& name)
+    : config_(config), name_(name), params_(avcodec_parameters_alloc()), timeBase_(AVRational{1, 90000}),
+      current_(nullptr), startDts_(0), segmentBytes_(0), index_(0), stopping_(false),
+      segments_(0), closed_(0), openFailures_(0), bytes_(0), maxOpenUs_(0)
+{
+    closer_ = std::thread(&SegmentRecorder::closerLoop, this);
+}
+
+SegmentRecorder::~SegmentRecorder()
+{
+    close();
+    avcodec_parameters_free(&params_);
+}
+
+void SegmentRecorder::setStream(const AVCodecParameters* params, AVRational timeBase)
+{
+    avcodec_parameters_copy(params_, params);
+    params_->codec_tag = 0;
+    timeBase_ = timeBase;
+}
+
+AVFormatContext* SegmentRecorder::openSegment(const std::string& path)
+{
+    AVFormatContext* ctx = nullptr;
+    avformat_alloc_output_context2(&ctx, nullptr, config_.format == SEGMENT_MPEGTS ? "mpegts" : "mp4",
+                                   path.c_str());
+    if (!ctx) return nullptr;
+
+    AVStream* stream = avformat_new_stream(ctx, nullptr);
+    if (!stream || avcodec_parameters_copy(stream->codecpar, params_) < 0 ||
+        avio_open(&ctx->pb, path.c_str(), AVIO_FLAG_WRITE) < 0) {
+        avformat_free_context(ctx);
+        return nullptr;
+    }
+    stream->time_base = timeBase_;
+
+    AVDictionary* options = nullptr;
+    if (config_.format == SEGMENT_FMP4) {
+        // moov up front and a moof per keyframe: the file is playable as it grows
+        av_dict_set(&options, "movflags", "frag_keyframe+empty_moov+default_base_moof", 0);
+    }
+    const int ret = avformat_write_header(ctx, &options);
+    av_dict_free(&options);
+    if (ret < 0) {
+        avio_closep(&ctx->pb);
+        avformat_free_context(ctx);
+        return nullptr;
+    }
+    return ctx;
+}
+
+bool SegmentRecorder::rollover(int64_t startDts)
+{
+    const std::string path = name_(index_);
+    const int64_t start = av_gettime_relative();
+    AVFormatContext* next = openSegment(path);
+    const int64_t us = av_gettime_relative() - start;
+    if (!next) {
+        openFailures_++;
+        fprintf(stderr, "Cannot open segment %s\n", path.c_str());
+        return false;
+    }
+    int64_t slowest = maxOpenUs_.load(std::memory_order_relaxed);
+    while (us > slowest && !maxOpenUs_.compare_exchange_weak(slowest, us)) {
+    }
+
+    // The old segment is finished off in the background; packets go to the new one meanwhile
+    if (current_) {
+        {
+            std::lock_guard<std::mutex> lock(closeMutex_);
+            closing_.push_back(current_);
+        }
+        closeCond_.notify_one();
+    }
+    current_ = next;
+    startDts_ = startDts;
+    segmentBytes_ = 0;
+    index_++;
+    segments_++;
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    currentName_ = path;
+    return true;
+}
+
+int SegmentRecorder::write(AVPacket* packet)
+{
+    const bool key = (packet->flags & AV_PKT_FLAG_KEY) != 0;
+    const bool due = current_ && key &&
+                     ((config_.seconds > 0 &&
+                       (packet->dts - startDts_) * av_q2d(timeBase_) >= config_.seconds) ||
+                      (config_.maxBytes > 0 && segmentBytes_ >= config_.maxBytes));
+    // Every segment starts at a keyframe: what comes before the first one,
+    // or after a failed first open, cannot be decoded and is dropped
+    if (!current_ && !key) {
+        av_packet_unref(packet);
+        return 0;
+    }
+    // A failed open keeps the current segment going; the next keyframe tries again
+    if ((!current_ || due) && !rollover(packet->dts) && !current_) {
+        av_packet_unref(packet);
+        return AVERROR(EIO);
+    }
+
+    const int size = packet->size;
+    packet->stream_index = 0;
+    if (packet->pts != AV_NOPTS_VALUE) packet->pts -= startDts_;
+    if (packet->dts != AV_NOPTS_VALUE) packet->dts -= startDts_;
+    av_packet_rescale_ts(packet, timeBase_, current_->streams[0]->time_base);
+    segmentBytes_ += size;
+    bytes_ += size;
+    return av_interleaved_write_frame(current_, packet);
+}
+
+void SegmentRecorder::closerLoop()
+{
+    for (;;) {
+        AVFormatContext* ctx = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(closeMutex_);
+            closeCond_.wait(lock, [this] { return stopping_ || !closing_.empty(); });
+            if (closing_.empty()) return;   // stopping, and everything is closed
+            ctx = closing_.front();
+            closing_.pop_front();
+        }
+        av_write_trailer(ctx);
+        avio_closep(&ctx->pb);
+        avformat_free_context(ctx);
+        closed_++;
+    }
+}
+
+void SegmentRecorder::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(closeMutex_);
+        if (!closer_.joinable()) return;
+        if (current_) closing_.push_back(current_);
+        current_ = nullptr;
+        stopping_ = true;
+    }
+    closeCond_.notify_one();
+    closer_.join();
+}
+
+SegmentRecorder::Stats SegmentRecorder::stats() const
+{
+    Stats st;
+    st.segments = segments_;
+    st.closed = closed_;
+    st.openFailures = openFailures_;
+    st.bytes = bytes_;
+    st.maxOpenMs = maxOpenUs_ / 1000.0;
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    st.current = currentName_;
+    return st;
+}
@@ -0,0 +1,112 @@
+#ifndef SEGMENTRECORDER_H
+#define SEGMENTRECORDER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <stdint.h>
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+class ClientOptions;
+
+enum SegmentFormat {
+    SEGMENT_FMP4 = 0,   // fragmented MP4: a fragment per keyframe, playable without a trailer
+    SEGMENT_MPEGTS
+};
+
+struct SegmentConfig {
+    int seconds = 0;           // start a new segment after this much media time, 0 = no limit
+    int64_t maxBytes = 0;      // or after this much payload, 0 = no limit
+    SegmentFormat format = SEGMENT_FMP4;
+
+    bool enabled() const { return seconds > 0 || maxBytes > 0; }
+};
+
+// --segment-seconds=<n>, --segment-mb=<n> and --segment-format=fmp4|ts
+SegmentConfig segmentConfigFromOptions(const ClientOptions& options);
+
+// ".mp4" or ".ts"
+const char* segmentExtension(SegmentFormat format);
+
+// Records one video stream into a series of files, each starting at a
+// keyframe once the previous one reached the time or size limit.
+//
+// Segments are written as fragmented MP4 or MPEG-TS, so a crash costs at
+// most the fragment being written rather than the whole recording. At a
+// boundary the next file is opened and written to right away; trailer and
+// close of the previous one run on a background thread. Timestamps start
+// at zero in every segment.
+class SegmentRecorder
+{
+public:
+    // File name for the segment with this index (0, 1, ...)
+    typedef std::function<std::string(int index)> NameFn;
+
+    SegmentRecorder(const SegmentConfig& config, const NameFn& name);
+    // Closes like close()
+    ~SegmentRecorder();
+
+    // Stream layout of every segment and the time base of the packets that
+    // write() receives. Call before the first write().
+    void setStream(const AVCodecParameters* params, AVRational timeBase);
+
+    // Writes one packet, rolling over first when it is a keyframe and the
+    // current segment is due. Packets before the first keyframe are
+    // dropped. Takes the packet's reference like
+    // av_interleaved_write_frame(). Call from one thread only.
+    int write(AVPacket* packet);
+
+    // Finalizes the current segment and waits until every segment is closed
+    void close();
+
+    struct Stats {
+        int segments = 0;           // opened so far
+        int closed = 0;
+        int openFailures = 0;
+        int64_t bytes = 0;          // payload over all segments
+        double maxOpenMs = 0.0;     // slowest segment open (file creation + header)
+        std::string current;        // file being written
+    };
+    // Safe to call from any thread
+    Stats stats() const;
+
+private:
+    AVFormatContext* openSegment(const std::string& path);
+    bool rollover(int64_t startDts);
+    void closerLoop();
+
+    SegmentConfig config_;
+    NameFn name_;
+    AVCodecParameters* params_;
+    AVRational timeBase_;
+
+    // Writer thread only
+    AVFormatContext* current_;
+    int64_t startDts_;
+    int64_t segmentBytes_;
+    int index_;
+
+    // Segments waiting for trailer and close
+    std::mutex closeMutex_;
+    std::condition_variable closeCond_;
+    std::deque<AVFormatContext*> closing_;
+    bool stopping_;
+    std::thread closer_;
+
+    mutable std::mutex statsMutex_;
+    std::string currentName_;
+    std::atomic<int> segments_;
+    std::atomic<int> closed_;
+    std::atomic<int> openFailures_;
+    std::atomic<int64_t> bytes_;
+    std::atomic<int64_t> maxOpenUs_;
+};
+
+#endif // SEGMENTRECORDER_H
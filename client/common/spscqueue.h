@@ -0,0 +1,139 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+// Bounded single-producer/single-consumer ring.
+// The data path (tryPush/tryPop) is lock-free; the mutex/condvar pair is only
+// touched when one side has to sleep because the ring is full or empty.
+template <typename T>
+class SpscQueue
+{
+public:
+    explicit SpscQueue(size_t capacity)
+        : slots_(roundUpPow2(capacity)), mask_(slots_.size() - 1),
+          capacity_(capacity), head_(0), tail_(0), highWater_(0), waiters_(0)
+    {
+    }
+
+    size_t capacity() const { return capacity_; }
+
+    // Current number of queued items (approximate when read from a third thread)
+    size_t depth() const
+    {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    // Largest depth ever observed by the producer
+    size_t highWater() const { return highWater_.load(std::memory_order_relaxed); }
+
+    bool tryPush(const T &value)
+    {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t head = head_.load(std::memory_order_acquire);
+        if (tail - head >= capacity_) return false;
+
+        slots_[tail & mask_] = value;
+        tail_.store(tail + 1, std::memory_order_release);
+
+        size_t depth = tail + 1 - head;
+        if (depth > highWater_.load(std::memory_order_relaxed)) {
+            highWater_.store(depth, std::memory_order_relaxed);
+        }
+        notify();
+        return true;
+    }
+
+    bool tryPop(T &value)
+    {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        const size_t tail = tail_.load(std::memory_order_acquire);
+        if (head == tail) return false;
+
+        value = slots_[head & mask_];
+        head_.store(head + 1, std::memory_order_release);
+        notify();
+        return true;
+    }
+
+    // Blocks while the ring is full. Returns false once `running` goes false.
+    bool push(const T &value, const std::atomic<bool> &running)
+    {
+        while (!tryPush(value)) {
+            if (!running.load(std::memory_order_acquire)) return false;
+            waitUntil([this]() { return depth() < capacity_; }, running);
+        }
+        return true;
+    }
+
+    // Blocks while the ring is empty. Returns false once `running` goes false.
+    bool pop(T &value, const std::atomic<bool> &running)
+    {
+        while (!tryPop(value)) {
+            if (!running.load(std::memory_order_acquire)) return false;
+            waitUntil([this]() { return depth() > 0; }, running);
+        }
+        return true;
+    }
+
+    // Wakes any sleeping side so it can re-check its running flag
+    void wakeAll()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cond_.notify_all();
+    }
+
+private:
+    static size_t roundUpPow2(size_t n)
+    {
+        size_t v = 1;
+        while (v < n) v <<= 1;
+        return v;
+    }
+
+    void notify()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters_.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            cond_.notify_all();
+        }
+    }
+
+    template <typename Pred>
+    void waitUntil(Pred ready, const std::atomic<bool> &running)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        waiters_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        // The timeout only bounds the cost of a missed wakeup; it is not a poll interval
+        if (!ready() && running.load(std::memory_order_acquire)) {
+            cond_.wait_for(lock, std::chrono::milliseconds(50));
+        }
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    std::vector<T> slots_;
+    const size_t mask_;
+    const size_t capacity_;
+
+    // Keep the two indices on separate cache lines. Explicit padding rather than
+    // alignas(64), which plain operator new does not honour before C++17.
+    char padHead_[64];
+    std::atomic<size_t> head_;
+    char padTail_[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> tail_;
+    char padEnd_[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> highWater_;
+
+    std::atomic<int> waiters_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+};
+
+#endif // SPSCQUEUE_H
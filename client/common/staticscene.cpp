@@ -0,0 +1,125 @@
+#include "staticscene.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define STATIC_HAVE_SSE2 1
+#else
+#define STATIC_HAVE_SSE2 0
+#endif
+
+namespace {
+
+const int kBlockSize = 16;
+const int kRowsPerBlock = 4;        // rows 0, 4, 8 and 12 of each block
+const int kSamplesPerBlock = kBlockSize * kRowsPerBlock;
+// Mean absolute difference per sampled pixel that still counts as noise
+const int kNoisePerPixel = 4;
+const unsigned kBlockThreshold = kSamplesPerBlock * kNoisePerPixel;
+// Convert at least every 10 s at 25 fps even when nothing seems to move
+const int kMaxSkippedInRow = 250;
+
+bool isSupported(int format)
+{
+    switch (format) {
+    case AV_PIX_FMT_YUV420P:
+    case AV_PIX_FMT_YUVJ420P:
+    case AV_PIX_FMT_YUV422P:
+    case AV_PIX_FMT_YUVJ422P:
+    case AV_PIX_FMT_YUV444P:
+    case AV_PIX_FMT_YUVJ444P:
+    case AV_PIX_FMT_NV12:
+    case AV_PIX_FMT_NV21:
+        return true;
+    default:
+        return false;
+    }
+}
+
+inline unsigned sad16(const uint8_t* a, const uint8_t* b)
+{
+#if STATIC_HAVE_SSE2
+    __m128i sad = _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a)),
+                               _mm_loadu_si128(reinterpret_cast<const __m128i*>(b)));
+    return static_cast<unsigned>(_mm_cvtsi128_si32(sad) + _mm_extract_epi16(sad, 4));
+#else
+    unsigned sum = 0;
+    for (int i = 0; i < kBlockSize; ++i) {
+        sum += std::abs(a[i] - b[i]);
+    }
+    return sum;
+#endif
+}
+
+inline const uint8_t* sampleRow(const AVFrame* frame, int bx, int by, int r)
+{
+    return frame->data[0] + (by * kBlockSize + r * (kBlockSize / kRowsPerBlock)) * frame->linesize[0] +
+           bx * kBlockSize;
+}
+
+} // namespace
+
+StaticSceneDetector::StaticSceneDetector()
+    : width_(0), height_(0), valid_(false), skippedInRow_(0)
+{
+}
+
+bool StaticSceneDetector::unchanged(const AVFrame* frame)
+{
+    if (!isSupported(frame->format) || frame->width < kBlockSize || frame->height < kBlockSize) {
+        valid_ = false;
+        return false;
+    }
+
+    if (valid_ && frame->width == width_ && frame->height == height_ &&
+        skippedInRow_ < kMaxSkippedInRow && compare(frame)) {
+        skippedInRow_++;
+        return true;
+    }
+
+    capture(frame);
+    skippedInRow_ = 0;
+    return false;
+}
+
+bool StaticSceneDetector::compare(const AVFrame* frame) const
+{
+    const int blocksX = width_ / kBlockSize;
+    const int blocksY = height_ / kBlockSize;
+    const uint8_t* ref = reference_.data();
+
+    for (int by = 0; by < blocksY; ++by) {
+        for (int bx = 0; bx < blocksX; ++bx) {
+            unsigned sad = 0;
+            for (int r = 0; r < kRowsPerBlock; ++r) {
+                sad += sad16(sampleRow(frame, bx, by, r), ref);
+                ref += kBlockSize;
+            }
+            // One block is enough: stop at the first sign of motion
+            if (sad > kBlockThreshold) return false;
+        }
+    }
+    return true;
+}
+
+void StaticSceneDetector::capture(const AVFrame* frame)
+{
+    width_ = frame->width;
+    height_ = frame->height;
+    const int blocksX = width_ / kBlockSize;
+    const int blocksY = height_ / kBlockSize;
+    reference_.resize(static_cast<size_t>(blocksX) * blocksY * kSamplesPerBlock);
+
+    uint8_t* ref = reference_.data();
+    for (int by = 0; by < blocksY; ++by) {
+        for (int bx = 0; bx < blocksX; ++bx) {
+            for (int r = 0; r < kRowsPerBlock; ++r) {
+                memcpy(ref, sampleRow(frame, bx, by, r), kBlockSize);
+                ref += kBlockSize;
+            }
+        }
+    }
+    valid_ = true;
+}
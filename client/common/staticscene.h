@@ -0,0 +1,43 @@
+#ifndef STATICSCENE_H
+#define STATICSCENE_H
+
+#include <stdint.h>
+#include <vector>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+// Tells whether a decoded frame looks the same as the last one that was
+// shown, so that conversion and repaint can be skipped on static scenes.
+//
+// Luma is compared on a grid of 16x16 blocks, four rows (every fourth) per
+// block, with SSE2 SAD where available. A frame is unchanged only when every
+// sampled block stays within encoder/sensor noise of the reference, which is
+// the last frame reported as changed; comparing against that rather than the
+// previous frame keeps slow drift from going unnoticed forever. A refresh is
+// also forced after a while so nothing can stay stale indefinitely.
+class StaticSceneDetector
+{
+public:
+    StaticSceneDetector();
+
+    // False for the first frame, any non 8-bit YUV frame, a size change and
+    // anything that moved; the frame then becomes the new reference
+    bool unchanged(const AVFrame* frame);
+
+    // The next frame counts as changed, e.g. because the output changed
+    void invalidate() { valid_ = false; }
+
+private:
+    bool compare(const AVFrame* frame) const;
+    void capture(const AVFrame* frame);
+
+    std::vector<uint8_t> reference_;
+    int width_;
+    int height_;
+    bool valid_;
+    int skippedInRow_;
+};
+
+#endif // STATICSCENE_H
@@ -0,0 +1,291 @@
+#include "streamcache.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/mem.h>
+}
+
+namespace {
+
+// Enough for one RTP packet of every stream; the cache supplies the rest
+const int64_t kCachedProbeSize = 32 * 1024;
+const int64_t kCachedAnalyzeDuration = AV_TIME_BASE / 5;
+
+typedef std::map<std::string, std::string> Entry;
+
+uint64_t fnv1a(const std::string& text, uint64_t hash = 1469598103934665603ULL)
+{
+    for (size_t i = 0; i < text.size(); ++i) {
+        hash ^= static_cast<unsigned char>(text[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Second, independent hash of the URL stored in the entry. Telling file name
+// collisions apart this way keeps URLs (and the credentials in them) off disk.
+std::string urlKey(const std::string& url)
+{
+    char key[17];
+    std::snprintf(key, sizeof(key), "%016llx",
+                  static_cast<unsigned long long>(fnv1a(url, 0x9e3779b97f4a7c15ULL)));
+    return key;
+}
+
+std::string toHex(const uint8_t* data, int size)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string out;
+    out.reserve(size * 2);
+    for (int i = 0; i < size; ++i) {
+        out += digits[data[i] >> 4];
+        out += digits[data[i] & 0x0f];
+    }
+    return out;
+}
+
+bool fromHex(const std::string& hex, std::vector<uint8_t>& out)
+{
+    if (hex.size() % 2) return false;
+    out.resize(hex.size() / 2);
+    for (size_t i = 0; i < out.size(); ++i) {
+        char byte[3] = { hex[2 * i], hex[2 * i + 1], 0 };
+        char* end = nullptr;
+        out[i] = static_cast<uint8_t>(std::strtoul(byte, &end, 16));
+        if (*end) return false;
+    }
+    return true;
+}
+
+bool makeDirs(const std::string& path)
+{
+    for (size_t pos = 1; pos <= path.size(); ++pos) {
+        if (pos == path.size() || path[pos] == '/') {
+            std::string part = path.substr(0, pos);
+            if (mkdir(part.c_str(), 0700) != 0 && errno != EEXIST) return false;
+        }
+    }
+    // Tighten a directory left over from a version that created it world-readable
+    struct stat info;
+    if (stat(path.c_str(), &info) == 0 && (info.st_mode & 077)) chmod(path.c_str(), 0700);
+    return true;
+}
+
+// Private to the user from the start: no window in which the entry is readable by others
+bool writePrivateFile(const std::string& path, const std::string& data)
+{
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) return false;
+    // O_CREAT's mode does not apply to a stale file that already existed
+    bool ok = fchmod(fd, 0600) == 0;
+    for (size_t done = 0; ok && done < data.size();) {
+        ssize_t n = write(fd, data.data() + done, data.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        ok = n > 0;
+        if (ok) done += static_cast<size_t>(n);
+    }
+    return close(fd) == 0 && ok;
+}
+
+bool readEntry(const std::string& path, Entry& entry)
+{
+    std::ifstream in(path.c_str());
+    if (!in) return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::string::size_type eq = line.find('=');
+        if (eq != std::string::npos) entry[line.substr(0, eq)] = line.substr(eq + 1);
+    }
+    return !entry.empty();
+}
+
+std::string field(const Entry& entry, const std::string& key)
+{
+    Entry::const_iterator it = entry.find(key);
+    return it == entry.end() ? std::string() : it->second;
+}
+
+int64_t intField(const Entry& entry, const std::string& key)
+{
+    return std::strtoll(field(entry, key).c_str(), nullptr, 10);
+}
+
+std::string streamKey(unsigned int index, const char* name)
+{
+    std::ostringstream oss;
+    oss << "stream" << index << "." << name;
+    return oss.str();
+}
+
+AVRational rationalField(const Entry& entry, const std::string& key)
+{
+    AVRational r = { 0, 1 };
+    std::string text = field(entry, key);
+    std::string::size_type slash = text.find('/');
+    if (slash != std::string::npos) {
+        r.num = std::atoi(text.substr(0, slash).c_str());
+        r.den = std::atoi(text.substr(slash + 1).c_str());
+    }
+    return r;
+}
+
+} // namespace
+
+std::string StreamParamCache::defaultDirectory()
+{
+    const char* xdg = std::getenv("XDG_CACHE_HOME");
+    if (xdg && *xdg) return std::string(xdg) + "/rtsp_client";
+    const char* home = std::getenv("HOME");
+    if (home && *home) return std::string(home) + "/.cache/rtsp_client";
+    return ".rtsp_client_cache";
+}
+
+StreamParamCache::StreamParamCache(const std::string& directory)
+    : directory_(directory)
+{
+}
+
+std::string StreamParamCache::pathFor(const std::string& url) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.stream", static_cast<unsigned long long>(fnv1a(url)));
+    return directory_ + "/" + name;
+}
+
+int StreamParamCache::findStreamInfo(AVFormatContext* ctx, const std::string& url, bool* cacheHit)
+{
+    if (cacheHit) *cacheHit = false;
+
+    if (apply(url, ctx)) {
+        const int64_t probeSize = ctx->probesize;
+        const int64_t analyzeDuration = ctx->max_analyze_duration;
+        ctx->probesize = kCachedProbeSize;
+        ctx->max_analyze_duration = kCachedAnalyzeDuration;
+        int ret = avformat_find_stream_info(ctx, nullptr);
+        ctx->probesize = probeSize;
+        ctx->max_analyze_duration = analyzeDuration;
+        if (ret >= 0) {
+            if (cacheHit) *cacheHit = true;
+            return ret;
+        }
+        // Packets read so far stay buffered, so the full probe below starts from them
+        remove(url);
+    }
+
+    int ret = avformat_find_stream_info(ctx, nullptr);
+    if (ret >= 0) {
+        store(url, ctx);
+    }
+    return ret;
+}
+
+bool StreamParamCache::apply(const std::string& url, AVFormatContext* ctx)
+{
+    Entry entry;
+    if (!readEntry(pathFor(url), entry)) return false;
+    if (field(entry, "key") != urlKey(url)) return false;  // hash collision
+    if (intField(entry, "streams") != static_cast<int64_t>(ctx->nb_streams)) return false;
+
+    // Check everything first: a partial apply would leave the streams inconsistent
+    std::vector<std::vector<uint8_t> > extradata(ctx->nb_streams);
+    for (unsigned int i = 0; i < ctx->nb_streams; ++i) {
+        const AVCodecParameters* par = ctx->streams[i]->codecpar;
+        if (intField(entry, streamKey(i, "type")) != par->codec_type) return false;
+        if (intField(entry, streamKey(i, "codec_id")) != par->codec_id) return false;
+        if (!fromHex(field(entry, streamKey(i, "extradata")), extradata[i])) return false;
+        // In-band parameter sets (sprop-parameter-sets) that changed mean a new encoder setup
+        if (par->extradata_size > 0 &&
+            (extradata[i].size() != static_cast<size_t>(par->extradata_size) ||
+             std::memcmp(extradata[i].data(), par->extradata, par->extradata_size) != 0)) {
+            return false;
+        }
+    }
+
+    for (unsigned int i = 0; i < ctx->nb_streams; ++i) {
+        AVStream* st = ctx->streams[i];
+        AVCodecParameters* par = st->codecpar;
+        par->format = static_cast<int>(intField(entry, streamKey(i, "format")));
+        par->profile = static_cast<int>(intField(entry, streamKey(i, "profile")));
+        par->level = static_cast<int>(intField(entry, streamKey(i, "level")));
+        par->width = static_cast<int>(intField(entry, streamKey(i, "width")));
+        par->height = static_cast<int>(intField(entry, streamKey(i, "height")));
+        par->sample_rate = static_cast<int>(intField(entry, streamKey(i, "sample_rate")));
+        const std::string layoutText = field(entry, streamKey(i, "ch_layout"));
+        if (!layoutText.empty()) {
+            AVChannelLayout layout;
+            std::memset(&layout, 0, sizeof(layout));
+            if (av_channel_layout_from_string(&layout, layoutText.c_str()) == 0) {
+                av_channel_layout_uninit(&par->ch_layout);
+                av_channel_layout_copy(&par->ch_layout, &layout);
+            }
+            av_channel_layout_uninit(&layout);
+        }
+        par->frame_size = static_cast<int>(intField(entry, streamKey(i, "frame_size")));
+        par->sample_aspect_ratio = rationalField(entry, streamKey(i, "sar"));
+        st->avg_frame_rate = rationalField(entry, streamKey(i, "avg_frame_rate"));
+        st->r_frame_rate = rationalField(entry, streamKey(i, "r_frame_rate"));
+
+        if (par->extradata_size == 0 && !extradata[i].empty()) {
+            par->extradata = static_cast<uint8_t*>(av_mallocz(extradata[i].size() + AV_INPUT_BUFFER_PADDING_SIZE));
+            if (!par->extradata) return false;
+            std::memcpy(par->extradata, extradata[i].data(), extradata[i].size());
+            par->extradata_size = static_cast<int>(extradata[i].size());
+        }
+    }
+    return true;
+}
+
+bool StreamParamCache::store(const std::string& url, const AVFormatContext* ctx)
+{
+    if (!makeDirs(directory_)) return false;
+
+    std::ostringstream oss;
+    oss << "key=" << urlKey(url) << "\n";
+    oss << "streams=" << ctx->nb_streams << "\n";
+    for (unsigned int i = 0; i < ctx->nb_streams; ++i) {
+        const AVStream* st = ctx->streams[i];
+        const AVCodecParameters* par = st->codecpar;
+        // e.g. "stereo", "5.1(side)" or "2 channels"; av_channel_layout_from_string() reads all of them
+        char layout[128] = "";
+        if (par->ch_layout.nb_channels > 0) av_channel_layout_describe(&par->ch_layout, layout, sizeof(layout));
+        oss << streamKey(i, "type") << "=" << par->codec_type << "\n"
+            << streamKey(i, "codec_id") << "=" << par->codec_id << "\n"
+            << streamKey(i, "format") << "=" << par->format << "\n"
+            << streamKey(i, "profile") << "=" << par->profile << "\n"
+            << streamKey(i, "level") << "=" << par->level << "\n"
+            << streamKey(i, "width") << "=" << par->width << "\n"
+            << streamKey(i, "height") << "=" << par->height << "\n"
+            << streamKey(i, "sample_rate") << "=" << par->sample_rate << "\n"
+            << streamKey(i, "ch_layout") << "=" << layout << "\n"
+            << streamKey(i, "frame_size") << "=" << par->frame_size << "\n"
+            << streamKey(i, "sar") << "=" << par->sample_aspect_ratio.num << "/" << par->sample_aspect_ratio.den << "\n"
+            << streamKey(i, "avg_frame_rate") << "=" << st->avg_frame_rate.num << "/" << st->avg_frame_rate.den << "\n"
+            << streamKey(i, "r_frame_rate") << "=" << st->r_frame_rate.num << "/" << st->r_frame_rate.den << "\n"
+            << streamKey(i, "extradata") << "=" << toHex(par->extradata, par->extradata_size) << "\n";
+    }
+
+    // Write-then-rename so a concurrent reader never sees half an entry
+    const std::string path = pathFor(url);
+    const std::string tmp = path + ".tmp";
+    if (!writePrivateFile(tmp, oss.str())) return false;
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+void StreamParamCache::remove(const std::string& url)
+{
+    std::remove(pathFor(url).c_str());
+}
@@ -0,0 +1,44 @@
+#ifndef STREAMCACHE_H
+#define STREAMCACHE_H
+
+#include <string>
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+// On-disk cache of the codec parameters found by the last full
+// avformat_find_stream_info() for a URL, one small text file per URL.
+//
+// A full probe reads up to probesize bytes / max_analyze_duration of stream
+// before the first packet reaches the decoder. For a camera we have seen
+// before the demuxer already knows the stream layout from the SDP, so the
+// cached width, pixel format, frame rate and extradata are filled in and a
+// tiny probe only has to see one packet per stream.
+class StreamParamCache
+{
+public:
+    // $XDG_CACHE_HOME/rtsp_client, else ~/.cache/rtsp_client
+    static std::string defaultDirectory();
+
+    explicit StreamParamCache(const std::string& directory = defaultDirectory());
+
+    // Drop-in for avformat_find_stream_info() on a freshly opened input.
+    // Uses the cached parameters when the input still matches them (same
+    // streams and codecs, same in-band extradata) and falls back to a full
+    // probe otherwise. A successful full probe refreshes the cache.
+    int findStreamInfo(AVFormatContext* ctx, const std::string& url, bool* cacheHit);
+
+    // Forget a URL, e.g. when the first decoded frame contradicts the cache
+    void remove(const std::string& url);
+
+    bool store(const std::string& url, const AVFormatContext* ctx);
+
+private:
+    std::string pathFor(const std::string& url) const;
+    bool apply(const std::string& url, AVFormatContext* ctx);
+
+    std::string directory_;
+};
+
+#endif // STREAMCACHE_H
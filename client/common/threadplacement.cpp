@@ -0,0 +1,501 @@
+#include "threadplacement.h"
+#include "clientoptions.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <set>
+#include <sstream>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+struct RoleNames {
+    const char* key;
+    const char* threadName;
+};
+
+// The GUI runs on the main thread, whose name is the process name in ps,
+// so it keeps it
+const RoleNames kRoleNames[THREAD_ROLE_COUNT] = {
+    { "demux", "rtsp-demux" },
+    { "decode", "rtsp-vdecode" },
+    { "filter", "rtsp-filter" },
+    { "convert", "rtsp-convert" },
+    { "audio", "rtsp-adecode" },
+    { "asr", "rtsp-asr" },
+    { "gui", "" },
+};
+
+const int kDefaultFifoPriority = 10;
+
+// Nothing above this can go into a cpu_set_t, so a list naming it is rejected
+#ifdef __linux__
+const long kMaxCpus = CPU_SETSIZE;
+#else
+const long kMaxCpus = 1024;
+#endif
+
+// Threads that called applyThreadPlacement(), by tid
+std::mutex gRegistryMutex;
+std::map<int, int> gRegisteredTids;
+
+bool parseSchedPolicy(const std::string& text, ThreadSchedPolicy* policy, int* priority)
+{
+    std::string name = text;
+    std::string prio;
+    std::string::size_type colon = text.find(':');
+    if (colon != std::string::npos) {
+        name = text.substr(0, colon);
+        prio = text.substr(colon + 1);
+    }
+
+    if (name == "other" || name == "normal") *policy = THREAD_SCHED_OTHER;
+    else if (name == "batch") *policy = THREAD_SCHED_BATCH;
+    else if (name == "idle") *policy = THREAD_SCHED_IDLE;
+    else if (name == "fifo") *policy = THREAD_SCHED_FIFO;
+    else if (name == "rr") *policy = THREAD_SCHED_RR;
+    else return false;
+
+    *priority = 0;
+    if (*policy == THREAD_SCHED_FIFO || *policy == THREAD_SCHED_RR) {
+        *priority = prio.empty() ? kDefaultFifoPriority : std::atoi(prio.c_str());
+        if (*priority < 1 || *priority > 99) return false;
+    }
+    return true;
+}
+
+const char* schedPolicyName(ThreadSchedPolicy policy)
+{
+    switch (policy) {
+    case THREAD_SCHED_OTHER: return "other";
+    case THREAD_SCHED_BATCH: return "batch";
+    case THREAD_SCHED_IDLE:  return "idle";
+    case THREAD_SCHED_FIFO:  return "fifo";
+    case THREAD_SCHED_RR:    return "rr";
+    default:                 return "inherit";
+    }
+}
+
+std::string formatCpuList(const std::vector<int>& cpus)
+{
+    std::ostringstream out;
+    for (size_t i = 0; i < cpus.size();) {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) ++j;
+        if (i) out << ',';
+        out << cpus[i];
+        if (j > i) out << '-' << cpus[j];
+        i = j + 1;
+    }
+    return out.str();
+}
+
+// CPUs the calling thread may run on
+std::vector<int> allowedCpus()
+{
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+        }
+    }
+#endif
+    return cpus;
+}
+
+void appendError(std::string* error, const std::string& text)
+{
+    if (!error) return;
+    if (!error->empty()) *error += "; ";
+    *error += text;
+}
+
+int64_t nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Taken on the main thread during static initialization, before any
+// placement: what settings a role leaves out go back to
+const ThreadPlacement gStartupPlacement = currentThreadPlacement();
+
+} // namespace
+
+const char* threadRoleKey(ThreadRole role)
+{
+    return role < THREAD_ROLE_COUNT ? kRoleNames[role].key : "other";
+}
+
+const char* threadRoleThreadName(ThreadRole role)
+{
+    return role < THREAD_ROLE_COUNT ? kRoleNames[role].threadName : "";
+}
+
+bool parseCpuList(const std::string& text, std::vector<int>* cpus)
+{
+    std::set<int> result;
+    std::istringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        if (item.empty()) return false;
+        char* end = nullptr;
+        long first = std::strtol(item.c_str(), &end, 10);
+        long last = first;
+        if (end == item.c_str() || first < 0) return false;
+        if (*end == '-') {
+            const char* rest = end + 1;
+            last = std::strtol(rest, &end, 10);
+            if (end == rest || last < first) return false;
+        }
+        if (*end != '\0' || last >= kMaxCpus) return false;
+        for (long cpu = first; cpu <= last; ++cpu) result.insert(static_cast<int>(cpu));
+    }
+    if (result.empty()) return false;
+    cpus->assign(result.begin(), result.end());
+    return true;
+}
+
+std::string describeThreadPlacement(const ThreadPlacement& placement)
+{
+    std::ostringstream out;
+    if (!placement.cpus.empty()) out << "cpus " << formatCpuList(placement.cpus);
+    if (placement.setNice) out << (out.tellp() > 0 ? " " : "") << "nice " << placement.nice;
+    if (placement.policy != THREAD_SCHED_INHERIT) {
+        out << (out.tellp() > 0 ? " " : "") << schedPolicyName(placement.policy);
+        if (placement.priority > 0) out << ':' << placement.priority;
+    }
+    std::string text = out.str();
+    return text.empty() ? "default" : text;
+}
+
+ThreadPlacementConfig threadPlacementFromOptions(const ClientOptions& options)
+{
+    ThreadPlacementConfig config;
+    for (int r = 0; r < THREAD_ROLE_COUNT; ++r) {
+        ThreadPlacement& placement = config.roles[r];
+        const std::string key = kRoleNames[r].key;
+
+        std::string cpus = options.get("cpus-" + key);
+        if (!cpus.empty() && !parseCpuList(cpus, &placement.cpus)) {
+            fprintf(stderr, "Ignoring --cpus-%s=%s, expected a CPU list below %ld such as 0-3,8\n",
+                    key.c_str(), cpus.c_str(), kMaxCpus);
+            placement.cpus.clear();
+        }
+        if (options.has("nice-" + key)) {
+            placement.setNice = true;
+            placement.nice = std::max(-20, std::min(19, options.getInt("nice-" + key, 0)));
+        }
+        std::string sched = options.get("sched-" + key);
+        if (!sched.empty() && !parseSchedPolicy(sched, &placement.policy, &placement.priority)) {
+            fprintf(stderr, "Ignoring --sched-%s=%s, expected other, batch, idle, fifo[:1-99] or rr[:1-99]\n",
+                    key.c_str(), sched.c_str());
+            placement.policy = THREAD_SCHED_INHERIT;
+            placement.priority = 0;
+        }
+    }
+
+    // Keep ASR off the demux/decode cores unless told otherwise
+    ThreadPlacement& asr = config.roles[THREAD_ROLE_ASR];
+    if (asr.cpus.empty()) {
+        std::set<int> busy;
+        const ThreadRole pinned[] = { THREAD_ROLE_DEMUX, THREAD_ROLE_VIDEO_DECODE, THREAD_ROLE_AUDIO_DECODE };
+        for (ThreadRole role : pinned) {
+            busy.insert(config.roles[role].cpus.begin(), config.roles[role].cpus.end());
+        }
+        if (!busy.empty()) {
+            for (int cpu : allowedCpus()) {
+                if (!busy.count(cpu)) asr.cpus.push_back(cpu);
+            }
+        }
+    }
+
+    int asrThreads = 4;
+    if (!asr.cpus.empty()) asrThreads = std::min<int>(asrThreads, static_cast<int>(asr.cpus.size()));
+    config.asrThreads = std::max(1, options.getInt("asr-threads", asrThreads));
+    return config;
+}
+
+ThreadPlacement currentThreadPlacement()
+{
+    ThreadPlacement placement;
+#ifdef __linux__
+    // sched_getaffinity(0) is the calling thread's mask
+    placement.cpus = allowedCpus();
+
+    sched_param param;
+    memset(&param, 0, sizeof(param));
+    sched_getparam(0, &param);
+    switch (sched_getscheduler(0)) {
+    case SCHED_BATCH: placement.policy = THREAD_SCHED_BATCH; break;
+    case SCHED_IDLE:  placement.policy = THREAD_SCHED_IDLE; break;
+    case SCHED_FIFO:  placement.policy = THREAD_SCHED_FIFO; placement.priority = param.sched_priority; break;
+    case SCHED_RR:    placement.policy = THREAD_SCHED_RR; placement.priority = param.sched_priority; break;
+    default:          placement.policy = THREAD_SCHED_OTHER; break;
+    }
+
+    // -1 is a valid nice value; only errno tells a failure apart
+    errno = 0;
+    const int nice = getpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)));
+    if (errno == 0) {
+        placement.setNice = true;
+        placement.nice = nice;
+    }
+#endif
+    return placement;
+}
+
+bool applyThreadPlacement(ThreadRole role, const ThreadPlacement& placement, std::string* error)
+{
+#ifdef __linux__
+    const int tid = static_cast<int>(syscall(SYS_gettid));
+    {
+        std::lock_guard<std::mutex> lock(gRegistryMutex);
+        gRegisteredTids[tid] = role;
+    }
+
+    const char* name = threadRoleThreadName(role);
+    if (name && *name) {
+        pthread_setname_np(pthread_self(), name);
+    }
+
+    bool ok = true;
+    const std::vector<int>& cpus = placement.cpus.empty() ? gStartupPlacement.cpus : placement.cpus;
+    if (!cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus) {
+            if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+        }
+        // pid 0 is the calling thread, not the whole process
+        if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+            appendError(error, std::string("affinity ") + formatCpuList(cpus) + ": " + strerror(errno));
+            ok = false;
+        }
+    }
+
+    const ThreadPlacement& sched = placement.policy != THREAD_SCHED_INHERIT ? placement : gStartupPlacement;
+    if (sched.policy != THREAD_SCHED_INHERIT) {
+        int policy = SCHED_OTHER;
+        switch (sched.policy) {
+        case THREAD_SCHED_BATCH: policy = SCHED_BATCH; break;
+        case THREAD_SCHED_IDLE:  policy = SCHED_IDLE; break;
+        case THREAD_SCHED_FIFO:  policy = SCHED_FIFO; break;
+        case THREAD_SCHED_RR:    policy = SCHED_RR; break;
+        default: break;
+        }
+        sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = sched.priority;
+        if (sched_setscheduler(0, policy, &param) != 0) {
+            appendError(error, std::string("policy ") + schedPolicyName(sched.policy) + ": " + strerror(errno));
+            ok = false;
+        }
+    }
+
+    // Nice values are per thread on Linux
+    const ThreadPlacement& nice = placement.setNice ? placement : gStartupPlacement;
+    if (nice.setNice && setpriority(PRIO_PROCESS, tid, nice.nice) != 0) {
+        appendError(error, std::string("nice ") + std::to_string(nice.nice) + ": " + strerror(errno));
+        ok = false;
+    }
+    return ok;
+#else
+    (void)role;
+    const bool requested = !placement.cpus.empty() || placement.setNice || placement.policy != THREAD_SCHED_INHERIT;
+    if (requested) appendError(error, "thread placement is only supported on Linux");
+    return !requested;
+#endif
+}
+
+ThreadCpuMonitor::ThreadCpuMonitor()
+    : lastSampleUs_(0)
+{
+    for (int r = 0; r <= THREAD_ROLE_COUNT; ++r) {
+        exitedTicks_[r] = 0;
+        lastTicks_[r] = 0;
+    }
+}
+
+void ThreadCpuMonitor::sample()
+{
+#ifdef __linux__
+    static const long ticksPerSecond = sysconf(_SC_CLK_TCK);
+
+    std::map<int, int> registered;
+    {
+        std::lock_guard<std::mutex> lock(gRegistryMutex);
+        registered = gRegisteredTids;
+    }
+
+    std::map<int, TaskTime> current;
+    int threads[THREAD_ROLE_COUNT + 1] = {};
+    int64_t ticks[THREAD_ROLE_COUNT + 1] = {};
+
+    DIR* dir = opendir("/proc/self/task");
+    if (!dir) return;
+    while (dirent* entry = readdir(dir)) {
+        const int tid = std::atoi(entry->d_name);
+        if (tid <= 0) continue;
+
+        char path[64];
+        snprintf(path, sizeof(path), "/proc/self/task/%d/stat", tid);
+        FILE* file = fopen(path, "r");
+        if (!file) continue;
+        char buf[512];
+        size_t len = fread(buf, 1, sizeof(buf) - 1, file);
+        fclose(file);
+        buf[len] = '\0';
+
+        // "tid (comm) state ..." - comm may contain spaces and parentheses
+        char* open = strchr(buf, '(');
+        char* close = strrchr(buf, ')');
+        if (!open || !close || close < open) continue;
+        std::string comm(open + 1, close);
+
+        // utime and stime are fields 14 and 15; the state after ')' is field 3
+        unsigned long long utime = 0, stime = 0;
+        if (sscanf(close + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &utime, &stime) != 2) {
+            continue;
+        }
+
+        int role = THREAD_ROLE_COUNT;
+        std::map<int, int>::const_iterator reg = registered.find(tid);
+        if (reg != registered.end()) {
+            role = reg->second;
+        } else {
+            // Helpers started by a role thread inherit its name
+            for (int r = 0; r < THREAD_ROLE_COUNT; ++r) {
+                if (*kRoleNames[r].threadName && comm == kRoleNames[r].threadName) {
+                    role = r;
+                    break;
+                }
+            }
+        }
+
+        TaskTime task;
+        task.role = role;
+        task.ticks = static_cast<int64_t>(utime + stime);
+        current[tid] = task;
+        threads[role]++;
+    }
+    closedir(dir);
+
+    {
+        // Forget registered threads that have exited
+        std::lock_guard<std::mutex> lock(gRegistryMutex);
+        for (std::map<int, int>::const_iterator it = registered.begin(); it != registered.end(); ++it) {
+            if (!current.count(it->first)) gRegisteredTids.erase(it->first);
+        }
+    }
+
+    // Threads that went away keep their time; a reused tid starts over
+    for (std::map<int, TaskTime>::const_iterator it = tasks_.begin(); it != tasks_.end(); ++it) {
+        std::map<int, TaskTime>::const_iterator now = current.find(it->first);
+        if (now == current.end() || now->second.role != it->second.role || now->second.ticks < it->second.ticks) {
+            exitedTicks_[it->second.role] += it->second.ticks;
+        }
+    }
+    tasks_.swap(current);
+    for (std::map<int, TaskTime>::const_iterator it = tasks_.begin(); it != tasks_.end(); ++it) {
+        ticks[it->second.role] += it->second.ticks;
+    }
+
+    const int64_t now = nowUs();
+    const double elapsed = lastSampleUs_ > 0 ? (now - lastSampleUs_) / 1e6 : 0.0;
+    for (int r = 0; r <= THREAD_ROLE_COUNT; ++r) {
+        const int64_t total = exitedTicks_[r] + ticks[r];
+        usage_[r].threads = threads[r];
+        usage_[r].cpuSeconds = static_cast<double>(total) / ticksPerSecond;
+        usage_[r].cpuPercent = elapsed > 0
+            ? 100.0 * (total - lastTicks_[r]) / ticksPerSecond / elapsed : 0.0;
+        lastTicks_[r] = total;
+    }
+    lastSampleUs_ = now;
+#endif
+}
+
+#ifdef __linux__
+static_assert(sizeof(pthread_t) == sizeof(unsigned long), "pthread_t kept as unsigned long");
+
+namespace {
+
+int64_t clockUs(clockid_t clock)
+{
+    struct timespec ts;
+    if (clock_gettime(clock, &ts) != 0) return 0;
+    return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+} // namespace
+#endif
+
+ThreadCpuGroup::Scope::Scope(ThreadCpuGroup& group)
+    : group_(group)
+{
+    group_.join();
+}
+
+ThreadCpuGroup::Scope::~Scope()
+{
+    group_.leave();
+}
+
+ThreadCpuGroup::ThreadCpuGroup()
+    : exitedUs_(0)
+{
+}
+
+void ThreadCpuGroup::join()
+{
+#ifdef __linux__
+    // Only the time from here on belongs to the group
+    const int64_t before = clockUs(CLOCK_THREAD_CPUTIME_ID);
+    std::lock_guard<std::mutex> lock(mutex_);
+    exitedUs_ -= before;
+    threads_.push_back(static_cast<unsigned long>(pthread_self()));
+#endif
+}
+
+void ThreadCpuGroup::leave()
+{
+#ifdef __linux__
+    const int64_t used = clockUs(CLOCK_THREAD_CPUTIME_ID);
+    std::lock_guard<std::mutex> lock(mutex_);
+    exitedUs_ += used;
+    threads_.erase(std::find(threads_.begin(), threads_.end(), static_cast<unsigned long>(pthread_self())));
+#endif
+}
+
+int64_t ThreadCpuGroup::cpuUs() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    int64_t total = exitedUs_;
+#ifdef __linux__
+    // A member leaves under the lock, so every thread listed is still running
+    for (size_t i = 0; i < threads_.size(); ++i) {
+        clockid_t clock;
+        if (pthread_getcpuclockid(static_cast<pthread_t>(threads_[i]), &clock) == 0) {
+            total += clockUs(clock);
+        }
+    }
+#endif
+    return total;
+}
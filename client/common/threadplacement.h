@@ -0,0 +1,151 @@
+#ifndef THREADPLACEMENT_H
+#define THREADPLACEMENT_H
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+class ClientOptions;
+
+// Pipeline roles that can be placed on their own CPUs and scheduling class.
+// Threads a role starts itself (libav frame threads, whisper/ggml workers)
+// inherit the affinity, nice value, policy and name of the starting thread,
+// so placing the role places its helpers too.
+enum ThreadRole {
+    THREAD_ROLE_DEMUX = 0,
+    THREAD_ROLE_VIDEO_DECODE,
+    THREAD_ROLE_FILTER,
+    THREAD_ROLE_CONVERT,
+    THREAD_ROLE_AUDIO_DECODE,
+    THREAD_ROLE_ASR,
+    THREAD_ROLE_GUI,
+    THREAD_ROLE_COUNT
+};
+
+// Option suffix: "demux", "decode", "filter", "convert", "audio", "asr", "gui"
+const char* threadRoleKey(ThreadRole role);
+// Thread name shown by top -H and perf (at most 15 characters)
+const char* threadRoleThreadName(ThreadRole role);
+
+enum ThreadSchedPolicy {
+    THREAD_SCHED_INHERIT = 0,  // what the process started with
+    THREAD_SCHED_OTHER,
+    THREAD_SCHED_BATCH,
+    THREAD_SCHED_IDLE,
+    THREAD_SCHED_FIFO,         // real-time, needs CAP_SYS_NICE or an rtprio limit
+    THREAD_SCHED_RR
+};
+
+struct ThreadPlacement {
+    std::vector<int> cpus;                    // empty = any CPU
+    bool setNice = false;
+    int nice = 0;
+    ThreadSchedPolicy policy = THREAD_SCHED_INHERIT;
+    int priority = 0;                         // FIFO/RR only, 1..99
+};
+
+// One placement per role, from
+//   --cpus-<role>=0-3,8   --nice-<role>=10   --sched-<role>=other|batch|idle|fifo:N|rr:N
+// When demux or decode stages are pinned and ASR is not, ASR gets the
+// remaining online CPUs so whisper bursts cannot stall decoding.
+struct ThreadPlacementConfig {
+    ThreadPlacement roles[THREAD_ROLE_COUNT];
+    int asrThreads = 4;                       // --asr-threads, whisper n_threads
+
+    const ThreadPlacement& operator[](ThreadRole role) const { return roles[role]; }
+};
+
+ThreadPlacementConfig threadPlacementFromOptions(const ClientOptions& options);
+
+// "0-3,8" -> {0,1,2,3,8}; false on malformed input or a CPU past CPU_SETSIZE
+bool parseCpuList(const std::string& text, std::vector<int>* cpus);
+// e.g. "cpus 0-3 nice 10 idle", or "default"
+std::string describeThreadPlacement(const ThreadPlacement& placement);
+
+// Names the calling thread after the role, records it for the CPU time
+// report and applies the placement. Settings the placement leaves out go
+// back to what the process started with (CPU mask, policy, nice), so a
+// thread does not keep what it inherited from its creator, such as the GUI
+// placement in threads started from the main thread. Returns false and
+// fills *error when a setting was refused (real-time without permission,
+// offline CPUs, a lower nice value without CAP_SYS_NICE); the settings
+// that did apply stay applied.
+bool applyThreadPlacement(ThreadRole role, const ThreadPlacement& placement, std::string* error = nullptr);
+
+// CPU mask, policy and nice value of the calling thread, fully specified,
+// so that applyThreadPlacement() can restore them after a temporary change
+ThreadPlacement currentThreadPlacement();
+
+// Per-role CPU time, including exited threads and helper threads that
+// inherited a role's name. Linux reads /proc/self/task; elsewhere the
+// samples stay empty.
+class ThreadCpuMonitor
+{
+public:
+    struct RoleUsage {
+        int threads = 0;       // live threads attributed to the role
+        double cpuSeconds = 0; // total since start
+        double cpuPercent = 0; // of one core, since the previous sample
+    };
+
+    ThreadCpuMonitor();
+
+    // Call from one thread, about once a second
+    void sample();
+
+    const RoleUsage& usage(ThreadRole role) const { return usage_[role]; }
+    // Threads outside any role
+    const RoleUsage& other() const { return usage_[THREAD_ROLE_COUNT]; }
+
+private:
+    struct TaskTime {
+        int role;
+        int64_t ticks;
+    };
+
+    RoleUsage usage_[THREAD_ROLE_COUNT + 1];
+    std::map<int, TaskTime> tasks_;          // by tid, last seen
+    int64_t exitedTicks_[THREAD_ROLE_COUNT + 1];
+    int64_t lastTicks_[THREAD_ROLE_COUNT + 1];
+    int64_t lastSampleUs_;
+};
+
+// CPU time of one pipeline's threads (e.g. one camera of several), as the
+// role totals above cannot tell pipelines apart. Live members are read
+// through their thread CPU clocks, members that left are kept as a total.
+// Threads a member starts itself (libav frame threads) are not included.
+class ThreadCpuGroup
+{
+public:
+    // Membership of the constructing thread, for as long as the scope lives
+    class Scope
+    {
+    public:
+        explicit Scope(ThreadCpuGroup& group);
+        ~Scope();
+    private:
+        Scope(const Scope&);
+        Scope& operator=(const Scope&);
+        ThreadCpuGroup& group_;
+    };
+
+    ThreadCpuGroup();
+
+    // Total since construction, in microseconds; safe from any thread
+    int64_t cpuUs() const;
+
+private:
+    ThreadCpuGroup(const ThreadCpuGroup&);
+    ThreadCpuGroup& operator=(const ThreadCpuGroup&);
+
+    void join();
+    void leave();
+
+    mutable std::mutex mutex_;
+    std::vector<unsigned long> threads_;   // pthread_t of the live members
+    int64_t exitedUs_;
+};
+
+#endif // THREADPLACEMENT_H
@@ -0,0 +1,204 @@
+#include "videofilter.h"
+#include "clientoptions.h"
+
+#include <algorithm>
+#include <sstream>
+
+extern "C" {
+#include <libavfilter/avfilter.h>
+#include <libavfilter/buffersink.h>
+#include <libavfilter/buffersrc.h>
+#include <libavutil/mathematics.h>
+#include <libavutil/pixdesc.h>
+#include <libavutil/time.h>
+}
+
+namespace {
+
+std::string errorText(int err)
+{
+    char buf[AV_ERROR_MAX_STRING_SIZE] = {};
+    av_strerror(err, buf, sizeof(buf));
+    return buf;
+}
+
+} // namespace
+
+VideoFilterConfig videoFilterFromOptions(const ClientOptions& options)
+{
+    VideoFilterConfig config;
+    config.graph = options.get("vf");
+    if (config.graph == "1") config.graph.clear(); // bare --vf carries no graph
+    config.threads = std::max(0, options.getInt("filter-threads", 0));
+    return config;
+}
+
+VideoFilterStage::VideoFilterStage(const VideoFilterConfig& config)
+    : config_(config), graph_(nullptr), src_(nullptr), sink_(nullptr),
+      inWidth_(0), inHeight_(0), inFormat_(-1), buildFailed_(false), threads_(0),
+      graphs_(0), framesIn_(0), framesOut_(0), busyUs_(0), busyFrames_(0)
+{
+    inTimeBase_.num = 0;
+    inTimeBase_.den = 1;
+    inAspect_.num = 0;
+    inAspect_.den = 1;
+}
+
+VideoFilterStage::~VideoFilterStage()
+{
+    freeGraph();
+}
+
+void VideoFilterStage::freeGraph()
+{
+    avfilter_graph_free(&graph_);
+    src_ = nullptr;
+    sink_ = nullptr;
+}
+
+void VideoFilterStage::reset()
+{
+    freeGraph();
+    inFormat_ = -1;
+    buildFailed_ = false;
+}
+
+bool VideoFilterStage::build(const AVFrame* frame, AVRational timeBase)
+{
+    freeGraph();
+    graph_ = avfilter_graph_alloc();
+    if (!graph_) {
+        lastError_ = "out of memory";
+        return false;
+    }
+    // Slice threading inside filters that support it (yadif, hqdn3d, scale...)
+    graph_->nb_threads = config_.threads;
+
+    AVRational aspect = frame->sample_aspect_ratio;
+    if (aspect.num <= 0 || aspect.den <= 0) {
+        aspect.num = 1;
+        aspect.den = 1;
+    }
+    std::ostringstream args;
+    args << "video_size=" << frame->width << "x" << frame->height
+         << ":pix_fmt=" << frame->format
+         << ":time_base=" << timeBase.num << "/" << timeBase.den
+         << ":pixel_aspect=" << aspect.num << "/" << aspect.den;
+
+    int ret = avfilter_graph_create_filter(&src_, avfilter_get_by_name("buffer"), "in",
+                                           args.str().c_str(), nullptr, graph_);
+    if (ret >= 0) {
+        ret = avfilter_graph_create_filter(&sink_, avfilter_get_by_name("buffersink"), "out",
+                                           nullptr, nullptr, graph_);
+    }
+
+    // "in" feeds the first filter of the user graph, its last filter feeds "out"
+    AVFilterInOut* outputs = avfilter_inout_alloc();
+    AVFilterInOut* inputs = avfilter_inout_alloc();
+    if (ret >= 0 && outputs && inputs) {
+        outputs->name = av_strdup("in");
+        outputs->filter_ctx = src_;
+        outputs->pad_idx = 0;
+        outputs->next = nullptr;
+        inputs->name = av_strdup("out");
+        inputs->filter_ctx = sink_;
+        inputs->pad_idx = 0;
+        inputs->next = nullptr;
+        ret = avfilter_graph_parse_ptr(graph_, config_.graph.c_str(), &inputs, &outputs, nullptr);
+    } else if (ret >= 0) {
+        ret = AVERROR(ENOMEM);
+    }
+    avfilter_inout_free(&inputs);
+    avfilter_inout_free(&outputs);
+    if (ret >= 0) {
+        ret = avfilter_graph_config(graph_, nullptr);
+    }
+
+    // Recorded for a failed build too, so it is not retried for every frame
+    inTimeBase_ = timeBase;
+    inWidth_ = frame->width;
+    inHeight_ = frame->height;
+    inFormat_ = frame->format;
+    inAspect_ = frame->sample_aspect_ratio;
+    buildFailed_ = ret < 0;
+
+    const char* formatName = av_get_pix_fmt_name(static_cast<AVPixelFormat>(frame->format));
+    std::ostringstream description;
+    description << config_.graph << " on " << frame->width << "x" << frame->height
+                << " " << (formatName ? formatName : "?");
+    if (ret < 0) {
+        lastError_ = "filter graph \"" + config_.graph + "\": " + errorText(ret);
+        freeGraph();
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        description_ = description.str() + " failed, frames shown unfiltered";
+        threads_ = 0;
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        description_ = description.str();
+        threads_ = graph_->nb_threads;
+    }
+    graphs_++;
+    busyUs_ = 0;
+    busyFrames_ = 0;
+    return true;
+}
+
+int VideoFilterStage::push(AVFrame* frame, AVRational timeBase)
+{
+    const int64_t start = av_gettime_relative();
+    const bool sameInput = frame->width == inWidth_ && frame->height == inHeight_ && frame->format == inFormat_ &&
+                           av_cmp_q(frame->sample_aspect_ratio, inAspect_) == 0 &&
+                           av_cmp_q(timeBase, inTimeBase_) == 0;
+    if (!graph_ || !sameInput) {
+        if (buildFailed_ && sameInput) return AVERROR(EINVAL);
+        if (!build(frame, timeBase)) return AVERROR(EINVAL);
+    }
+
+    // No KEEP_REF: the graph takes over the reference instead of adding one
+    int ret = av_buffersrc_add_frame_flags(src_, frame, 0);
+    if (ret < 0) {
+        lastError_ = "feeding the filter graph: " + errorText(ret);
+        av_frame_unref(frame);
+        return ret;
+    }
+    framesIn_++;
+    busyFrames_++;
+    busyUs_ += av_gettime_relative() - start;
+    return 0;
+}
+
+bool VideoFilterStage::pull(AVFrame* out)
+{
+    if (!sink_) return false;
+    const int64_t start = av_gettime_relative();
+    // Most filters do their work here, when the sink asks for a frame
+    int ret = av_buffersink_get_frame(sink_, out);
+    busyUs_ += av_gettime_relative() - start;
+    if (ret < 0) return false;
+
+    const AVRational outTimeBase = av_buffersink_get_time_base(sink_);
+    if (out->pts != AV_NOPTS_VALUE) {
+        out->pts = av_rescale_q(out->pts, outTimeBase, inTimeBase_);
+    }
+    out->best_effort_timestamp = out->pts;
+    framesOut_++;
+    return true;
+}
+
+VideoFilterStage::Stats VideoFilterStage::stats() const
+{
+    Stats st;
+    {
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        st.description = description_;
+        st.threads = threads_;
+    }
+    st.graphs = graphs_;
+    st.framesIn = framesIn_;
+    st.framesOut = framesOut_;
+    const int64_t frames = busyFrames_;
+    st.msPerFrame = frames > 0 ? busyUs_ / 1000.0 / frames : 0.0;
+    return st;
+}
@@ -0,0 +1,98 @@
+#ifndef VIDEOFILTER_H
+#define VIDEOFILTER_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <stdint.h>
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/rational.h>
+}
+
+struct AVFilterGraph;
+struct AVFilterContext;
+class ClientOptions;
+
+struct VideoFilterConfig {
+    std::string graph;   // libavfilter syntax, e.g. "yadif,hqdn3d,scale=1280:-2"; empty = off
+    int threads = 0;     // filter_threads for slice-threaded filters, 0 = one per core
+};
+
+// --vf=<graph> and --filter-threads=<n>
+VideoFilterConfig videoFilterFromOptions(const ClientOptions& options);
+
+// Optional libavfilter stage between decode and presentation.
+//
+// Frames go in and out by reference (av_buffersrc/av_buffersink), so
+// filters that pass a frame through do not copy it. The graph is built
+// from the first frame and rebuilt whenever size, pixel format or sample
+// aspect ratio change. Output timestamps are rescaled back to the input
+// time base, so downstream code does not need to know about the graph.
+class VideoFilterStage
+{
+public:
+    explicit VideoFilterStage(const VideoFilterConfig& config);
+    ~VideoFilterStage();
+
+    bool enabled() const { return !config_.graph.empty(); }
+    const VideoFilterConfig& config() const { return config_; }
+
+    // Takes the frame's reference (the frame is left blank). Returns a
+    // negative AVERROR when the graph rejects the frame, or when it cannot
+    // be built for this input: then the frame is left untouched so the
+    // caller can show it unfiltered, and buildFailed() is true. A failed
+    // build is not retried until the input (size, format...) changes.
+    int push(AVFrame* frame, AVRational timeBase);
+    bool buildFailed() const { return buildFailed_; }
+    // Filtered frames, to be called until it returns false after each push()
+    bool pull(AVFrame* out);
+    // Drops the graph and whatever it buffers, e.g. after a reconnect
+    void reset();
+
+    // Time spent in the graph per input frame, for the graph currently built.
+    // Safe to call from any thread.
+    struct Stats {
+        std::string description;  // filter string and the input it was built for
+        int64_t graphs = 0;       // builds so far
+        int64_t framesIn = 0;
+        int64_t framesOut = 0;
+        double msPerFrame = 0.0;
+        int threads = 0;
+    };
+    Stats stats() const;
+
+    // Last build/feed error, for logging
+    const std::string& lastError() const { return lastError_; }
+
+private:
+    VideoFilterStage(const VideoFilterStage&);
+    VideoFilterStage& operator=(const VideoFilterStage&);
+
+    bool build(const AVFrame* frame, AVRational timeBase);
+    void freeGraph();
+
+    VideoFilterConfig config_;
+    AVFilterGraph* graph_;
+    AVFilterContext* src_;
+    AVFilterContext* sink_;
+    AVRational inTimeBase_;
+    int inWidth_;
+    int inHeight_;
+    int inFormat_;
+    AVRational inAspect_;
+    bool buildFailed_;   // for the input recorded above
+    std::string lastError_;
+
+    mutable std::mutex statsMutex_;
+    std::string description_;        // guarded by statsMutex_
+    int threads_;                    // guarded by statsMutex_
+    std::atomic<int64_t> graphs_;
+    std::atomic<int64_t> framesIn_;
+    std::atomic<int64_t> framesOut_;
+    std::atomic<int64_t> busyUs_;    // since the last build
+    std::atomic<int64_t> busyFrames_;
+};
+
+#endif // VIDEOFILTER_H
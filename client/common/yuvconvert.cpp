@@ -0,0 +1,445 @@
+#include "yuvconvert.h"
+#include "alloccount.h"
+
+#include <algorithm>
+#include <atomic>
+
+extern "C" {
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define YUV_HAVE_X86 1
+#define YUV_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define YUV_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define YUV_HAVE_X86 0
+#endif
+
+namespace {
+
+// BT.601 coefficients in Q12. Inputs are pre-shifted left by 3 so that
+// pmulhrsw ((a * b + 2^14) >> 15) yields a * coefficient directly.
+struct YuvCoeffs {
+    int16_t yOffset;
+    int16_t cy;
+    int16_t crv;
+    int16_t cgu;
+    int16_t cgv;
+    int16_t cbu;
+};
+
+// yuv420p / nv12: limited range, same as swscale's default for these formats
+const YuvCoeffs kLimitedRange = { 16, 4769, 6537, 1605, 3330, 8263 };
+// yuvj420p: full (JPEG) range
+const YuvCoeffs kFullRange = { 0, 4096, 5743, 1410, 2925, 7258 };
+
+enum DstLayout {
+    DST_RGB24 = 0,
+    DST_BGR24 = 1,
+    DST_BGRA = 2    // AV_PIX_FMT_RGB32 / QImage::Format_RGB32 on little endian
+};
+
+typedef void (*RowFn)(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+                      uint8_t* dst, int width, const YuvCoeffs& c);
+
+inline int mulhrs(int a, int b)
+{
+    return ((a * b >> 14) + 1) >> 1;
+}
+
+inline uint8_t clampByte(int v)
+{
+    return static_cast<uint8_t>(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+// Scalar version of exactly the same arithmetic, used for row tails
+template <int Layout, bool Nv12>
+void convertRowScalar(const uint8_t* ySrc, const uint8_t* uSrc, const uint8_t* vSrc,
+                      uint8_t* dst, int x, int width, const YuvCoeffs& c)
+{
+    const int bpp = Layout == DST_BGRA ? 4 : 3;
+    for (; x < width; ++x) {
+        int cx = x >> 1;
+        int u = Nv12 ? uSrc[cx * 2] : uSrc[cx];
+        int v = Nv12 ? uSrc[cx * 2 + 1] : vSrc[cx];
+        int us = (u - 128) << 3;
+        int vs = (v - 128) << 3;
+        int yy = mulhrs((ySrc[x] - c.yOffset) << 3, c.cy);
+
+        uint8_t r = clampByte(yy + mulhrs(vs, c.crv));
+        uint8_t g = clampByte(yy - (mulhrs(us, c.cgu) + mulhrs(vs, c.cgv)));
+        uint8_t b = clampByte(yy + mulhrs(us, c.cbu));
+
+        uint8_t* p = dst + x * bpp;
+        if (Layout == DST_RGB24) {
+            p[0] = r; p[1] = g; p[2] = b;
+        } else if (Layout == DST_BGR24) {
+            p[0] = b; p[1] = g; p[2] = r;
+        } else {
+            p[0] = b; p[1] = g; p[2] = r; p[3] = 0xff;
+        }
+    }
+}
+
+#if YUV_HAVE_X86
+
+// Interleaves 16 pixels worth of R, G and B bytes into the destination layout
+template <int Layout>
+YUV_TARGET_SSE41 inline void store16(uint8_t* dst, __m128i r, __m128i g, __m128i b)
+{
+    const __m128i a = _mm_set1_epi8(static_cast<char>(0xff));
+    __m128i bg0 = _mm_unpacklo_epi8(b, g);
+    __m128i bg1 = _mm_unpackhi_epi8(b, g);
+    __m128i ra0 = _mm_unpacklo_epi8(r, a);
+    __m128i ra1 = _mm_unpackhi_epi8(r, a);
+    __m128i p0 = _mm_unpacklo_epi16(bg0, ra0);
+    __m128i p1 = _mm_unpackhi_epi16(bg0, ra0);
+    __m128i p2 = _mm_unpacklo_epi16(bg1, ra1);
+    __m128i p3 = _mm_unpackhi_epi16(bg1, ra1);
+
+    if (Layout == DST_BGRA) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), p0);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), p1);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 32), p2);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 48), p3);
+        return;
+    }
+
+    // Drop alpha: 4 BGRA pixels -> 12 packed bytes, then stitch 4 x 12 into 3 x 16
+    const __m128i mask = Layout == DST_RGB24
+        ? _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1)
+        : _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    __m128i c0 = _mm_shuffle_epi8(p0, mask);
+    __m128i c1 = _mm_shuffle_epi8(p1, mask);
+    __m128i c2 = _mm_shuffle_epi8(p2, mask);
+    __m128i c3 = _mm_shuffle_epi8(p3, mask);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst),
+                     _mm_or_si128(c0, _mm_slli_si128(c1, 12)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16),
+                     _mm_or_si128(_mm_srli_si128(c1, 4), _mm_slli_si128(c2, 8)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 32),
+                     _mm_or_si128(_mm_srli_si128(c2, 8), _mm_slli_si128(c3, 4)));
+}
+
+template <int Layout, bool Nv12>
+YUV_TARGET_SSE41 void convertRowSse41(const uint8_t* ySrc, const uint8_t* uSrc, const uint8_t* vSrc,
+                                      uint8_t* dst, int width, const YuvCoeffs& c)
+{
+    const int bpp = Layout == DST_BGRA ? 4 : 3;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i yOff = _mm_set1_epi16(c.yOffset);
+    const __m128i bias = _mm_set1_epi16(128);
+    const __m128i lowBytes = _mm_set1_epi16(0x00ff);
+    const __m128i cy = _mm_set1_epi16(c.cy);
+    const __m128i crv = _mm_set1_epi16(c.crv);
+    const __m128i cgu = _mm_set1_epi16(c.cgu);
+    const __m128i cgv = _mm_set1_epi16(c.cgv);
+    const __m128i cbu = _mm_set1_epi16(c.cbu);
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ySrc + x));
+
+        // 8 chroma samples cover these 16 pixels
+        __m128i u, v;
+        if (Nv12) {
+            __m128i uv = _mm_loadu_si128(reinterpret_cast<const __m128i*>(uSrc + x));
+            u = _mm_and_si128(uv, lowBytes);
+            v = _mm_srli_epi16(uv, 8);
+        } else {
+            u = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(uSrc + x / 2)));
+            v = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(vSrc + x / 2)));
+        }
+        u = _mm_slli_epi16(_mm_sub_epi16(u, bias), 3);
+        v = _mm_slli_epi16(_mm_sub_epi16(v, bias), 3);
+
+        __m128i rv = _mm_mulhrs_epi16(v, crv);
+        __m128i guv = _mm_add_epi16(_mm_mulhrs_epi16(u, cgu), _mm_mulhrs_epi16(v, cgv));
+        __m128i bu = _mm_mulhrs_epi16(u, cbu);
+
+        __m128i ylo = _mm_slli_epi16(_mm_sub_epi16(_mm_cvtepu8_epi16(y), yOff), 3);
+        __m128i yhi = _mm_slli_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(y, zero), yOff), 3);
+        ylo = _mm_mulhrs_epi16(ylo, cy);
+        yhi = _mm_mulhrs_epi16(yhi, cy);
+
+        // Each chroma term is shared by two horizontally adjacent pixels
+        __m128i r = _mm_packus_epi16(_mm_add_epi16(ylo, _mm_unpacklo_epi16(rv, rv)),
+                                     _mm_add_epi16(yhi, _mm_unpackhi_epi16(rv, rv)));
+        __m128i g = _mm_packus_epi16(_mm_sub_epi16(ylo, _mm_unpacklo_epi16(guv, guv)),
+                                     _mm_sub_epi16(yhi, _mm_unpackhi_epi16(guv, guv)));
+        __m128i b = _mm_packus_epi16(_mm_add_epi16(ylo, _mm_unpacklo_epi16(bu, bu)),
+                                     _mm_add_epi16(yhi, _mm_unpackhi_epi16(bu, bu)));
+
+        store16<Layout>(dst + x * bpp, r, g, b);
+    }
+    convertRowScalar<Layout, Nv12>(ySrc, uSrc, vSrc, dst, x, width, c);
+}
+
+// Packs two vectors of 16 x int16 into 32 bytes in pixel order
+YUV_TARGET_AVX2 inline __m256i pack32(__m256i lo, __m256i hi)
+{
+    return _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8);
+}
+
+template <int Layout, bool Nv12>
+YUV_TARGET_AVX2 void convertRowAvx2(const uint8_t* ySrc, const uint8_t* uSrc, const uint8_t* vSrc,
+                                    uint8_t* dst, int width, const YuvCoeffs& c)
+{
+    const int bpp = Layout == DST_BGRA ? 4 : 3;
+    const __m256i yOff = _mm256_set1_epi16(c.yOffset);
+    const __m256i bias = _mm256_set1_epi16(128);
+    const __m256i lowBytes = _mm256_set1_epi16(0x00ff);
+    const __m256i cy = _mm256_set1_epi16(c.cy);
+    const __m256i crv = _mm256_set1_epi16(c.crv);
+    const __m256i cgu = _mm256_set1_epi16(c.cgu);
+    const __m256i cgv = _mm256_set1_epi16(c.cgv);
+    const __m256i cbu = _mm256_set1_epi16(c.cbu);
+
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        // 16 chroma samples cover these 32 pixels
+        __m256i u, v;
+        if (Nv12) {
+            __m256i uv = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(uSrc + x));
+            u = _mm256_and_si256(uv, lowBytes);
+            v = _mm256_srli_epi16(uv, 8);
+        } else {
+            u = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(uSrc + x / 2)));
+            v = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(vSrc + x / 2)));
+        }
+        u = _mm256_slli_epi16(_mm256_sub_epi16(u, bias), 3);
+        v = _mm256_slli_epi16(_mm256_sub_epi16(v, bias), 3);
+
+        // Reorder to [c0..c3 c8..c11 | c4..c7 c12..c15] so the in-lane unpacks
+        // below duplicate chroma for pixels 0..15 (lo) and 16..31 (hi)
+        __m256i rv = _mm256_permute4x64_epi64(_mm256_mulhrs_epi16(v, crv), 0xD8);
+        __m256i guv = _mm256_permute4x64_epi64(
+            _mm256_add_epi16(_mm256_mulhrs_epi16(u, cgu), _mm256_mulhrs_epi16(v, cgv)), 0xD8);
+        __m256i bu = _mm256_permute4x64_epi64(_mm256_mulhrs_epi16(u, cbu), 0xD8);
+
+        __m128i y0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ySrc + x));
+        __m128i y1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ySrc + x + 16));
+        __m256i ylo = _mm256_mulhrs_epi16(_mm256_slli_epi16(_mm256_sub_epi16(_mm256_cvtepu8_epi16(y0), yOff), 3), cy);
+        __m256i yhi = _mm256_mulhrs_epi16(_mm256_slli_epi16(_mm256_sub_epi16(_mm256_cvtepu8_epi16(y1), yOff), 3), cy);
+
+        __m256i r = pack32(_mm256_add_epi16(ylo, _mm256_unpacklo_epi16(rv, rv)),
+                           _mm256_add_epi16(yhi, _mm256_unpackhi_epi16(rv, rv)));
+        __m256i g = pack32(_mm256_sub_epi16(ylo, _mm256_unpacklo_epi16(guv, guv)),
+                           _mm256_sub_epi16(yhi, _mm256_unpackhi_epi16(guv, guv)));
+        __m256i b = pack32(_mm256_add_epi16(ylo, _mm256_unpacklo_epi16(bu, bu)),
+                           _mm256_add_epi16(yhi, _mm256_unpackhi_epi16(bu, bu)));
+
+        store16<Layout>(dst + x * bpp, _mm256_castsi256_si128(r), _mm256_castsi256_si128(g),
+                        _mm256_castsi256_si128(b));
+        store16<Layout>(dst + (x + 16) * bpp, _mm256_extracti128_si256(r, 1),
+                        _mm256_extracti128_si256(g, 1), _mm256_extracti128_si256(b, 1));
+    }
+    convertRowScalar<Layout, Nv12>(ySrc, uSrc, vSrc, dst, x, width, c);
+}
+
+template <int Layout, bool Nv12>
+RowFn rowFor(YuvSimdLevel level)
+{
+    return level == YUV_SIMD_AVX2 ? &convertRowAvx2<Layout, Nv12> : &convertRowSse41<Layout, Nv12>;
+}
+
+#endif // YUV_HAVE_X86
+
+YuvSimdLevel detectLevel()
+{
+#if YUV_HAVE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return YUV_SIMD_AVX2;
+    if (__builtin_cpu_supports("sse4.1")) return YUV_SIMD_SSE41;
+#endif
+    return YUV_SIMD_NONE;
+}
+
+std::atomic<int> g_levelOverride(-1);
+
+bool dstLayoutFor(AVPixelFormat dstFormat, DstLayout* layout)
+{
+    if (dstFormat == AV_PIX_FMT_RGB24) {
+        *layout = DST_RGB24;
+    } else if (dstFormat == AV_PIX_FMT_BGR24) {
+        *layout = DST_BGR24;
+    } else if (dstFormat == AV_PIX_FMT_RGB32 && AV_PIX_FMT_RGB32 == AV_PIX_FMT_BGRA) {
+        // Native-endian ARGB is B,G,R,A in memory on little-endian hosts
+        *layout = DST_BGRA;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+YuvSimdLevel yuvSimdDetect()
+{
+    static const YuvSimdLevel detected = detectLevel();
+    return detected;
+}
+
+YuvSimdLevel yuvSimdLevel()
+{
+    int forced = g_levelOverride.load(std::memory_order_relaxed);
+    return forced < 0 ? yuvSimdDetect() : static_cast<YuvSimdLevel>(forced);
+}
+
+void yuvSetSimdLevel(YuvSimdLevel level)
+{
+    if (level > yuvSimdDetect()) level = yuvSimdDetect();
+    g_levelOverride.store(level, std::memory_order_relaxed);
+}
+
+const char* yuvSimdLevelName(YuvSimdLevel level)
+{
+    switch (level) {
+    case YUV_SIMD_AVX2: return "avx2";
+    case YUV_SIMD_SSE41: return "sse4.1";
+    default: return "none";
+    }
+}
+
+bool yuvSimdSupported(AVPixelFormat srcFormat, AVPixelFormat dstFormat)
+{
+    DstLayout layout;
+    if (yuvSimdLevel() == YUV_SIMD_NONE || !dstLayoutFor(dstFormat, &layout)) return false;
+    return srcFormat == AV_PIX_FMT_YUV420P || srcFormat == AV_PIX_FMT_YUVJ420P ||
+           srcFormat == AV_PIX_FMT_NV12;
+}
+
+bool yuvSimdConvert(const uint8_t* const srcData[], const int srcLinesize[], AVPixelFormat srcFormat,
+                    int width, int height,
+                    uint8_t* dst, int dstLinesize, AVPixelFormat dstFormat)
+{
+#if YUV_HAVE_X86
+    if (!yuvSimdSupported(srcFormat, dstFormat) || width <= 0 || height <= 0) return false;
+
+    DstLayout layout = DST_RGB24;
+    dstLayoutFor(dstFormat, &layout);
+    const bool nv12 = srcFormat == AV_PIX_FMT_NV12;
+    const YuvCoeffs& coeffs = srcFormat == AV_PIX_FMT_YUVJ420P ? kFullRange : kLimitedRange;
+    const YuvSimdLevel level = yuvSimdLevel();
+
+    RowFn row = nullptr;
+    switch (layout) {
+    case DST_RGB24: row = nv12 ? rowFor<DST_RGB24, true>(level) : rowFor<DST_RGB24, false>(level); break;
+    case DST_BGR24: row = nv12 ? rowFor<DST_BGR24, true>(level) : rowFor<DST_BGR24, false>(level); break;
+    case DST_BGRA:  row = nv12 ? rowFor<DST_BGRA, true>(level)  : rowFor<DST_BGRA, false>(level);  break;
+    }
+
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* yRow = srcData[0] + y * srcLinesize[0];
+        const uint8_t* uRow = srcData[1] + (y >> 1) * srcLinesize[1];
+        const uint8_t* vRow = nv12 ? nullptr : srcData[2] + (y >> 1) * srcLinesize[2];
+        row(yRow, uRow, vRow, dst + y * dstLinesize, width, coeffs);
+    }
+    return true;
+#else
+    (void)srcData; (void)srcLinesize; (void)srcFormat; (void)width; (void)height;
+    (void)dst; (void)dstLinesize; (void)dstFormat;
+    return false;
+#endif
+}
+
+namespace {
+
+// Points the plane pointers at the crop origin, as av_frame_apply_cropping()
+// does, but without touching the frame, which the caller may share
+bool cropPlanes(const AVFrame* src, CropRect& crop, const uint8_t* data[4])
+{
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(static_cast<AVPixelFormat>(src->format));
+    if (!desc || (desc->flags & (AV_PIX_FMT_FLAG_BITSTREAM | AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_PAL))) {
+        return false;
+    }
+
+    // Every plane has to start on a whole (subsampled) chroma sample
+    const int alignX = 1 << desc->log2_chroma_w;
+    const int alignY = 1 << desc->log2_chroma_h;
+    crop.x = std::max(0, std::min(crop.x, src->width - 1)) & ~(alignX - 1);
+    crop.y = std::max(0, std::min(crop.y, src->height - 1)) & ~(alignY - 1);
+    crop.width = std::max(1, std::min(crop.width, src->width - crop.x));
+    crop.height = std::max(1, std::min(crop.height, src->height - crop.y));
+
+    int maxStep[4];
+    av_image_fill_max_pixsteps(maxStep, nullptr, desc);
+    const bool rgb = (desc->flags & AV_PIX_FMT_FLAG_RGB) != 0;
+    for (int p = 0; p < 4; ++p) {
+        if (!src->data[p]) {
+            data[p] = nullptr;
+            continue;
+        }
+        const bool chroma = !rgb && (p == 1 || p == 2);
+        const int x = chroma ? crop.x >> desc->log2_chroma_w : crop.x;
+        const int y = chroma ? crop.y >> desc->log2_chroma_h : crop.y;
+        data[p] = src->data[p] + y * src->linesize[p] + x * maxStep[p];
+    }
+    return true;
+}
+
+} // namespace
+
+FrameConverter::FrameConverter(int swsFlags)
+    : swsCtx_(nullptr), swsFlags_(swsFlags), lastUsedSimd_(false)
+{
+}
+
+FrameConverter::~FrameConverter()
+{
+    if (swsCtx_) {
+        sws_freeContext(swsCtx_);
+    }
+}
+
+bool FrameConverter::convert(const AVFrame* src, uint8_t* dst, int dstLinesize,
+                             int dstWidth, int dstHeight, AVPixelFormat dstFormat)
+{
+    CropRect full = { 0, 0, src->width, src->height };
+    return convert(src, full, dst, dstLinesize, dstWidth, dstHeight, dstFormat);
+}
+
+bool FrameConverter::convert(const AVFrame* src, CropRect& crop, uint8_t* dst, int dstLinesize,
+                             int dstWidth, int dstHeight, AVPixelFormat dstFormat)
+{
+    const AVPixelFormat srcFormat = static_cast<AVPixelFormat>(src->format);
+
+    const uint8_t* srcData[4] = { src->data[0], src->data[1], src->data[2], src->data[3] };
+    const bool fullFrame = crop.x == 0 && crop.y == 0 && crop.width == src->width && crop.height == src->height;
+    if (!fullFrame && !cropPlanes(src, crop, srcData)) {
+        crop.x = 0;
+        crop.y = 0;
+        crop.width = src->width;
+        crop.height = src->height;
+    }
+
+    if (dstWidth == crop.width && dstHeight == crop.height &&
+        yuvSimdConvert(srcData, src->linesize, srcFormat, crop.width, crop.height,
+                       dst, dstLinesize, dstFormat)) {
+        lastUsedSimd_ = true;
+        return true;
+    }
+
+    lastUsedSimd_ = false;
+    // Only rebuilt when the source format, the crop size or the target size changes
+    UncountedAllocScope rebuild;
+    swsCtx_ = sws_getCachedContext(swsCtx_, crop.width, crop.height, srcFormat,
+                                   dstWidth, dstHeight, dstFormat,
+                                   swsFlags_, nullptr, nullptr, nullptr);
+    if (!swsCtx_) return false;
+
+    uint8_t* dstData[4] = { dst, nullptr, nullptr, nullptr };
+    int dstStride[4] = { dstLinesize, 0, 0, 0 };
+    if (dstFormat == AV_PIX_FMT_YUV420P) {
+        const int chromaStride = dstLinesize / 2;
+        dstData[1] = dst + static_cast<size_t>(dstLinesize) * dstHeight;
+        dstData[2] = dstData[1] + static_cast<size_t>(chromaStride) * ((dstHeight + 1) / 2);
+        dstStride[1] = chromaStride;
+        dstStride[2] = chromaStride;
+    }
+    sws_scale(swsCtx_, srcData, src->linesize, 0, crop.height, dstData, dstStride);
+    return true;
+}
@@ -0,0 +1,76 @@
+#ifndef YUVCONVERT_H
+#define YUVCONVERT_H
+
+#include <stdint.h>
+
+extern "C" {
+#include <libavutil/pixfmt.h>
+#include <libavutil/frame.h>
+#include <libswscale/swscale.h>
+}
+
+// Hand-written SSE4.1/AVX2 kernels for the same-size conversions that dominate
+// our viewers: yuv420p, yuvj420p and nv12 to RGB24, BGR24 and RGB32.
+// The kernel set is chosen from CPUID on first use.
+enum YuvSimdLevel {
+    YUV_SIMD_NONE = 0,
+    YUV_SIMD_SSE41 = 1,
+    YUV_SIMD_AVX2 = 2
+};
+
+// Best level this CPU supports
+YuvSimdLevel yuvSimdDetect();
+// Level currently in use (defaults to yuvSimdDetect(); clamped to it when set)
+YuvSimdLevel yuvSimdLevel();
+void yuvSetSimdLevel(YuvSimdLevel level);
+const char* yuvSimdLevelName(YuvSimdLevel level);
+
+bool yuvSimdSupported(AVPixelFormat srcFormat, AVPixelFormat dstFormat);
+
+// Same-size conversion. Returns false when the format pair is not covered
+// or no SIMD level is available; the caller then falls back to swscale.
+bool yuvSimdConvert(const uint8_t* const srcData[], const int srcLinesize[], AVPixelFormat srcFormat,
+                    int width, int height,
+                    uint8_t* dst, int dstLinesize, AVPixelFormat dstFormat);
+
+// Source region to convert, in pixels of the decoded frame
+struct CropRect {
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+// Decoded frame -> packed RGB, SIMD kernels where possible and swscale otherwise.
+// AV_PIX_FMT_YUV420P as the destination writes one contiguous I420 buffer
+// (for GPU colour conversion): the Y plane at dstLinesize, then the U and V
+// planes at half that stride. dstLinesize must be even.
+class FrameConverter
+{
+public:
+    explicit FrameConverter(int swsFlags = SWS_BILINEAR);
+    ~FrameConverter();
+
+    bool convert(const AVFrame* src, uint8_t* dst, int dstLinesize,
+                 int dstWidth, int dstHeight, AVPixelFormat dstFormat);
+
+    // Converts only the crop of src (digital zoom/pan): the plane pointers are
+    // offset to the crop origin, so the work scales with the crop and output
+    // size, not the full frame. The crop is clamped to the frame and its
+    // origin aligned to the chroma grid; the adjusted rectangle is returned.
+    bool convert(const AVFrame* src, CropRect& crop, uint8_t* dst, int dstLinesize,
+                 int dstWidth, int dstHeight, AVPixelFormat dstFormat);
+
+    // Whether the last convert() call used a SIMD kernel
+    bool lastUsedSimd() const { return lastUsedSimd_; }
+
+private:
+    FrameConverter(const FrameConverter&);
+    FrameConverter& operator=(const FrameConverter&);
+
+    SwsContext* swsCtx_;
+    int swsFlags_;
+    bool lastUsedSimd_;
+};
+
+#endif // YUVCONVERT_H
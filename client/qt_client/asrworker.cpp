@@ -32,6 +32,12 @@ void AsrWorker::setInputSampleRate(int rate)
     m_inputSampleRate = rate;
 }
 
+void AsrWorker::setThreadPlacement(const ThreadPlacement &placement, int threads)
+{
+    m_placement = placement;
+    m_threads = threads;
+}
+
 void AsrWorker::receiveAudio(const char* data, int len)
 {
     QMutexLocker locker(&m_mutex);
@@ -48,6 +54,12 @@ void AsrWorker::stop()
 
 void AsrWorker::run()
 {
+    // Before whisper starts its compute threads, so they inherit it
+    std::string placementError;
+    if (!applyThreadPlacement(THREAD_ROLE_ASR, m_placement, &placementError)) {
+        emit logMessage("ASR Warning: thread placement not fully applied: " + QString::fromStdString(placementError));
+    }
+
     // Initialize Whisper Context
     struct whisper_context_params cparams = whisper_context_default_params();
     
@@ -85,9 +97,20 @@ void AsrWorker::run()
 
     emit logMessage("ASR Worker started. Model loaded.");
 
+    // Both buffers keep their capacity across iterations: rawData and
+    // m_incomingBuffer are swapped instead of copied and cleared, and the
+    // sample buffer is emptied with resize(0), which does not free
+    QByteArray rawData;
+    rawData.reserve(64 * 1024);
+    {
+        QMutexLocker locker(&m_mutex);
+        m_incomingBuffer.reserve(64 * 1024);
+    }
+    m_audioBuffer.reserve(4 * 16000);
+
     while (m_running) {
-        QByteArray rawData;
-        
+        rawData.resize(0);
+
         {
             QMutexLocker locker(&m_mutex);
             while (m_incomingBuffer.isEmpty() && m_running) {
@@ -96,8 +119,7 @@ void AsrWorker::run()
             }
             if (!m_running) break;
             
-            rawData = m_incomingBuffer;
-            m_incomingBuffer.clear();
+            rawData.swap(m_incomingBuffer);
         }
 
         if (rawData.isEmpty()) continue;
@@ -160,7 +182,7 @@ void AsrWorker::transcribe()
     } else {
         wparams.language = "zh"; // Default to Chinese
     }
-    wparams.n_threads = 4;
+    wparams.n_threads = m_threads;
     wparams.no_context = true; // Don't use past context for now to keep it simple
 
     // Run inference
@@ -187,6 +209,6 @@ void AsrWorker::transcribe()
 
     // Clear buffer after processing
     // In a real continuous dictation, you might want to keep the last part 
-    // or use a sliding window. For this task, we clear.
-    m_audioBuffer.clear();
+    // or use a sliding window. For this task, we clear (keeping the capacity).
+    m_audioBuffer.resize(0);
 }
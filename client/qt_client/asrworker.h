@@ -8,6 +8,8 @@
 #include <QByteArray>
 #include <QWaitCondition>
 
+#include "threadplacement.h"
+
 // Forward declaration to avoid including whisper.h in header
 struct whisper_context;
 
@@ -20,6 +22,9 @@ public:
 
     void setModelPath(const QString &path);
     void setInputSampleRate(int rate);
+    // CPUs/scheduling for the worker and whisper threads (which inherit it)
+    // and the whisper thread count; call before start()
+    void setThreadPlacement(const ThreadPlacement &placement, int threads);
     
     // Thread-safe audio input
     void receiveAudio(const char* data, int len);
@@ -53,6 +58,9 @@ private:
     
     int m_inputSampleRate = 44100; // Default
     int m_targetSampleRate = 16000;
+
+    ThreadPlacement m_placement;
+    int m_threads = 4;
 };
 
 #endif // ASRWORKER_H
@@ -0,0 +1,52 @@
+#include "audiochunkpool.h"
+
+#include <QtGlobal>
+
+namespace {
+// An AAC frame is 1024 samples (2 KB of S16 mono); leave room for resampler delay
+const int kMinChunkCapacity = 8192;
+}
+
+AudioChunkPool::AudioChunkPool(int chunkCount)
+    : chunks_(chunkCount), current_(nullptr), next_(0), warm_(false), allocations_(0), steadyAllocations_(0)
+{
+}
+
+char* AudioChunkPool::begin(int maxBytes)
+{
+    const int count = chunks_.size();
+    for (int tried = 0; tried < count; ++tried) {
+        QByteArray &chunk = chunks_[next_];
+        next_ = (next_ + 1) % count;
+        // A receiver (visualizer, ASR, queued signal) still holds it
+        if (chunk.capacity() > 0 && !chunk.isDetached()) continue;
+
+        if (chunk.capacity() < maxBytes) {
+            // reserve() also keeps resize() from ever giving the buffer back
+            chunk = QByteArray();
+            chunk.reserve(qMax(maxBytes, kMinChunkCapacity));
+            allocations_++;
+            if (warm_) steadyAllocations_++;
+        }
+        chunk.resize(maxBytes);
+        current_ = &chunk;
+        return chunk.data();
+    }
+
+    // Every chunk is still in use: fall back to a one-off buffer
+    allocations_++;
+    if (warm_) steadyAllocations_++;
+    spare_ = QByteArray(maxBytes, Qt::Uninitialized);
+    current_ = &spare_;
+    return spare_.data();
+}
+
+QByteArray AudioChunkPool::commit(int bytes)
+{
+    // Still detached here, so shrinking neither copies nor reallocates
+    current_->resize(bytes);
+    QByteArray out = *current_;
+    if (current_ == &spare_) spare_ = QByteArray();
+    current_ = nullptr;
+    return out;
+}
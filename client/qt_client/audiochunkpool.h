@@ -0,0 +1,37 @@
+#ifndef AUDIOCHUNKPOOL_H
+#define AUDIOCHUNKPOOL_H
+
+#include <QByteArray>
+#include <QVector>
+
+// Ring of reusable PCM buffers for the audio decode stage. A chunk goes out
+// as a shallow QByteArray copy (through audioDataReady) and can be reused once
+// every receiver has dropped it, i.e. the pool's copy is detached again. In
+// steady state this means no allocation per audio frame.
+// Audio decode stage only.
+class AudioChunkPool
+{
+public:
+    explicit AudioChunkPool(int chunkCount);
+
+    // Writable space for up to maxBytes in a free chunk
+    char* begin(int maxBytes);
+    // The first `bytes` bytes written since begin(), as a (shared) array
+    QByteArray commit(int bytes);
+
+    void markWarm() { warm_ = true; }
+
+    qint64 allocations() const { return allocations_; }
+    qint64 steadyAllocations() const { return steadyAllocations_; }
+
+private:
+    QVector<QByteArray> chunks_;
+    QByteArray spare_;          // one-off buffer when every chunk is busy
+    QByteArray* current_;       // chunk between begin() and commit()
+    int next_;
+    bool warm_;
+    qint64 allocations_;
+    qint64 steadyAllocations_;
+};
+
+#endif // AUDIOCHUNKPOOL_H
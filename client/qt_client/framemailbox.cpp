@@ -0,0 +1,62 @@
+#include "framemailbox.h"
+
+FrameMailbox::FrameMailbox()
+    : full_(false), posted_(0), taken_(0), dropped_(0)
+{
+}
+
+bool FrameMailbox::post(const QImage &image)
+{
+    QImage replaced;
+    bool wasEmpty;
+    {
+        QMutexLocker locker(&mutex_);
+        wasEmpty = !full_;
+        if (full_) {
+            dropped_++;
+            // Release the overwritten frame outside the lock
+            replaced.swap(pending_);
+        }
+        pending_ = image;
+        full_ = true;
+        posted_++;
+    }
+    return wasEmpty;
+}
+
+bool FrameMailbox::take(QImage &image)
+{
+    QMutexLocker locker(&mutex_);
+    if (!full_) return false;
+    image.swap(pending_);
+    pending_ = QImage();
+    full_ = false;
+    taken_++;
+    return true;
+}
+
+void FrameMailbox::clear()
+{
+    QImage released;
+    QMutexLocker locker(&mutex_);
+    released.swap(pending_);
+    full_ = false;
+}
+
+qint64 FrameMailbox::posted() const
+{
+    QMutexLocker locker(&mutex_);
+    return posted_;
+}
+
+qint64 FrameMailbox::taken() const
+{
+    QMutexLocker locker(&mutex_);
+    return taken_;
+}
+
+qint64 FrameMailbox::dropped() const
+{
+    QMutexLocker locker(&mutex_);
+    return dropped_;
+}
@@ -0,0 +1,39 @@
+#ifndef FRAMEMAILBOX_H
+#define FRAMEMAILBOX_H
+
+#include <QImage>
+#include <QMutex>
+
+// Single-slot hand-off between the convert stage and the GUI.
+// The producer overwrites whatever the GUI has not picked up yet, so the GUI
+// always paints the newest frame and a slow paint path drops frames instead of
+// queueing them. Only an empty -> full transition needs a notification, which
+// keeps at most one frameReady event in the GUI event queue.
+class FrameMailbox
+{
+public:
+    FrameMailbox();
+
+    // Returns true if the mailbox was empty, i.e. the GUI must be notified
+    bool post(const QImage &image);
+
+    // Takes the pending frame, if any
+    bool take(QImage &image);
+
+    void clear();
+
+    qint64 posted() const;
+    qint64 taken() const;
+    qint64 dropped() const;
+
+private:
+    mutable QMutex mutex_;
+    QImage pending_;
+    bool full_;
+
+    qint64 posted_;
+    qint64 taken_;
+    qint64 dropped_;
+};
+
+#endif // FRAMEMAILBOX_H
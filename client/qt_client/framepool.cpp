@@ -0,0 +1,73 @@
+#include "framepool.h"
+#include "alloccount.h"
+
+FramePool* FramePool::create(int slotCount)
+{
+    return new FramePool(slotCount);
+}
+
+FramePool::FramePool(int slotCount)
+    : slots_(new Slot[slotCount]), slotCount_(slotCount), warm_(false),
+      exhausted_(0), allocations_(0), steadyAllocations_(0)
+{
+}
+
+FramePool::~FramePool()
+{
+    // Copies still held by the GUI keep their pixels alive on their own
+    delete[] slots_;
+}
+
+void FramePool::release()
+{
+    delete this;
+}
+
+QImage FramePool::acquire(int width, int height, QImage::Format format, uchar **bits)
+{
+    for (int i = 0; i < slotCount_; ++i) {
+        Slot &slot = slots_[i];
+        // The GUI (or the mailbox) still holds a copy
+        if (!slot.image.isNull() && !slot.image.isDetached()) {
+            continue;
+        }
+
+        if (slot.image.width() != width || slot.image.height() != height || slot.image.format() != format) {
+            // Only happens during warm-up or when the output size changes;
+            // steadyAllocations_ reports it, the allocation check need not
+            UncountedAllocScope resize;
+            slot.image = QImage(width, height, format);
+            allocations_++;
+            if (warm_) steadyAllocations_++;
+            if (slot.image.isNull()) {
+                return QImage();
+            }
+        }
+
+        // Taken while the image is still detached, so this does not copy
+        slot.bits = slot.image.bits();
+        *bits = slot.bits;
+        return slot.image;
+    }
+
+    exhausted_++;
+    return QImage();
+}
+
+void FramePool::markWarm()
+{
+    warm_ = true;
+}
+
+FramePool::Stats FramePool::stats() const
+{
+    Stats s;
+    s.slotCount = slotCount_;
+    for (int i = 0; i < slotCount_; ++i) {
+        if (!slots_[i].image.isNull() && !slots_[i].image.isDetached()) s.inUse++;
+    }
+    s.exhausted = exhausted_;
+    s.allocations = allocations_;
+    s.steadyAllocations = steadyAllocations_;
+    return s;
+}
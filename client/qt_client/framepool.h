@@ -0,0 +1,59 @@
+#ifndef FRAMEPOOL_H
+#define FRAMEPOOL_H
+
+#include <QImage>
+#include <atomic>
+#include <cstddef>
+
+// Fixed set of images that the convert stage renders into directly.
+// Each slot keeps one QImage for good; the GUI gets shallow copies of it, and
+// the slot is free again once every copy is gone (the image is detached).
+// Handing out a frame therefore costs neither a pixel buffer nor the QImage
+// bookkeeping behind it, and a buffer stays valid for as long as any copy
+// does, even after VideoThread is gone.
+//
+// acquire(), markWarm() and stats() belong to the convert stage.
+class FramePool
+{
+public:
+    struct Stats {
+        int slotCount = 0;
+        int inUse = 0;
+        qint64 exhausted = 0;          // acquire() found no free buffer
+        qint64 allocations = 0;        // buffer (re)allocations in total
+        qint64 steadyAllocations = 0;  // allocations after markWarm()
+    };
+
+    static FramePool* create(int slotCount);
+    void release();
+
+    // Returns a pooled image, or a null image if every buffer is still held
+    // by the GUI. Render through *bits (bytesPerLine() apart): writing via
+    // QImage::bits() on the returned, shared image would detach it.
+    QImage acquire(int width, int height, QImage::Format format, uchar **bits);
+
+    // From now on any buffer allocation is counted as a steady-state allocation
+    void markWarm();
+
+    Stats stats() const;
+
+private:
+    struct Slot {
+        QImage image;
+        uchar* bits = nullptr;
+    };
+
+    explicit FramePool(int slotCount);
+    ~FramePool();
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    Slot* slots_;
+    int slotCount_;
+    bool warm_;
+    qint64 exhausted_;
+    qint64 allocations_;
+    qint64 steadyAllocations_;
+};
+
+#endif // FRAMEPOOL_H
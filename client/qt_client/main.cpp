@@ -4,7 +4,8 @@
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
-    MainWindow w;
+    // --decode-threading=... and friends, same spelling as the command line clients
+    MainWindow w(ClientOptions(argc, argv));
     w.show();
     return a.exec();
 }
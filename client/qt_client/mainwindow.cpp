@@ -10,19 +10,78 @@
 #include <QPainterPath>
 #include <QCoreApplication>
 #include <QStringList>
+#include <QEvent>
+#include <QWheelEvent>
+#include <QMouseEvent>
+#include <cmath>
+#include <QElapsedTimer>
+
+namespace {
+
+// Encoder arguments for the publisher. All three are tuned for live use
+// (no lookahead, no B-frames); HEVC and AV1 reach H.264 quality at roughly
+// half the bitrate, hence the lower defaults.
+QStringList publisherVideoArgs(const QString &codec, int bitrateKbps)
+{
+    QStringList args;
+    int defaultKbps = 1000;
+    if (codec == "hevc" || codec == "h265") {
+        args << "-c:v" << "libx265" << "-preset" << "ultrafast" << "-tune" << "zerolatency";
+        defaultKbps = 500;
+    } else if (codec == "av1") {
+        // pred-struct=1: SVT-AV1's low-delay prediction structure
+        args << "-c:v" << "libsvtav1" << "-preset" << "12" << "-svtav1-params" << "pred-struct=1";
+        defaultKbps = 500;
+    } else {
+        args << "-c:v" << "libx264" << "-preset" << "ultrafast" << "-tune" << "zerolatency";
+    }
+    args << "-b:v" << QString("%1k").arg(bitrateKbps > 0 ? bitrateKbps : defaultKbps);
+    return args;
+}
+
+} // namespace
 
-MainWindow::MainWindow(QWidget *parent)
+MainWindow::MainWindow(const ClientOptions &options, QWidget *parent)
     : QMainWindow(parent), videoThread(nullptr), asrWorker(nullptr),
       mediaMtxProcess(nullptr), ffmpegProcess(nullptr), playerProcess(nullptr),
-      isRunning(false)
+      isRunning(false), decoderThreading(decoderThreadingFromOptions(options)),
+      decoderSelection(decoderSelectionFromOptions(options)),
+      publishCodec(QString::fromStdString(options.get("publish-codec", "h264"))),
+      publishBitrateKbps(options.getInt("publish-bitrate", 0)),
+      ioTimeouts(ioTimeoutsFromOptions(options)),
+      targetLatencyMs(targetLatencyFromOptions(options)),
+      threadPlacement(threadPlacementFromOptions(options)),
+      frameExport(frameExportFromOptions(options)),
+      videoFilter(videoFilterFromOptions(options)),
+      renderOpenGL(options.get("render") == "gl"),
+      zoomRegion(0, 0, 1, 1), panning(false)
 {
     setupUi();
     applyStyles();
     setWindowTitle("音视频传输客户端");
     resize(1200, 800);
 
+    if (renderOpenGL && !videoView->setUseOpenGL(true)) {
+        log("OpenGL rendering is not available in this Qt build, painting RGB frames instead");
+        renderOpenGL = false;
+    }
+
+    // The GUI runs on the main thread, so it is placed right here
+    std::string placementError;
+    if (!applyThreadPlacement(THREAD_ROLE_GUI, threadPlacement[THREAD_ROLE_GUI], &placementError)) {
+        log("Thread placement for gui not fully applied: " + QString::fromStdString(placementError));
+    }
+    for (int r = 0; r < THREAD_ROLE_COUNT; ++r) {
+        const ThreadPlacement &placement = threadPlacement[static_cast<ThreadRole>(r)];
+        if (!placement.cpus.empty() || placement.setNice || placement.policy != THREAD_SCHED_INHERIT) {
+            log(QString("Thread placement %1: %2").arg(threadRoleKey(static_cast<ThreadRole>(r)))
+                    .arg(QString::fromStdString(describeThreadPlacement(placement))));
+        }
+    }
+
     // Initialize ASR Worker
     asrWorker = new AsrWorker(this);
+    asrWorker->setThreadPlacement(threadPlacement[THREAD_ROLE_ASR], threadPlacement.asrThreads);
     connect(asrWorker, &AsrWorker::speechRecognized, this, &MainWindow::onSpeechRecognized);
     connect(asrWorker, &AsrWorker::logMessage, this, &MainWindow::log);
     asrWorker->start();
@@ -155,11 +214,28 @@ void MainWindow::setupUi()
     QHBoxLayout *modeLayout = new QHBoxLayout();
     rbVideo = new QRadioButton("Video", this);
     rbAudio = new QRadioButton("Audio", this);
+    rbMosaic = new QRadioButton("Mosaic", this);
+    rbMosaic->setToolTip("Play existing streams side by side: several RTSP URLs, separated by spaces or commas");
     rbVideo->setChecked(true);
     modeLayout->addWidget(rbVideo);
     modeLayout->addWidget(rbAudio);
+    modeLayout->addWidget(rbMosaic);
     configLayout->addLayout(modeLayout);
 
+    // Decoder threading: latency versus throughput
+    QLabel *lblDecode = new QLabel("解码线程", this);
+    lblDecode->setObjectName("LabelHeaderCN");
+    configLayout->addWidget(lblDecode);
+
+    decodeModeCombo = new QComboBox(this);
+    decodeModeCombo->addItem("自动", DECODE_THREADING_AUTO);
+    decodeModeCombo->addItem("低延迟 (slice)", DECODE_THREADING_SLICE);
+    decodeModeCombo->addItem("高吞吐 (frame)", DECODE_THREADING_FRAME);
+    decodeModeCombo->addItem("单线程", DECODE_THREADING_OFF);
+    decodeModeCombo->setCurrentIndex(qMax(0, decodeModeCombo->findData(decoderThreading.mode)));
+    decodeModeCombo->setToolTip("帧多线程每多一个线程增加一帧延迟；切片多线程不增加延迟，但需要编码端输出多切片");
+    configLayout->addWidget(decodeModeCombo);
+
     leftLayout->addWidget(configBox);
     
     // Spacer to push button to bottom
@@ -189,19 +265,33 @@ void MainWindow::setupUi()
     videoContainer->setLayout(displayLayout); // Set layout explicitly if not done by constructor
 
     // Page 0: Video
-    videoLabel = new QLabel(this);
-    videoLabel->setAlignment(Qt::AlignCenter);
-    videoLabel->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
-    displayLayout->addWidget(videoLabel);
+    videoView = new VideoWidget(this);
+    videoView->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+    videoView->setMinimumSize(1, 1);
+    videoView->installEventFilter(this); // forwards resizes and zoom/pan to the decoder
+    videoView->setToolTip("Wheel: zoom, drag: pan, double-click: whole frame");
+    displayLayout->addWidget(videoView);
     
     // Page 1: Audio Visualizer
     audioVisualizer = new AudioVisualizer(this);
     displayLayout->addWidget(audioVisualizer);
+
+    // Page 2: several streams at reduced resolution
+    mosaicView = new MosaicView(this);
+    mosaicView->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+    displayLayout->addWidget(mosaicView);
+    connect(mosaicView, &MosaicView::statusMessage, this, &MainWindow::log);
+    connect(mosaicView, &MosaicView::summaryUpdated, this, [this](const QString &summary, const QString &details) {
+        fpsLabel->setText(summary);
+        fpsLabel->setToolTip(details);
+    });
+    // Decode only what can be seen
+    connect(displayLayout, &QStackedLayout::currentChanged, this, &MainWindow::updateVideoVisibility);
     
     // Overlay Text (Manually positioned or added to layout on top?)
     // StackedLayout shows one widget at a time.
     // If we want overlay text on top of video, we might need a different approach 
-    // or just make videoOverlayText a child of videoLabel (as it was) 
+    // or just make videoOverlayText a child of videoView (as it was) 
     // AND create another one for audioVisualizer if needed, or handle it differently.
     // For simplicity, let's keep videoOverlayText as child of videoContainer and raise it.
     videoOverlayText = new QLabel("NO SIGNAL", videoContainer);
@@ -469,7 +559,8 @@ void MainWindow::onToggleStream()
             QMessageBox::warning(this, "Error", "Please enter an RTSP URL.");
             return;
         }
-        if (file.isEmpty() || !QFile::exists(file)) {
+        // The mosaic plays streams that are already published
+        if (!rbMosaic->isChecked() && (file.isEmpty() || !QFile::exists(file))) {
             QMessageBox::warning(this, "Error", "Please select a valid source file.");
             return;
         }
@@ -481,6 +572,8 @@ void MainWindow::onToggleStream()
         browseBtn->setEnabled(false);
         rbVideo->setEnabled(false);
         rbAudio->setEnabled(false);
+        rbMosaic->setEnabled(false);
+        decodeModeCombo->setEnabled(false);
         
         // Update Button Style for Stop
         btnToggle->setText("STOP STREAM");
@@ -500,6 +593,11 @@ void MainWindow::onToggleStream()
 
         setStatus("INITIALIZING...", "#FAB387"); // Orange
 
+        if (rbMosaic->isChecked()) {
+            startMosaicMode();
+            return;
+        }
+
         ensureMediaMtx();
         QThread::msleep(500);
 
@@ -523,9 +621,10 @@ void MainWindow::startVideoMode()
     ffmpegProcess = new QProcess(this);
     QStringList args;
     args << "-re" << "-stream_loop" << "-1" << "-i" << file
-         << "-c:v" << "libx264" << "-preset" << "ultrafast" << "-tune" << "zerolatency"
-         << "-b:v" << "1000k" << "-s" << "1280x720" << "-r" << "25" << "-an"
+         << publisherVideoArgs(publishCodec, publishBitrateKbps)
+         << "-s" << "1280x720" << "-r" << "25" << "-g" << "50" << "-an"
          << "-f" << "rtsp" << url;
+    log(QString("Publishing %1: %2").arg(publishCodec).arg(args.join(" ")));
     
     ffmpegProcess->setProgram("ffmpeg");
     ffmpegProcess->setArguments(args);
@@ -543,13 +642,51 @@ void MainWindow::startVideoMode()
 
     QThread::msleep(1500);
 
+    decoderThreading.mode = static_cast<DecoderThreadingMode>(decodeModeCombo->currentData().toInt());
+
     videoThread = new VideoThread(url, this);
+    videoThread->setTargetSize(videoView->size());
+    videoThread->setOutputYuv(renderOpenGL);
+    videoThread->setDecoderThreading(decoderThreading);
+    videoThread->setDecoderSelection(decoderSelection);
+    videoThread->setIoTimeouts(ioTimeouts);
+    videoThread->setTargetLatency(targetLatencyMs);
+    videoThread->setThreadPlacement(threadPlacement);
+    videoThread->setFrameExport(frameExport);
+    videoThread->setVideoFilter(videoFilter);
+    videoThread->setZoomRegion(zoomRegion);
     connect(videoThread, &VideoThread::frameReady, this, &MainWindow::updateFrame);
     connect(videoThread, &VideoThread::statsUpdated, this, &MainWindow::updateStats);
     connect(videoThread, &VideoThread::errorOccurred, this, &MainWindow::handleError);
+    connect(videoThread, &VideoThread::statusMessage, this, &MainWindow::log);
+    updateVideoVisibility();
     videoThread->start();
 }
 
+void MainWindow::startMosaicMode()
+{
+    log("Starting Mosaic Mode...");
+    QString text = urlInput->text();
+    text.replace(",", " ");
+    text.replace(";", " ");
+    QStringList urls = text.simplified().split(" ");
+    urls.removeAll(QString());
+
+    // Switch to Mosaic Page
+    displayLayout->setCurrentIndex(2);
+    videoOverlayText->clear();
+
+    decoderThreading.mode = static_cast<DecoderThreadingMode>(decodeModeCombo->currentData().toInt());
+    mosaicView->setDecoderThreading(decoderThreading);
+    mosaicView->setDecoderSelection(decoderSelection);
+    mosaicView->setIoTimeouts(ioTimeouts);
+    mosaicView->setThreadPlacement(threadPlacement);
+    mosaicView->start(urls);
+    updateVideoVisibility();
+
+    setStatus(QString("MOSAIC (%1)").arg(urls.size()), "#A6E3A1");
+}
+
 void MainWindow::startAudioMode()
 {
     log("Starting Audio Mode...");
@@ -584,6 +721,7 @@ void MainWindow::startAudioMode()
     videoThread = new VideoThread(url, this);
     connect(videoThread, &VideoThread::audioDataReady, this, &MainWindow::onAudioDataReady);
     connect(videoThread, &VideoThread::errorOccurred, this, &MainWindow::handleError);
+    connect(videoThread, &VideoThread::statusMessage, this, &MainWindow::log);
     videoThread->start();
 
     // Start ffplay in background for sound output (optional, but good for demo)
@@ -601,11 +739,22 @@ void MainWindow::stopAll()
     log("Stopping stream...");
     
     if (videoThread) {
+        // stop() interrupts any blocking network call, so this stays short
+        // even while the stream is down
+        QElapsedTimer stopTimer;
+        stopTimer.start();
         videoThread->stop();
         videoThread->wait();
+        log(QString("Video pipeline stopped in %1 ms").arg(stopTimer.elapsed()));
         delete videoThread;
         videoThread = nullptr;
     }
+    if (mosaicView->isRunning()) {
+        QElapsedTimer stopTimer;
+        stopTimer.start();
+        mosaicView->stop();
+        log(QString("Mosaic stopped in %1 ms").arg(stopTimer.elapsed()));
+    }
 
     if (ffmpegProcess) {
         ffmpegProcess->terminate();
@@ -630,7 +779,7 @@ void MainWindow::stopAll()
         mediaMtxProcess = nullptr;
     }
 
-    videoLabel->clear();
+    videoView->clearFrame();
     videoOverlayText->setText("NO SIGNAL");
     videoOverlayText->raise(); // Make sure overlay is visible
     // Center overlay text manually since it's child of container now
@@ -646,6 +795,8 @@ void MainWindow::stopAll()
     browseBtn->setEnabled(true);
     rbVideo->setEnabled(true);
     rbAudio->setEnabled(true);
+    rbMosaic->setEnabled(true);
+    decodeModeCombo->setEnabled(true);
 
     setStatus("READY", "#888888");
 
@@ -666,16 +817,198 @@ void MainWindow::stopAll()
     )");
 }
 
-void MainWindow::updateFrame(const QImage &image)
+void MainWindow::updateFrame()
 {
+    // Only the newest frame is ever pending; anything older was already dropped
+    QImage image;
+    if (!videoThread || !videoThread->takeFrame(image)) return;
+
     videoOverlayText->setText(""); // Hide text when video plays
-    QPixmap p = QPixmap::fromImage(image);
-    videoLabel->setPixmap(p.scaled(videoLabel->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
+
+    // Painted at the next display refresh; VideoThread already scaled RGB
+    // frames to fit, so that is a plain blit
+    videoView->setFrame(image);
 }
 
-void MainWindow::updateStats(int frameCount, double fps)
+void MainWindow::changeEvent(QEvent *event)
 {
-    fpsLabel->setText(QString("FPS: %1").arg(fps, 0, 'f', 1));
+    if (event->type() == QEvent::WindowStateChange) {
+        updateVideoVisibility();
+    }
+    QMainWindow::changeEvent(event);
+}
+
+// Minimized or on another page: let the decoders idle on keyframes
+void MainWindow::updateVideoVisibility()
+{
+    mosaicView->setViewVisible(!isMinimized() && displayLayout->currentIndex() == 2);
+    if (!videoThread) return;
+    videoThread->setViewVisible(!isMinimized() && displayLayout->currentIndex() == 0);
+}
+
+bool MainWindow::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == videoView && event->type() == QEvent::Resize && videoThread) {
+        videoThread->setTargetSize(videoView->size());
+    }
+    if (watched == videoView && handleZoomEvent(event)) {
+        return true;
+    }
+    return QMainWindow::eventFilter(watched, event);
+}
+
+bool MainWindow::handleZoomEvent(QEvent *event)
+{
+    const QRect frameRect = videoView->frameRect();
+    if (frameRect.isEmpty()) return false;
+
+    // Work in the coordinates of the frame as drawn
+    const QPoint origin = frameRect.topLeft();
+    const double frameWidth = frameRect.width();
+    const double frameHeight = frameRect.height();
+
+    switch (event->type()) {
+    case QEvent::Wheel: {
+        QWheelEvent *wheel = static_cast<QWheelEvent *>(event);
+        const double steps = wheel->angleDelta().y() / 120.0;
+        if (steps == 0) return false;
+        // Keep the source point under the cursor where it is
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+        const QPoint pos = wheel->position().toPoint() - origin;
+#else
+        const QPoint pos = wheel->pos() - origin;
+#endif
+        const double fx = qBound(0.0, pos.x() / frameWidth, 1.0);
+        const double fy = qBound(0.0, pos.y() / frameHeight, 1.0);
+        const double u = zoomRegion.x() + fx * zoomRegion.width();
+        const double v = zoomRegion.y() + fy * zoomRegion.height();
+        // Up to 16x; the region keeps the frame's aspect ratio
+        const double size = qBound(1.0 / 16, zoomRegion.width() * std::pow(0.8, steps), 1.0);
+        setZoomRegion(QRectF(u - fx * size, v - fy * size, size, size));
+        return true;
+    }
+    case QEvent::MouseButtonPress: {
+        QMouseEvent *mouse = static_cast<QMouseEvent *>(event);
+        if (mouse->button() != Qt::LeftButton || zoomRegion.width() >= 1.0) return false;
+        panning = true;
+        panStartPos = mouse->pos();
+        panStartRegion = zoomRegion;
+        return true;
+    }
+    case QEvent::MouseMove: {
+        if (!panning) return false;
+        QMouseEvent *mouse = static_cast<QMouseEvent *>(event);
+        const QPoint delta = mouse->pos() - panStartPos;
+        setZoomRegion(QRectF(panStartRegion.x() - delta.x() / frameWidth * panStartRegion.width(),
+                             panStartRegion.y() - delta.y() / frameHeight * panStartRegion.height(),
+                             panStartRegion.width(), panStartRegion.height()));
+        return true;
+    }
+    case QEvent::MouseButtonRelease:
+        if (!panning) return false;
+        panning = false;
+        return true;
+    case QEvent::MouseButtonDblClick:
+        setZoomRegion(QRectF(0, 0, 1, 1));
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Clamps to the frame and hands the region to the convert stage
+void MainWindow::setZoomRegion(const QRectF &region)
+{
+    const double width = qBound(1.0 / 16, region.width(), 1.0);
+    const double height = qBound(1.0 / 16, region.height(), 1.0);
+    zoomRegion = QRectF(qBound(0.0, region.x(), 1.0 - width),
+                        qBound(0.0, region.y(), 1.0 - height), width, height);
+    if (videoThread) {
+        videoThread->setZoomRegion(zoomRegion);
+    }
+}
+
+void MainWindow::updateStats(const VideoStats &stats)
+{
+    // CPU per role, in % of one core (live threads in parentheses)
+    cpuMonitor.sample();
+    QString cpuText;
+    for (int r = 0; r < THREAD_ROLE_COUNT; ++r) {
+        const ThreadCpuMonitor::RoleUsage &usage = cpuMonitor.usage(static_cast<ThreadRole>(r));
+        cpuText += QString("%1 %2% (%3), ").arg(threadRoleKey(static_cast<ThreadRole>(r)))
+                       .arg(usage.cpuPercent, 0, 'f', 0).arg(usage.threads);
+    }
+    cpuText += QString("other %1% (%2)").arg(cpuMonitor.other().cpuPercent, 0, 'f', 0).arg(cpuMonitor.other().threads);
+
+    // Queue figures are depth/high-water, so a stage that cannot keep up stands out
+    const VideoWidget::PaintStats paint = videoView->paintStats();
+    fpsLabel->setText(QString("FPS: %1 (paint %2 ms)  |  shown %3  dropped %4  static %5")
+                          .arg(stats.fps, 0, 'f', 1).arg(paint.msPerFrame, 0, 'f', 2)
+                          .arg(stats.framesDisplayed).arg(stats.framesDropped).arg(stats.staticSkips) +
+                      QString("  |  Q vpkt %1/%2  apkt %3/%4  frm %5/%6")
+                          .arg(stats.videoPackets.depth).arg(stats.videoPackets.highWater)
+                          .arg(stats.audioPackets.depth).arg(stats.audioPackets.highWater)
+                          .arg(stats.videoFrames.depth).arg(stats.videoFrames.highWater) +
+                      QString("  |  dec %1 ms +%2f")
+                          .arg(stats.decodeMsPerFrame, 0, 'f', 1).arg(stats.decoderLatencyFrames) +
+                      (stats.filterGraph.isEmpty() ? QString()
+                           : QString("  |  vf %1 ms").arg(stats.filterMsPerFrame, 0, 'f', 1)) +
+                      QString("  |  quality L%1 %2").arg(stats.degradeLevel).arg(stats.degradeName) +
+                      QString("  |  lat %1/%2 ms")
+                          .arg(stats.latencyMs < 0 ? QString("-") : QString::number(stats.latencyMs))
+                          .arg(stats.targetLatencyMs > 0 ? QString::number(stats.targetLatencyMs) : QString("off")) +
+                      QString("  |  sync %1 %2 ms jit %3 ms")
+                          .arg(stats.syncMaster).arg(stats.avDriftMs, 0, 'f', 0).arg(stats.pacingJitterMs, 0, 'f', 1) +
+                      (stats.reconnects > 0 ? QString("  |  reconn %1 (%2 ms)")
+                                                  .arg(stats.reconnects).arg(stats.lastRecoverMs)
+                                            : QString()));
+    fpsLabel->setToolTip(QString("Decoded %1, displayed %2, dropped %3\n")
+                             .arg(stats.framesDecoded).arg(stats.framesDisplayed).arg(stats.framesDropped) +
+                         QString("Frame pool: %1/%2 in use, exhausted %3, allocations %4 (after warm-up %5)")
+                             .arg(stats.poolInUse).arg(stats.poolSlots)
+                             .arg(stats.poolExhausted).arg(stats.poolAllocations)
+                             .arg(stats.poolSteadyAllocations) +
+                         QString("\nSteady-state allocations: packets %1, frames %2, audio chunks %3 (of %4)")
+                             .arg(stats.steadyPacketAllocations).arg(stats.steadyFrameAllocations)
+                             .arg(stats.audioChunkSteadyAllocations).arg(stats.audioChunkAllocations) +
+                         QString("\nColour conversion: %1 SIMD frames (%2), rest via swscale")
+                             .arg(stats.simdFrames).arg(stats.simdLevel) +
+                         QString("\nStatic scene: %1 unchanged frames not converted or repainted")
+                             .arg(stats.staticSkips) +
+                         QString("\nPaint: %1 (%2 ms/frame), %3 frames painted, %4 replaced before the next refresh")
+                             .arg(videoView->usesOpenGL() ? "OpenGL, YUV shader" : "raster, RGB32")
+                             .arg(paint.msPerFrame, 0, 'f', 2).arg(paint.painted).arg(paint.coalesced) +
+                         QString("\nDecoder: %1; %2 ms/frame, up to %3 fps (%4x stream rate)")
+                             .arg(stats.decoderThreading)
+                             .arg(stats.decodeMsPerFrame, 0, 'f', 2)
+                             .arg(stats.decodeCapacityFps, 0, 'f', 0)
+                             .arg(stats.streamFps > 0 ? stats.decodeCapacityFps / stats.streamFps : 0.0, 0, 'f', 1) +
+                         (stats.filterGraph.isEmpty() ? QString()
+                              : QString("\nFilter graph: %1; %2 ms/frame, %3 threads, %4 in / %5 out, built %6 times, queue %7/%8")
+                                    .arg(stats.filterGraph).arg(stats.filterMsPerFrame, 0, 'f', 2)
+                                    .arg(stats.filterThreads).arg(stats.filterFramesIn).arg(stats.filterFramesOut)
+                                    .arg(stats.filterGraphs)
+                                    .arg(stats.filteredFrames.depth).arg(stats.filteredFrames.highWater)) +
+                         QString("\nDecode quality: level %1 of 4 (%2), changed %3 times; lowered while the decoder falls behind live")
+                             .arg(stats.degradeLevel).arg(stats.degradeName).arg(stats.degradeChanges) +
+                         QString("\nLive latency: %1 ms, target %2 ms (%3); %4 jumps to a keyframe, %5 packets skipped")
+                             .arg(stats.latencyMs).arg(stats.targetLatencyMs).arg(stats.catchUpMode)
+                             .arg(stats.keyframeSkips).arg(stats.skippedPackets) +
+                         QString("\nView: %1, %2 packets left undecoded while hidden")
+                             .arg(stats.viewVisible ? "visible" : "hidden (keyframes only)")
+                             .arg(stats.hiddenSkippedPackets) +
+                         (stats.exportName.isEmpty() ? QString()
+                              : QString("\nShared-memory export %1: %2 frames, %3 failed")
+                                    .arg(stats.exportName).arg(stats.exportedFrames).arg(stats.exportFailures)) +
+                         QString("\nPacing: %1 clock, A/V drift %2 ms, jitter %3 ms, %4 late frames not converted, %5 clock resyncs")
+                             .arg(stats.syncMaster).arg(stats.avDriftMs, 0, 'f', 1).arg(stats.pacingJitterMs, 0, 'f', 1)
+                             .arg(stats.lateDrops).arg(stats.clockResyncs) +
+                         QString("\nTime to first frame: %1 ms (%2)")
+                             .arg(stats.timeToFirstFrameMs)
+                             .arg(stats.streamCacheHit ? "cached stream parameters" : "full probe") +
+                         QString("\nReconnects: %1, last recovery %2 ms, worst %3 ms")
+                             .arg(stats.reconnects).arg(stats.lastRecoverMs).arg(stats.maxRecoverMs) +
+                         QString("\nThread CPU: ") + cpuText);
 }
 
 void MainWindow::handleError(const QString &msg)
@@ -16,24 +16,38 @@
 #include <QFrame>
 #include <QSplitter>
 #include <QStackedLayout>
+#include <QComboBox>
 
 #include "videothread.h"
 #include "audiovisualizer.h"
+#include "videowidget.h"
+#include "mosaicview.h"
 #include "asrworker.h"
+#include "clientoptions.h"
+#include "decoderthreading.h"
+#include "iointerrupt.h"
+#include "livelatency.h"
+#include "threadplacement.h"
+#include "frameexport.h"
+#include "videofilter.h"
 
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
 
 public:
-    MainWindow(QWidget *parent = nullptr);
+    explicit MainWindow(const ClientOptions &options = ClientOptions(), QWidget *parent = nullptr);
     ~MainWindow();
 
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+    void changeEvent(QEvent *event) override;
+
 private slots:
     void onToggleStream(); // Combined Start/Stop
     void onBrowseClicked();
-    void updateFrame(const QImage &image);
-    void updateStats(int frameCount, double fps);
+    void updateFrame();
+    void updateStats(const VideoStats &stats);
     void handleError(const QString &msg);
     void processOutput();
     
@@ -46,8 +60,12 @@ private:
     void applyStyles();
     void startVideoMode();
     void startAudioMode();
+    void startMosaicMode();
     void stopAll();
     void log(const QString &msg);
+    void updateVideoVisibility();
+    bool handleZoomEvent(QEvent *event);
+    void setZoomRegion(const QRectF &region);
     void ensureMediaMtx();
     void setStatus(const QString &status, const QString &color = "#CDD6F4");
     
@@ -65,6 +83,8 @@ private:
     QPushButton *browseBtn;
     QRadioButton *rbVideo;
     QRadioButton *rbAudio;
+    QRadioButton *rbMosaic;
+    QComboBox *decodeModeCombo;
     
     // Actions
     QPushButton *btnToggle; // Start/Stop button
@@ -73,8 +93,9 @@ private:
     QFrame *rightPanel;
     QFrame *videoContainer;
     QStackedLayout *displayLayout; // Switch between Video and Visualizer
-    QLabel *videoLabel;
+    VideoWidget *videoView;
     AudioVisualizer *audioVisualizer;
+    MosaicView *mosaicView;
     QLabel *videoOverlayText; // For "No Signal" or Loading
     
     // Subtitle
@@ -95,6 +116,24 @@ private:
     QProcess *playerProcess; 
     
     bool isRunning;
+    DecoderThreadingPolicy decoderThreading; // from the command line; mode follows decodeModeCombo
+    DecoderSelection decoderSelection;       // --decoder-<codec>
+    QString publishCodec;                    // --publish-codec=h264|hevc|av1
+    int publishBitrateKbps;                  // --publish-bitrate, 0 = per-codec default
+    IoTimeouts ioTimeouts;                   // --open-timeout / --read-timeout
+    int targetLatencyMs;                     // --target-latency
+    ThreadPlacementConfig threadPlacement;   // --cpus-<role>, --nice-<role>, --sched-<role>
+    ThreadCpuMonitor cpuMonitor;             // sampled with every stats update
+    FrameExportConfig frameExport;           // --shm-export / --shm-slots / --shm-mode
+    VideoFilterConfig videoFilter;           // --vf / --filter-threads
+    bool renderOpenGL;                       // --render=gl: YUV planes to a shader instead of RGB32
+
+    // Digital zoom on the video view: wheel zooms around the cursor, drag
+    // pans, double-click resets. Normalized to the source frame.
+    QRectF zoomRegion;
+    bool panning;
+    QPoint panStartPos;
+    QRectF panStartRegion;
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,278 @@
+#include "mosaicview.h"
+#include "videothread.h"
+#include "videowidget.h"
+
+#include <QGridLayout>
+#include <QStackedLayout>
+#include <QEvent>
+#include <QImage>
+#include <QThread>
+
+MosaicView::MosaicView(QWidget *parent)
+    : QWidget(parent), focusThread_(nullptr), hasFocusStats_(false), focused_(-1), visible_(true),
+      lastSummaryMs_(0)
+{
+    pages_ = new QStackedLayout(this);
+    pages_->setStackingMode(QStackedLayout::StackOne);
+
+    gridPage_ = new QWidget(this);
+    grid_ = new QGridLayout(gridPage_);
+    grid_->setContentsMargins(0, 0, 0, 0);
+    grid_->setSpacing(2);
+    pages_->addWidget(gridPage_);
+
+    focusView_ = new VideoWidget(this);
+    focusView_->setMinimumSize(1, 1);
+    focusView_->setToolTip("Double-click: back to the grid");
+    focusView_->installEventFilter(this);
+    pages_->addWidget(focusView_);
+
+    clock_.start();
+}
+
+MosaicView::~MosaicView()
+{
+    stop();
+}
+
+int MosaicView::gridColumns(int count)
+{
+    if (count <= 4) return 2;
+    if (count <= 9) return 3;
+    return 4;
+}
+
+void MosaicView::start(const QStringList &urls)
+{
+    stop();
+    const int count = qMin(urls.size(), static_cast<int>(kMaxTiles));
+    if (urls.size() > kMaxTiles) {
+        emit statusMessage(QString("Mosaic shows at most %1 streams, %2 left out")
+                               .arg(kMaxTiles).arg(urls.size() - kMaxTiles));
+    }
+    const int columns = gridColumns(count);
+    const int rows = (count + columns - 1) / columns;
+
+    // Layout has not run yet for new tiles; this is the size they will get
+    const QSize cell(qMax(1, width() / columns), qMax(1, height() / rows));
+
+    tiles_.resize(count);
+    for (int i = 0; i < count; ++i) {
+        Tile &tile = tiles_[i];
+        tile.url = urls[i];
+        tile.view = new VideoWidget(gridPage_);
+        tile.view->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+        tile.view->setMinimumSize(1, 1);
+        tile.view->setToolTip(tile.url + "\nDouble-click: full resolution");
+        tile.view->resize(cell);
+        tile.view->installEventFilter(this);
+        grid_->addWidget(tile.view, i / columns, i % columns);
+        VideoThread *thread = startPipeline(tile.url, tile.view, true);
+        tile.thread = thread;
+        connect(thread, &VideoThread::statsUpdated, this, [this, i, thread](const VideoStats &stats) {
+            // Stats still queued from a mosaic that was stopped meanwhile are stale
+            if (i < tiles_.size() && tiles_[i].thread == thread) tileStats(i, stats);
+        });
+    }
+    // Equal cells, also when the last row is not full
+    for (int r = 0; r < rows; ++r) grid_->setRowStretch(r, 1);
+    for (int c = 0; c < columns; ++c) grid_->setColumnStretch(c, 1);
+    pages_->setCurrentIndex(0);
+    emit statusMessage(QString("Mosaic: %1 streams in a %2x%3 grid, tiles decoded at up to %4x%5")
+                           .arg(count).arg(columns).arg(rows).arg(cell.width()).arg(cell.height()));
+}
+
+VideoThread *MosaicView::startPipeline(const QString &url, VideoWidget *view, bool tile)
+{
+    VideoThread *thread = new VideoThread(url, this);
+    thread->setTargetSize(view->size());
+    thread->setVideoOnly(true);
+    thread->setDecoderSelection(decoderSelection_);
+    thread->setIoTimeouts(ioTimeouts_);
+    thread->setThreadPlacement(placement_);
+    if (tile) {
+        DecoderThreadingPolicy single;
+        single.mode = DECODE_THREADING_OFF;
+        thread->setDecoderThreading(single);
+        thread->setMaxDecodeSize(view->size());
+    } else {
+        thread->setDecoderThreading(focusThreading_);
+    }
+    connect(thread, &VideoThread::frameReady, view, [thread, view]() {
+        QImage image;
+        if (thread->takeFrame(image)) view->setFrame(image);
+    });
+    connect(thread, &VideoThread::errorOccurred, this, [this, url](const QString &msg) {
+        emit statusMessage(url + ": " + msg);
+    });
+    thread->start();
+    return thread;
+}
+
+void MosaicView::stopPipeline(VideoThread *&thread)
+{
+    if (!thread) return;
+    thread->stop();
+    thread->wait();
+    delete thread;
+    thread = nullptr;
+}
+
+void MosaicView::stop()
+{
+    stopPipeline(focusThread_);
+    hasFocusStats_ = false;
+    focused_ = -1;
+    focusView_->clearFrame();
+    // All at once: each stop() only interrupts, so the waits overlap
+    for (int i = 0; i < tiles_.size(); ++i) {
+        tiles_[i].thread->stop();
+    }
+    for (int i = 0; i < tiles_.size(); ++i) {
+        stopPipeline(tiles_[i].thread);
+        delete tiles_[i].view;
+    }
+    tiles_.clear();
+    for (int i = 0; i < 4; ++i) {
+        grid_->setRowStretch(i, 0);
+        grid_->setColumnStretch(i, 0);
+    }
+    pages_->setCurrentIndex(0);
+}
+
+void MosaicView::setViewVisible(bool visible)
+{
+    visible_ = visible;
+    applyVisibility();
+}
+
+// Only what is on screen decodes in full; the rest idles on keyframes
+void MosaicView::applyVisibility()
+{
+    for (int i = 0; i < tiles_.size(); ++i) {
+        tiles_[i].thread->setViewVisible(visible_ && focused_ < 0);
+    }
+    if (focusThread_) focusThread_->setViewVisible(visible_);
+}
+
+void MosaicView::focusTile(int index)
+{
+    if (index < 0 || index >= tiles_.size() || focused_ >= 0) return;
+    focused_ = index;
+    pages_->setCurrentIndex(1);
+    focusThread_ = startPipeline(tiles_[index].url, focusView_, false);
+    VideoThread *thread = focusThread_;
+    connect(thread, &VideoThread::statsUpdated, this, [this, thread](const VideoStats &stats) {
+        if (focusThread_ != thread) return;
+        focusStats_ = stats;
+        hasFocusStats_ = true;
+        maybePublishSummary();
+    });
+    applyVisibility();
+    emit statusMessage("Mosaic: full resolution for " + tiles_[index].url);
+}
+
+void MosaicView::unfocus()
+{
+    if (focused_ < 0) return;
+    stopPipeline(focusThread_);
+    hasFocusStats_ = false;
+    focusView_->clearFrame();
+    focused_ = -1;
+    pages_->setCurrentIndex(0);
+    // Tiles pick up again at their next keyframe
+    applyVisibility();
+}
+
+bool MosaicView::eventFilter(QObject *watched, QEvent *event)
+{
+    if (event->type() == QEvent::MouseButtonDblClick) {
+        if (watched == focusView_) {
+            unfocus();
+            return true;
+        }
+        for (int i = 0; i < tiles_.size(); ++i) {
+            if (watched == tiles_[i].view) {
+                focusTile(i);
+                return true;
+            }
+        }
+    } else if (event->type() == QEvent::Resize) {
+        // The decoder keeps the lowres step it opened with; scaling follows the tile
+        if (watched == focusView_ && focusThread_) {
+            focusThread_->setTargetSize(focusView_->size());
+        }
+        for (int i = 0; i < tiles_.size(); ++i) {
+            if (watched == tiles_[i].view && tiles_[i].thread) {
+                tiles_[i].thread->setTargetSize(tiles_[i].view->size());
+            }
+        }
+    }
+    return QWidget::eventFilter(watched, event);
+}
+
+void MosaicView::tileStats(int index, const VideoStats &stats)
+{
+    Tile &tile = tiles_[index];
+    const qint64 now = clock_.elapsed();
+    if (tile.hasStats && now > tile.sampleMs) {
+        const double seconds = (now - tile.sampleMs) / 1000.0;
+        tile.decodeFps = (stats.framesDecoded - tile.sampleDecoded) / seconds;
+        tile.cpuPercent = qMax<qint64>(0, stats.cpuUs - tile.sampleCpuUs) / 1e4 / seconds;
+    }
+    tile.stats = stats;
+    tile.hasStats = true;
+    tile.sampleMs = now;
+    tile.sampleDecoded = stats.framesDecoded;
+    tile.sampleCpuUs = stats.cpuUs;
+    maybePublishSummary();
+}
+
+// Tiles report every 25 frames handled; the summary goes out once a second
+void MosaicView::maybePublishSummary()
+{
+    const qint64 now = clock_.elapsed();
+    if (now - lastSummaryMs_ < 1000) return;
+    lastSummaryMs_ = now;
+    publishSummary();
+}
+
+void MosaicView::publishSummary()
+{
+    double totalFps = 0.0;
+    double totalCpu = 0.0;
+    int reporting = 0;
+    QString details;
+    for (int i = 0; i < tiles_.size(); ++i) {
+        const Tile &tile = tiles_[i];
+        if (!tile.hasStats) {
+            details += QString("\n#%1 %2: connecting").arg(i + 1).arg(tile.url);
+            continue;
+        }
+        reporting++;
+        totalFps += tile.decodeFps;
+        totalCpu += tile.cpuPercent;
+        details += QString("\n#%1 %2: %3 fps decoded, %4 ms/frame, %5, CPU %6%")
+                       .arg(i + 1).arg(tile.url).arg(tile.decodeFps, 0, 'f', 1)
+                       .arg(tile.stats.decodeMsPerFrame, 0, 'f', 2)
+                       .arg(tile.stats.lowres > 0 ? QString("lowres 1/%1").arg(1 << tile.stats.lowres)
+                                                  : QString("full size, scaled"))
+                       .arg(tile.cpuPercent, 0, 'f', 0);
+    }
+
+    // What one more tile like the average costs, against the cores there are
+    const int cores = QThread::idealThreadCount();
+    const double perTile = reporting > 0 ? totalCpu / reporting : 0.0;
+    QString summary = QString("Mosaic %1 tiles: %2 fps decoded, CPU %3% (%4% per tile")
+                          .arg(tiles_.size()).arg(totalFps, 0, 'f', 0)
+                          .arg(totalCpu, 0, 'f', 0).arg(perTile, 0, 'f', 0);
+    if (perTile > 0 && cores > 0) {
+        summary += QString(", ~%1 feeds on %2 cores").arg(static_cast<int>(cores * 100 / perTile)).arg(cores);
+    }
+    summary += ")";
+    if (focused_ >= 0) {
+        summary += QString("  |  focused #%1 %2 fps").arg(focused_ + 1)
+                       .arg(hasFocusStats_ ? focusStats_.fps : 0.0, 0, 'f', 1);
+    }
+    emit summaryUpdated(summary, "Per tile (CPU in % of one core, pipeline threads only):" + details);
+}
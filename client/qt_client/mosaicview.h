@@ -0,0 +1,106 @@
+#ifndef MOSAICVIEW_H
+#define MOSAICVIEW_H
+
+#include <QWidget>
+#include <QVector>
+#include <QStringList>
+#include <QElapsedTimer>
+
+#include "videostats.h"
+#include "decoderthreading.h"
+#include "decoderselect.h"
+#include "iointerrupt.h"
+#include "threadplacement.h"
+
+class QGridLayout;
+class QStackedLayout;
+class VideoThread;
+class VideoWidget;
+
+// Several RTSP streams at once, in a 2x2, 3x3 or 4x4 grid.
+//
+// Each tile runs its own video-only pipeline, decoded no larger than the
+// tile: lowres where the codec has it, otherwise scaled down by the convert
+// stage. Tile decoders are single-threaded; the tiles themselves spread over
+// the cores. Double-clicking a tile opens a full-resolution pipeline for that
+// stream alone while the tiles idle on keyframes; double-clicking again goes
+// back to the grid.
+class MosaicView : public QWidget
+{
+    Q_OBJECT
+public:
+    static const int kMaxTiles = 16;
+
+    explicit MosaicView(QWidget *parent = nullptr);
+    ~MosaicView();
+
+    // The focused stream decodes with this threading policy; tiles decode single-threaded
+    void setDecoderThreading(const DecoderThreadingPolicy &policy) { focusThreading_ = policy; }
+    void setDecoderSelection(const DecoderSelection &selection) { decoderSelection_ = selection; }
+    void setIoTimeouts(const IoTimeouts &timeouts) { ioTimeouts_ = timeouts; }
+    void setThreadPlacement(const ThreadPlacementConfig &config) { placement_ = config; }
+
+    // Starts one tile per URL, up to kMaxTiles
+    void start(const QStringList &urls);
+    void stop();
+    bool isRunning() const { return !tiles_.isEmpty(); }
+
+    // Minimized or on another page: every pipeline idles on keyframes
+    void setViewVisible(bool visible);
+
+    // 2, 3 or 4 columns for this many streams
+    static int gridColumns(int count);
+
+signals:
+    // About once a second: one line for the status bar and per-tile details
+    void summaryUpdated(const QString &summary, const QString &details);
+    void statusMessage(const QString &msg);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    struct Tile {
+        QString url;
+        VideoWidget *view = nullptr;
+        VideoThread *thread = nullptr;
+        VideoStats stats;
+        bool hasStats = false;
+        // Previous stats sample, for rates
+        qint64 sampleMs = 0;
+        qint64 sampleDecoded = 0;
+        qint64 sampleCpuUs = 0;
+        double decodeFps = 0.0;
+        double cpuPercent = 0.0;
+    };
+
+    VideoThread *startPipeline(const QString &url, VideoWidget *view, bool tile);
+    void stopPipeline(VideoThread *&thread);
+    void tileStats(int index, const VideoStats &stats);
+    void focusTile(int index);
+    void unfocus();
+    void applyVisibility();
+    void maybePublishSummary();
+    void publishSummary();
+
+    QStackedLayout *pages_;
+    QWidget *gridPage_;
+    QGridLayout *grid_;
+    VideoWidget *focusView_;
+    VideoThread *focusThread_;
+    VideoStats focusStats_;
+    bool hasFocusStats_;
+    int focused_;                 // -1 while the grid is shown
+    bool visible_;
+
+    QVector<Tile> tiles_;
+    QElapsedTimer clock_;
+    qint64 lastSummaryMs_;
+
+    DecoderThreadingPolicy focusThreading_;
+    DecoderSelection decoderSelection_;
+    IoTimeouts ioTimeouts_;
+    ThreadPlacementConfig placement_;
+};
+
+#endif // MOSAICVIEW_H
@@ -0,0 +1,118 @@
+#include "presentscheduler.h"
+
+#include <QtGlobal>
+#include <cstdlib>
+
+namespace {
+// Audio that has not advanced for this long no longer drives video
+const qint64 kAudioStaleUs = 500000;
+// A frame further ahead of the clock than this is a timestamp jump
+// (reconnect, keyframe skip), not something to wait for
+const qint64 kMaxWaitUs = 1000000;
+}
+
+MediaClock::MediaClock()
+    : valid_(false), ptsUs_(0), updatedUs_(0)
+{
+}
+
+void MediaClock::set(qint64 ptsUs, qint64 nowUs)
+{
+    QMutexLocker locker(&mutex_);
+    ptsUs_ = ptsUs;
+    updatedUs_ = nowUs;
+    valid_ = true;
+}
+
+void MediaClock::reset()
+{
+    QMutexLocker locker(&mutex_);
+    valid_ = false;
+}
+
+bool MediaClock::get(qint64 nowUs, qint64 &ptsUs) const
+{
+    QMutexLocker locker(&mutex_);
+    if (!valid_ || nowUs - updatedUs_ > kAudioStaleUs) return false;
+    ptsUs = ptsUs_ + (nowUs - updatedUs_);
+    return true;
+}
+
+PresentScheduler::PresentScheduler(const MediaClock *audioClock)
+    : audioClock_(audioClock)
+{
+    reset(40000);
+}
+
+void PresentScheduler::reset(qint64 frameIntervalUs)
+{
+    frameIntervalUs_ = frameIntervalUs > 0 ? frameIntervalUs : 40000;
+    anchored_ = false;
+    anchorPtsUs_ = 0;
+    anchorWallUs_ = 0;
+    havePresented_ = false;
+    lastPtsUs_ = 0;
+    lastPresentUs_ = 0;
+    jitterUs_ = 0.0;
+    stats_ = Stats();
+}
+
+void PresentScheduler::anchor(qint64 ptsUs, qint64 nowUs)
+{
+    anchored_ = true;
+    anchorPtsUs_ = ptsUs;
+    anchorWallUs_ = nowUs;
+    stats_.resyncs++;
+}
+
+PresentScheduler::Decision PresentScheduler::schedule(qint64 ptsUs, qint64 nowUs, bool newerFrameQueued,
+                                                      qint64 &waitUs)
+{
+    qint64 audioUs = 0;
+    stats_.audioMaster = audioClock_ && audioClock_->get(nowUs, audioUs);
+
+    qint64 clockUs;
+    if (stats_.audioMaster) {
+        clockUs = audioUs;
+    } else {
+        if (!anchored_) anchor(ptsUs, nowUs);
+        clockUs = anchorPtsUs_ + (nowUs - anchorWallUs_);
+    }
+
+    qint64 aheadUs = ptsUs - clockUs;
+    if (aheadUs > kMaxWaitUs || aheadUs < -kMaxWaitUs) {
+        // Timestamps jumped: show it now and follow the new timeline
+        if (!stats_.audioMaster) anchor(ptsUs, nowUs);
+        waitUs = 0;
+        return PRESENT;
+    }
+    if (aheadUs < -frameIntervalUs_ && newerFrameQueued) {
+        stats_.lateDrops++;
+        waitUs = 0;
+        return DROP_LATE;
+    }
+    if (aheadUs < -frameIntervalUs_ && !stats_.audioMaster) {
+        // Late but nothing newer to show: the stream itself was late, so the
+        // wall clock follows it instead of counting every frame after as late
+        anchor(ptsUs, nowUs);
+    }
+    waitUs = qMax<qint64>(0, aheadUs);
+    return PRESENT;
+}
+
+void PresentScheduler::presented(qint64 ptsUs, qint64 nowUs)
+{
+    qint64 audioUs = 0;
+    if (audioClock_ && audioClock_->get(nowUs, audioUs)) {
+        stats_.avDriftUs = ptsUs - audioUs;
+    }
+
+    if (havePresented_) {
+        qint64 deviation = (nowUs - lastPresentUs_) - (ptsUs - lastPtsUs_);
+        jitterUs_ += (std::llabs(deviation) - jitterUs_) / 16.0;
+        stats_.jitterUs = static_cast<qint64>(jitterUs_);
+    }
+    havePresented_ = true;
+    lastPtsUs_ = ptsUs;
+    lastPresentUs_ = nowUs;
+}
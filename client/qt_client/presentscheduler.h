@@ -0,0 +1,78 @@
+#ifndef PRESENTSCHEDULER_H
+#define PRESENTSCHEDULER_H
+
+#include <QMutex>
+#include <QtGlobal>
+
+// Stream time that advances with the wall clock from the last time it was
+// set. The audio decode stage sets it as samples leave for the visualizer
+// and ASR; the convert stage reads it. Times are microseconds, "now" on the
+// av_gettime_relative() clock.
+class MediaClock
+{
+public:
+    MediaClock();
+
+    void set(qint64 ptsUs, qint64 nowUs);
+    void reset();
+
+    // Current stream time, or false when unset or not updated for too long
+    // (audio stopped arriving)
+    bool get(qint64 nowUs, qint64 &ptsUs) const;
+
+private:
+    mutable QMutex mutex_;
+    bool valid_;
+    qint64 ptsUs_;
+    qint64 updatedUs_;
+};
+
+// Decides when each converted frame goes to the GUI. Frames are released at
+// their PTS against the master clock: the audio clock while audio flows, else
+// a wall clock anchored to the video itself. Frames already late by more than
+// a frame interval are not worth converting when a newer one is waiting.
+// Convert stage only.
+class PresentScheduler
+{
+public:
+    enum Decision {
+        PRESENT,     // convert, wait waitUs, then post
+        DROP_LATE    // skip: late and a newer frame is queued
+    };
+
+    struct Stats {
+        bool audioMaster = false;
+        qint64 avDriftUs = 0;   // video PTS minus audio clock at presentation
+        qint64 jitterUs = 0;    // RFC 3550-style smoothed |actual - PTS interval|
+        qint64 lateDrops = 0;
+        qint64 resyncs = 0;     // wall clock re-anchored (start, gap or late frame)
+    };
+
+    explicit PresentScheduler(const MediaClock *audioClock = nullptr);
+
+    void reset(qint64 frameIntervalUs);
+
+    Decision schedule(qint64 ptsUs, qint64 nowUs, bool newerFrameQueued, qint64 &waitUs);
+    void presented(qint64 ptsUs, qint64 nowUs);
+
+    const Stats &stats() const { return stats_; }
+
+private:
+    void anchor(qint64 ptsUs, qint64 nowUs);
+
+    const MediaClock *audioClock_;
+    qint64 frameIntervalUs_;
+
+    bool anchored_;
+    qint64 anchorPtsUs_;
+    qint64 anchorWallUs_;
+
+    bool havePresented_;
+    qint64 lastPtsUs_;
+    qint64 lastPresentUs_;
+    double jitterUs_;
+
+    Stats stats_;
+};
+
+#endif // PRESENTSCHEDULER_H
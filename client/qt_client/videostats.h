@@ -0,0 +1,112 @@
+#ifndef VIDEOSTATS_H
+#define VIDEOSTATS_H
+
+#include <QMetaType>
+#include <QString>
+
+// Snapshot of one bounded queue between two pipeline stages
+struct QueueStats {
+    int depth = 0;
+    int highWater = 0;
+    int capacity = 0;
+};
+
+// Periodic pipeline statistics published by VideoThread::statsUpdated
+struct VideoStats {
+    int frameCount = 0;
+    double fps = 0.0;
+
+    // Decoded by the codec, picked up by the GUI, overwritten in the mailbox
+    qint64 framesDecoded = 0;
+    qint64 framesDisplayed = 0;
+    qint64 framesDropped = 0;
+
+    QueueStats videoPackets;
+    QueueStats audioPackets;
+    QueueStats videoFrames;
+    QueueStats filteredFrames;
+
+    // Filter graph stage (empty graph = no filter): cost per input frame of
+    // the graph currently built, and how often it had to be rebuilt
+    QString filterGraph;
+    double filterMsPerFrame = 0.0;
+    qint64 filterFramesIn = 0;
+    qint64 filterFramesOut = 0;
+    qint64 filterGraphs = 0;
+    int filterThreads = 0;
+
+    // RGB frame buffer pool shared with the GUI
+    int poolSlots = 0;
+    int poolInUse = 0;
+    qint64 poolExhausted = 0;
+    qint64 poolAllocations = 0;
+    qint64 poolSteadyAllocations = 0;
+
+    // Packet/frame shells and audio chunks allocated after warm-up (should stay 0)
+    qint64 steadyPacketAllocations = 0;
+    qint64 steadyFrameAllocations = 0;
+    qint64 audioChunkAllocations = 0;
+    qint64 audioChunkSteadyAllocations = 0;
+
+    // Colour conversion: frames that took the SIMD kernels instead of swscale
+    QString simdLevel;
+    qint64 simdFrames = 0;
+
+    // Frames that matched the one on screen and were neither converted nor repainted
+    qint64 staticSkips = 0;
+
+    // Video decoder threading and what it buys: latency added by frame
+    // threading versus the frame rate the decode stage could sustain
+    QString decoderThreading;
+    int lowres = 0;   // decoding at 1/2^lowres of the stream resolution
+    int decoderLatencyFrames = 0;
+    double decodeMsPerFrame = 0.0;
+    double decodeCapacityFps = 0.0;
+    double streamFps = 0.0;
+
+    // Quality given up to keep up with live when decoding falls behind
+    int degradeLevel = 0;
+    QString degradeName;
+    int degradeChanges = 0;
+
+    // Distance from the live edge and what the latency controller did about it
+    qint64 latencyMs = -1;
+    int targetLatencyMs = 0;
+    QString catchUpMode;
+    int keyframeSkips = 0;
+    qint64 skippedPackets = 0;
+
+    // Packets not decoded because the video was not visible
+    bool viewVisible = true;
+    qint64 hiddenSkippedPackets = 0;
+
+    // Decoded frames published to the shared-memory ring (empty name = off)
+    QString exportName;
+    qint64 exportedFrames = 0;
+    qint64 exportFailures = 0;
+
+    // Presentation pacing: which clock frames follow, how far video sits from
+    // the audio clock, and how evenly frames leave compared to their PTS
+    QString syncMaster;
+    double avDriftMs = 0.0;
+    double pacingJitterMs = 0.0;
+    qint64 lateDrops = 0;
+    qint64 clockResyncs = 0;
+
+    // Connect-to-first-frame time, with or without the stream parameter cache
+    bool streamCacheHit = false;
+    qint64 timeToFirstFrameMs = -1;
+
+    // CPU time of this pipeline's own threads since it started (libav's
+    // frame threads not included), to compare the cost of streams
+    qint64 cpuUs = 0;
+
+    // Stream drops survived and how long getting the picture back took
+    int reconnects = 0;
+    qint64 lastRecoverMs = 0;
+    qint64 maxRecoverMs = 0;
+};
+
+Q_DECLARE_METATYPE(VideoStats)
+
+#endif // VIDEOSTATS_H
@@ -1,13 +1,121 @@
 #include "videothread.h"
 #include <QDebug>
 #include <QDateTime>
+#include <chrono>
+
+extern "C" {
+#include <libavutil/time.h>
+}
+
+namespace {
+// Queue depths between stages. Packets are small, decoded frames are not,
+// so the frame queue is kept short to bound both memory and display latency.
+const size_t kVideoPacketQueueSize = 64;
+const size_t kAudioPacketQueueSize = 64;
+const size_t kVideoFrameQueueSize = 4;
+// Shells in flight can never exceed the queue in front of a stage plus what
+// the stages hold; a little headroom covers the flush markers
+const size_t kFreePacketListSize = 72;
+const size_t kFreeFrameListSize = 8;
+const int kAudioChunks = 16;
+
+// Display-sized RGB32 buffers shared with the GUI. Enough for the frames queued towards the
+// GUI plus the one being painted; allocations after warm-up indicate a leak
+// or a resolution change.
+const int kFramePoolSlots = 6;
+const int kPoolWarmupFrames = 50;
+// Units (packets/frames) per stage before the allocation check starts
+const int kAllocCheckWarmup = 250;
+
+// After a reconnect the demux stage queues an empty packet to tell a decode
+// stage to drop its references into the old stream. av_read_frame() never
+// returns a packet without data.
+bool isFlushPacket(const AVPacket *packet)
+{
+    return !packet->data && packet->size == 0 && packet->side_data_elems == 0;
+}
+
+// Presentation time in microseconds (decode time when the demuxer gave none)
+int64_t packetTimeUs(const AVPacket *packet, AVRational timeBase)
+{
+    int64_t ts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+    if (ts == AV_NOPTS_VALUE) return AV_NOPTS_VALUE;
+    return av_rescale_q(ts, timeBase, AV_TIME_BASE_Q);
+}
+
+int64_t frameTimeUs(const AVFrame *frame, AVRational timeBase)
+{
+    int64_t ts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
+    if (ts == AV_NOPTS_VALUE) return AV_NOPTS_VALUE;
+    return av_rescale_q(ts, timeBase, AV_TIME_BASE_Q);
+}
+
+// Zoom regions travel as one atomic word so a pan never tears between fields
+quint64 packZoomRegion(const QRectF &region)
+{
+    auto unit = [](double v) { return static_cast<quint64>(qBound(0.0, v, 1.0) * 65535.0 + 0.5); };
+    return unit(region.x()) | unit(region.y()) << 16 | unit(region.width()) << 32 | unit(region.height()) << 48;
+}
+
+QRectF unpackZoomRegion(quint64 packed)
+{
+    auto fraction = [packed](int shift) { return ((packed >> shift) & 0xffff) / 65535.0; };
+    return QRectF(fraction(0), fraction(16), fraction(32), fraction(48));
+}
+
+// libav* calls: what they allocate internally (refs around pooled buffers)
+// is not ours to remove, so the steady-state allocation check skips it
+int readPacket(AVFormatContext *ctx, AVPacket *packet)
+{
+    UncountedAllocScope libav;
+    return av_read_frame(ctx, packet);
+}
+
+int sendPacket(AVCodecContext *ctx, const AVPacket *packet)
+{
+    UncountedAllocScope libav;
+    return avcodec_send_packet(ctx, packet);
+}
+
+int receiveFrame(AVCodecContext *ctx, AVFrame *frame)
+{
+    UncountedAllocScope libav;
+    return avcodec_receive_frame(ctx, frame);
+}
+
+void fillQueueStats(QueueStats &out, size_t depth, size_t highWater, size_t capacity)
+{
+    out.depth = static_cast<int>(depth);
+    out.highWater = static_cast<int>(highWater);
+    out.capacity = static_cast<int>(capacity);
+}
+}
 
 VideoThread::VideoThread(const QString &url, QObject *parent)
     : QThread(parent), url_(url), running_(true),
-      formatCtx_(nullptr), 
-      vCodecCtx_(nullptr), vCodec_(nullptr), swsCtx_(nullptr), videoStreamIndex_(-1), frameCount_(0),
-      aCodecCtx_(nullptr), aCodec_(nullptr), swrCtx_(nullptr), audioStreamIndex_(-1)
+      formatCtx_(nullptr), videoParams_(nullptr), audioParams_(nullptr),
+      reconnects_(0), lastRecoverMs_(0), maxRecoverMs_(0), videoOnly_(false),
+      streamCacheHit_(false), openStartMs_(0), timeToFirstFrameMs_(-1),
+      vCodecCtx_(nullptr), vCodec_(nullptr), videoStreamIndex_(-1), lowres_(0),
+      decoderLatencyFrames_(0), streamFps_(0.0), videoTimeBase_(AVRational{1, 90000}), scheduler_(&audioClock_), frameCount_(0), startTime_(0),
+      aCodecCtx_(nullptr), aCodec_(nullptr), swrCtx_(nullptr), audioStreamIndex_(-1), audioTimeBase_(AVRational{1, 48000}),
+      stagesRunning_(false),
+      videoPackets_(kVideoPacketQueueSize), audioPackets_(kAudioPacketQueueSize),
+      videoFrames_(kVideoFrameQueueSize), filteredFrames_(kVideoFrameQueueSize),
+      freeVideoPackets_(kFreePacketListSize), freeAudioPackets_(kFreePacketListSize),
+      freeVideoFrames_(kFreeFrameListSize), freeFilteredFrames_(kFreeFrameListSize),
+      convertInput_(&videoFrames_), convertFreeList_(&freeVideoFrames_),
+      pipelineWarm_(false), steadyPacketAllocs_(0), steadyFrameAllocs_(0),
+      audioChunks_(kAudioChunks),
+      framePool_(FramePool::create(kFramePoolSlots)),
+      targetWidth_(0), targetHeight_(0), zoomRegion_(packZoomRegion(QRectF(0, 0, 1, 1))),
+      decodedFrames_(0), staticSkips_(0), degradeLevel_(DEGRADE_NONE), degradeChanges_(0),
+      latencyMs_(-1), catchUpMode_(CATCHUP_NONE), keyframeSkips_(0), skippedPackets_(0),
+      viewVisible_(true), hiddenSkippedPackets_(0), frameExport_(nullptr), filter_(nullptr),
+      outputYuv_(false), simdFrames_(0)
 {
+    qRegisterMetaType<VideoStats>("VideoStats");
+    interrupter_.watch(&running_);
 }
 
 VideoThread::~VideoThread()
@@ -15,32 +123,115 @@ VideoThread::~VideoThread()
     stop();
     wait();
     cleanup();
+    drainFreeLists();
+    framePool_->release();
+    delete frameExport_;
+    delete filter_;
 }
 
 void VideoThread::stop()
 {
-    QMutexLocker locker(&mutex_);
     running_ = false;
+    // The demux stage may be asleep on a full packet queue
+    videoPackets_.wakeAll();
+    audioPackets_.wakeAll();
 }
 
-void VideoThread::cleanup()
+bool VideoThread::takeFrame(QImage &image)
 {
-    if (swsCtx_) {
-        sws_freeContext(swsCtx_);
-        swsCtx_ = nullptr;
-    }
-    if (swrCtx_) {
-        swr_free(&swrCtx_);
-        swrCtx_ = nullptr;
-    }
-    if (vCodecCtx_) {
-        avcodec_free_context(&vCodecCtx_);
-        vCodecCtx_ = nullptr;
-    }
-    if (aCodecCtx_) {
-        avcodec_free_context(&aCodecCtx_);
-        aCodecCtx_ = nullptr;
+    return mailbox_.take(image);
+}
+
+void VideoThread::setTargetSize(const QSize &size)
+{
+    targetWidth_ = size.width();
+    targetHeight_ = size.height();
+}
+
+void VideoThread::setOutputYuv(bool yuv)
+{
+    outputYuv_ = yuv;
+}
+
+void VideoThread::setZoomRegion(const QRectF &region)
+{
+    zoomRegion_ = packZoomRegion(region);
+}
+
+QRectF VideoThread::zoomRegion() const
+{
+    return unpackZoomRegion(zoomRegion_);
+}
+
+void VideoThread::setDecoderThreading(const DecoderThreadingPolicy &policy)
+{
+    decoderThreading_ = policy;
+}
+
+void VideoThread::setDecoderSelection(const DecoderSelection &selection)
+{
+    decoderSelection_ = selection;
+}
+
+void VideoThread::setIoTimeouts(const IoTimeouts &timeouts)
+{
+    interrupter_.setTimeouts(timeouts);
+}
+
+void VideoThread::setViewVisible(bool visible)
+{
+    viewVisible_ = visible;
+}
+
+void VideoThread::setTargetLatency(int ms)
+{
+    latencyControl_.setTargetMs(ms);
+}
+
+void VideoThread::setThreadPlacement(const ThreadPlacementConfig &config)
+{
+    placement_ = config;
+}
+
+void VideoThread::setFrameExport(const FrameExportConfig &config)
+{
+    delete frameExport_;
+    frameExport_ = config.name.empty() ? nullptr : new FrameShmExporter(config);
+}
+
+void VideoThread::setVideoFilter(const VideoFilterConfig &config)
+{
+    delete filter_;
+    filter_ = config.graph.empty() ? nullptr : new VideoFilterStage(config);
+}
+
+void VideoThread::setMaxDecodeSize(const QSize &size)
+{
+    maxDecodeSize_ = size;
+}
+
+void VideoThread::setVideoOnly(bool videoOnly)
+{
+    videoOnly_ = videoOnly;
+}
+
+void VideoThread::placeThread(ThreadRole role)
+{
+    placeThread(role, placement_[role]);
+}
+
+void VideoThread::placeThread(ThreadRole role, const ThreadPlacement &placement)
+{
+    std::string error;
+    if (!applyThreadPlacement(role, placement, &error)) {
+        emit statusMessage(QString("Thread placement for %1 not fully applied: %2")
+                               .arg(threadRoleKey(role)).arg(QString::fromStdString(error)));
     }
+}
+
+void VideoThread::cleanup()
+{
+    closeDecoders();
     if (formatCtx_) {
         avformat_close_input(&formatCtx_);
         formatCtx_ = nullptr;
@@ -48,66 +239,170 @@ void VideoThread::cleanup()
 }
 
 void VideoThread::run()
+{
+    placeThread(THREAD_ROLE_DEMUX);
+    ThreadCpuGroup::Scope cpuScope(cpu_);
+    openStartMs_ = QDateTime::currentMSecsSinceEpoch();
+    timeToFirstFrameMs_ = -1;
+
+    QString error;
+    if (!openInput(error)) {
+        if (running_) emit errorOccurred(error);
+        return;
+    }
+    if (!openDecoders()) {
+        emit errorOccurred("No usable video or audio stream found");
+        return;
+    }
+
+    startStages();
+
+    // Demux stage: read packets and hand them to the per-stream decode stages
+    AVPacket* packet = av_packet_alloc();
+    SteadyStateAllocCheck allocCheck("demux", kAllocCheckWarmup);
+
+    while (running_) {
+        interrupter_.beginRead();
+        int ret = readPacket(formatCtx_, packet);
+        if (ret >= 0) {
+            SpscQueue<AVPacket*>* queue = nullptr;
+            if (packet->stream_index == videoStreamIndex_ && videoStreamIndex_ != -1) {
+                queue = &videoPackets_;
+            } else if (packet->stream_index == audioStreamIndex_ && audioStreamIndex_ != -1) {
+                queue = &audioPackets_;
+            }
+
+            if (queue == &videoPackets_) {
+                int64_t ptsUs = packetTimeUs(packet, videoTimeBase_);
+                if (ptsUs != AV_NOPTS_VALUE) latency_.packetArrived(ptsUs, av_gettime_relative());
+            }
+            if (queue) {
+                AVPacket* queued = allocPacket(queue == &videoPackets_ ? freeVideoPackets_ : freeAudioPackets_);
+                av_packet_move_ref(queued, packet);
+                if (!queue->push(queued, running_)) {
+                    av_packet_free(&queued);
+                }
+            }
+            av_packet_unref(packet);
+            allocCheck.unitDone();
+        } else if (!running_) {
+            break;  // stop() interrupted the read
+        } else if (ret == AVERROR(EAGAIN)) {
+            msleep(5);
+        } else {
+            // Reopening allocates plenty, but only once per outage
+            UncountedAllocScope reopen;
+            if (interrupter_.timedOut()) {
+                qDebug() << "No data for" << interrupter_.timeouts().readMs << "ms, treating the stream as lost";
+            }
+            if (!reconnect()) break;
+        }
+    }
+
+    av_packet_free(&packet);
+    stopStages();
+}
+
+bool VideoThread::openInput(QString &error)
 {
     formatCtx_ = avformat_alloc_context();
+    interrupter_.install(formatCtx_);
+    interrupter_.beginOpen();
     AVDictionary* options = nullptr;
     av_dict_set(&options, "rtsp_transport", "tcp", 0);
     av_dict_set(&options, "max_delay", "500000", 0);
 
     // Try to open input
-    if (avformat_open_input(&formatCtx_, url_.toStdString().c_str(), nullptr, &options) != 0) {
-        emit errorOccurred("Failed to open RTSP stream");
-        return;
-    }
+    int ret = avformat_open_input(&formatCtx_, url_.toStdString().c_str(), nullptr, &options);
     av_dict_free(&options);
+    if (ret != 0) {
+        error = interrupter_.timedOut() ? "Timed out opening RTSP stream" : "Failed to open RTSP stream";
+        return false;
+    }
 
-    if (avformat_find_stream_info(formatCtx_, nullptr) < 0) {
-        emit errorOccurred("Failed to find stream info");
-        return;
+    // A camera seen before only needs a tiny probe on top of its cached parameters
+    bool cacheHit = false;
+    if (streamCache_.findStreamInfo(formatCtx_, url_.toStdString(), &cacheHit) < 0) {
+        error = "Failed to find stream info";
+        avformat_close_input(&formatCtx_);
+        return false;
     }
+    streamCacheHit_ = cacheHit;
 
-    // Find Video Stream
     videoStreamIndex_ = -1;
+    audioStreamIndex_ = -1;
     for (unsigned int i = 0; i < formatCtx_->nb_streams; i++) {
-        if (formatCtx_->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+        AVMediaType type = formatCtx_->streams[i]->codecpar->codec_type;
+        if (type == AVMEDIA_TYPE_VIDEO && videoStreamIndex_ == -1) {
             videoStreamIndex_ = i;
-            break;
+        } else if (type == AVMEDIA_TYPE_AUDIO && audioStreamIndex_ == -1 && !videoOnly_) {
+            audioStreamIndex_ = i;
         }
     }
+    return true;
+}
 
+bool VideoThread::openDecoders()
+{
     if (videoStreamIndex_ != -1) {
         AVCodecParameters* codecParams = formatCtx_->streams[videoStreamIndex_]->codecpar;
-        vCodec_ = avcodec_find_decoder(codecParams->codec_id);
+        vCodec_ = selectDecoder(codecParams->codec_id, decoderSelection_);
         if (vCodec_) {
             vCodecCtx_ = avcodec_alloc_context3(vCodec_);
             avcodec_parameters_to_context(vCodecCtx_, codecParams);
-            vCodecCtx_->flags2 |= AV_CODEC_FLAG2_CHUNKS;
-            vCodecCtx_->flags |= AV_CODEC_FLAG_LOW_DELAY;
-            if (avcodec_open2(vCodecCtx_, vCodec_, nullptr) < 0) {
+            // Thread type/count and the low-delay flags come from the shared policy
+            applyDecoderThreading(vCodecCtx_, decoderThreading_);
+            applyCodecLowLatency(vCodecCtx_);
+            // Reduced-resolution decode: the smallest power-of-two step that
+            // still covers the display size
+            lowres_ = 0;
+            if (!maxDecodeSize_.isEmpty()) {
+                while (lowres_ < vCodec_->max_lowres &&
+                       (codecParams->width >> (lowres_ + 1)) >= maxDecodeSize_.width() &&
+                       (codecParams->height >> (lowres_ + 1)) >= maxDecodeSize_.height()) {
+                    lowres_++;
+                }
+            }
+            vCodecCtx_->lowres = lowres_;
+            // libav starts its frame/slice threads inside avcodec_open2() and
+            // they inherit from this thread, so it wears the decode placement
+            // (and name) for the call
+            const ThreadPlacement demuxPlacement = currentThreadPlacement();
+            placeThread(THREAD_ROLE_VIDEO_DECODE);
+            int opened = avcodec_open2(vCodecCtx_, vCodec_, nullptr);
+            // Back to exactly what this thread had, whatever the decode role changed
+            placeThread(THREAD_ROLE_DEMUX, demuxPlacement);
+            if (opened < 0) {
                 // Failed to open video codec
                 avcodec_free_context(&vCodecCtx_);
                 videoStreamIndex_ = -1;
+            } else {
+                decoderThreadingInfo_ = QString("%1, %2").arg(vCodec_->name)
+                                            .arg(QString::fromStdString(describeDecoderThreading(vCodecCtx_)));
+                decoderLatencyFrames_ = decoderThreadingLatencyFrames(vCodecCtx_);
+                AVRational rate = formatCtx_->streams[videoStreamIndex_]->avg_frame_rate;
+                streamFps_ = (rate.num > 0 && rate.den > 0) ? av_q2d(rate) : 0.0;
+                videoTimeBase_ = formatCtx_->streams[videoStreamIndex_]->time_base;
+                qDebug() << "Video decoder threading:" << decoderThreadingInfo_;
+                if (lowres_ > 0) {
+                    qDebug() << "Decoding at 1 /" << (1 << lowres_) << "resolution (lowres" << lowres_ << ")";
+                }
+
+                videoParams_ = avcodec_parameters_alloc();
+                avcodec_parameters_copy(videoParams_, codecParams);
             }
         } else {
             videoStreamIndex_ = -1;
         }
     }
 
-    // Find Audio Stream
-    audioStreamIndex_ = -1;
-    for (unsigned int i = 0; i < formatCtx_->nb_streams; i++) {
-        if (formatCtx_->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO) {
-            audioStreamIndex_ = i;
-            break;
-        }
-    }
-
     if (audioStreamIndex_ != -1) {
         AVCodecParameters* codecParams = formatCtx_->streams[audioStreamIndex_]->codecpar;
         aCodec_ = avcodec_find_decoder(codecParams->codec_id);
         if (aCodec_) {
             aCodecCtx_ = avcodec_alloc_context3(aCodec_);
             avcodec_parameters_to_context(aCodecCtx_, codecParams);
+            audioTimeBase_ = formatCtx_->streams[audioStreamIndex_]->time_base;
             if (avcodec_open2(aCodecCtx_, aCodec_, nullptr) < 0) {
                  avcodec_free_context(&aCodecCtx_);
                  audioStreamIndex_ = -1;
@@ -119,94 +414,672 @@ void VideoThread::run()
                                               aCodecCtx_->channel_layout, aCodecCtx_->sample_fmt, aCodecCtx_->sample_rate,
                                               0, nullptr);
                  swr_init(swrCtx_);
+
+                 audioParams_ = avcodec_parameters_alloc();
+                 avcodec_parameters_copy(audioParams_, codecParams);
             }
         } else {
             audioStreamIndex_ = -1;
         }
     }
 
-    if (videoStreamIndex_ == -1 && audioStreamIndex_ == -1) {
-        emit errorOccurred("No usable video or audio stream found");
-        return;
+    return videoStreamIndex_ != -1 || audioStreamIndex_ != -1;
+}
+
+void VideoThread::closeDecoders()
+{
+    if (swrCtx_) {
+        swr_free(&swrCtx_);
     }
+    if (vCodecCtx_) {
+        avcodec_free_context(&vCodecCtx_);
+    }
+    if (aCodecCtx_) {
+        avcodec_free_context(&aCodecCtx_);
+    }
+    avcodec_parameters_free(&videoParams_);
+    avcodec_parameters_free(&audioParams_);
+}
 
-    AVPacket* packet = av_packet_alloc();
-    AVFrame* frame = av_frame_alloc();
-    
-    // Video Buffers
-    AVFrame* frameRGB = nullptr;
-    uint8_t* buffer = nullptr;
-    
-    if (videoStreamIndex_ != -1) {
-        frameRGB = av_frame_alloc();
-        int numBytes = av_image_get_buffer_size(AV_PIX_FMT_RGB24, vCodecCtx_->width, vCodecCtx_->height, 1);
-        buffer = (uint8_t*)av_malloc(numBytes * sizeof(uint8_t));
-        av_image_fill_arrays(frameRGB->data, frameRGB->linesize, buffer, AV_PIX_FMT_RGB24, vCodecCtx_->width, vCodecCtx_->height, 1);
-        swsCtx_ = sws_getContext(vCodecCtx_->width, vCodecCtx_->height, vCodecCtx_->pix_fmt,
-                                 vCodecCtx_->width, vCodecCtx_->height, AV_PIX_FMT_RGB24,
-                                 SWS_BILINEAR, nullptr, nullptr, nullptr);
+bool VideoThread::streamsUnchanged() const
+{
+    const AVCodecParameters* video = videoStreamIndex_ != -1 ? formatCtx_->streams[videoStreamIndex_]->codecpar : nullptr;
+    const AVCodecParameters* audio = audioStreamIndex_ != -1 ? formatCtx_->streams[audioStreamIndex_]->codecpar : nullptr;
+    bool videoSame = (!video && !videoParams_) || sameCodecParameters(videoParams_, video);
+    bool audioSame = (!audio && !audioParams_) || sameCodecParameters(audioParams_, audio);
+    return videoSame && audioSame;
+}
+
+AVPacket* VideoThread::allocPacket(SpscQueue<AVPacket*> &freeList)
+{
+    AVPacket* packet = nullptr;
+    if (freeList.tryPop(packet)) return packet;
+    if (pipelineWarm_) steadyPacketAllocs_++;
+    return av_packet_alloc();
+}
+
+void VideoThread::recyclePacket(AVPacket *&packet, SpscQueue<AVPacket*> &freeList)
+{
+    av_packet_unref(packet);
+    if (!freeList.tryPush(packet)) av_packet_free(&packet);
+    packet = nullptr;
+}
+
+AVFrame* VideoThread::allocFrame(SpscQueue<AVFrame*> &freeList)
+{
+    AVFrame* frame = nullptr;
+    if (freeList.tryPop(frame)) return frame;
+    if (pipelineWarm_) steadyFrameAllocs_++;
+    return av_frame_alloc();
+}
+
+void VideoThread::recycleFrame(AVFrame *&frame, SpscQueue<AVFrame*> &freeList)
+{
+    av_frame_unref(frame);
+    if (!freeList.tryPush(frame)) av_frame_free(&frame);
+    frame = nullptr;
+}
+
+// Only once no stage runs any more
+void VideoThread::drainFreeLists()
+{
+    AVPacket* pkt = nullptr;
+    while (freeVideoPackets_.tryPop(pkt)) av_packet_free(&pkt);
+    while (freeAudioPackets_.tryPop(pkt)) av_packet_free(&pkt);
+    AVFrame* frm = nullptr;
+    while (freeVideoFrames_.tryPop(frm)) av_frame_free(&frm);
+    while (freeFilteredFrames_.tryPop(frm)) av_frame_free(&frm);
+}
+
+void VideoThread::queueDecoderFlush(SpscQueue<AVPacket*> &queue)
+{
+    AVPacket* flush = av_packet_alloc();
+    if (!queue.push(flush, stagesRunning_)) {
+        av_packet_free(&flush);
     }
+}
 
-    frameCount_ = 0;
-    int64_t startTime = QDateTime::currentMSecsSinceEpoch();
+bool VideoThread::reconnect()
+{
+    reconnector_.streamLost();
+    emit statusMessage("Stream lost, reconnecting...");
 
     while (running_) {
-        {
-            QMutexLocker locker(&mutex_);
-            if (!running_) break;
+        // Sleep in short slices so stop() is not held up by a long backoff
+        int delay = reconnector_.nextDelayMs();
+        for (int waited = 0; waited < delay && running_; waited += 10) {
+            msleep(10);
         }
+        if (!running_) break;
 
-        if (av_read_frame(formatCtx_, packet) >= 0) {
-            if (packet->stream_index == videoStreamIndex_ && videoStreamIndex_ != -1) {
-                if (avcodec_send_packet(vCodecCtx_, packet) == 0) {
-                    while (avcodec_receive_frame(vCodecCtx_, frame) == 0) {
-                        frameCount_++;
-                        sws_scale(swsCtx_, frame->data, frame->linesize, 0,
-                                  vCodecCtx_->height, frameRGB->data, frameRGB->linesize);
-
-                        QImage img(frameRGB->data[0], vCodecCtx_->width, vCodecCtx_->height, 
-                                   frameRGB->linesize[0], QImage::Format_RGB888);
-                        
-                        emit frameReady(img.copy());
-
-                        if (frameCount_ % 25 == 0) {
-                            int64_t now = QDateTime::currentMSecsSinceEpoch();
-                            double elapsed = (now - startTime) / 1000.0;
-                            if (elapsed > 0) {
-                                double fps = frameCount_ / elapsed;
-                                emit statsUpdated(frameCount_, fps);
-                            }
-                        }
-                    }
+        avformat_close_input(&formatCtx_);
+        QString error;
+        if (!openInput(error)) {
+            reconnector_.attemptFailed();
+            continue;
+        }
+
+        if (streamsUnchanged()) {
+            // Same stream: keep decoders, converter and frame pool, and only
+            // drop the references the decoders hold into the old stream.
+            // Timestamps start over, so the live edge has to be found again.
+            latency_.reset();
+            if (videoStreamIndex_ != -1) queueDecoderFlush(videoPackets_);
+            if (audioStreamIndex_ != -1) queueDecoderFlush(audioPackets_);
+        } else {
+            // New codec, resolution or stream layout: rebuild the decode side
+            stopStages();
+            latency_.reset();
+            closeDecoders();
+            if (!openDecoders()) {
+                reconnector_.attemptFailed();
+                continue;
+            }
+            startStages();
+        }
+
+        qint64 ms = reconnector_.recovered();
+        const StreamReconnector::Stats &recovery = reconnector_.stats();
+        lastRecoverMs_ = recovery.lastRecoverMs;
+        maxRecoverMs_ = recovery.maxRecoverMs;
+        reconnects_ = recovery.recoveries;
+        emit statusMessage(QString("Stream recovered after %1 ms (%2 attempts)")
+                               .arg(ms).arg(reconnector_.stats().attempts));
+        return true;
+    }
+    return false;
+}
+
+void VideoThread::startStages()
+{
+    frameCount_ = 0;
+    startTime_ = QDateTime::currentMSecsSinceEpoch();
+    stagesRunning_ = true;
+
+    convertInput_ = filter_ ? &filteredFrames_ : &videoFrames_;
+    convertFreeList_ = filter_ ? &freeFilteredFrames_ : &freeVideoFrames_;
+    if (videoStreamIndex_ != -1) {
+        videoDecodeThread_ = std::thread(&VideoThread::videoDecodeLoop, this);
+        if (filter_) filterThread_ = std::thread(&VideoThread::filterLoop, this);
+        convertThread_ = std::thread(&VideoThread::convertLoop, this);
+    }
+    if (audioStreamIndex_ != -1) {
+        audioDecodeThread_ = std::thread(&VideoThread::audioDecodeLoop, this);
+    }
+}
+
+void VideoThread::stopStages()
+{
+    stagesRunning_ = false;
+    videoPackets_.wakeAll();
+    audioPackets_.wakeAll();
+    videoFrames_.wakeAll();
+    filteredFrames_.wakeAll();
+
+    if (videoDecodeThread_.joinable()) videoDecodeThread_.join();
+    if (filterThread_.joinable()) filterThread_.join();
+    if (convertThread_.joinable()) convertThread_.join();
+    if (audioDecodeThread_.joinable()) audioDecodeThread_.join();
+
+    // Release whatever was still in flight between stages
+    AVPacket* pkt = nullptr;
+    while (videoPackets_.tryPop(pkt)) av_packet_free(&pkt);
+    while (audioPackets_.tryPop(pkt)) av_packet_free(&pkt);
+    AVFrame* frm = nullptr;
+    while (videoFrames_.tryPop(frm)) av_frame_free(&frm);
+    while (filteredFrames_.tryPop(frm)) av_frame_free(&frm);
+}
+
+void VideoThread::videoDecodeLoop()
+{
+    AVPacket* packet = nullptr;
+    placeThread(THREAD_ROLE_VIDEO_DECODE);
+    ThreadCpuGroup::Scope cpuScope(cpu_);
+    AVFrame* frame = allocFrame(freeVideoFrames_);
+    SteadyStateAllocCheck allocCheck("video decode", kAllocCheckWarmup);
+
+    // Fresh decoder state per stage run; a reconnect may bring a new codec context
+    degrader_.reset();
+    degradeLevel_ = DEGRADE_NONE;
+    latencyControl_.reset();
+    catchUpMode_ = CATCHUP_NONE;
+    const double frameIntervalMs = streamFps_ > 0 ? 1000.0 / streamFps_ : 40.0;
+    bool catchingUp = false;
+    bool skipToKeyframe = false;
+    bool hidden = false;
+
+    while (videoPackets_.pop(packet, stagesRunning_)) {
+        if (isFlushPacket(packet)) {
+            // Reconnected: the new stream starts over at a keyframe
+            avcodec_flush_buffers(vCodecCtx_);
+            recyclePacket(packet, freeVideoPackets_);
+            skipToKeyframe = false;
+            continue;
+        }
+
+        // Live latency is judged as packets leave the backlog: anything older
+        // than the target is not worth decoding in full
+        const int64_t ptsUs = packetTimeUs(packet, videoTimeBase_);
+        if (ptsUs != AV_NOPTS_VALUE) {
+            int64_t latencyUs = latency_.latencyUs(ptsUs, av_gettime_relative());
+            latencyMs_ = latencyUs < 0 ? -1 : latencyUs / 1000;
+            CatchUpMode mode = latencyControl_.update(latencyMs_);
+            if (mode != catchUpMode_) {
+                // Status messages are reporting, not the data path
+                UncountedAllocScope reporting;
+                catchUpMode_ = mode;
+                emit statusMessage(QString("Live latency %1 ms (target %2 ms): %3")
+                                       .arg(latencyMs_.load()).arg(latencyControl_.targetMs())
+                                       .arg(catchUpModeName(mode)));
+            }
+            if (mode == CATCHUP_SKIP_TO_KEYFRAME && !skipToKeyframe) {
+                skipToKeyframe = true;
+                keyframeSkips_++;
+            }
+            if ((mode != CATCHUP_NONE) != catchingUp) {
+                catchingUp = mode != CATCHUP_NONE;
+                applyVideoSkip(catchingUp);
+            }
+        }
+        // Nobody is looking: keep the session and the decoder alive on
+        // keyframes alone. The decoder has missed references by the time the
+        // view comes back, so full decode restarts at the next keyframe.
+        if (!viewVisible_ && !frameExport_) {
+            if (!hidden) {
+                UncountedAllocScope reporting;
+                hidden = true;
+                emit statusMessage("Video hidden: decoding keyframes only");
+            }
+            if (!(packet->flags & AV_PKT_FLAG_KEY)) {
+                hiddenSkippedPackets_++;
+                recyclePacket(packet, freeVideoPackets_);
+                continue;
+            }
+        } else if (hidden) {
+            UncountedAllocScope reporting;
+            hidden = false;
+            skipToKeyframe = true;
+            emit statusMessage("Video visible: full decode from the next keyframe");
+        }
+
+        if (skipToKeyframe) {
+            if (!(packet->flags & AV_PKT_FLAG_KEY)) {
+                skippedPackets_++;
+                recyclePacket(packet, freeVideoPackets_);
+                continue;
+            }
+            // Whatever the decoder still holds is older than this keyframe
+            avcodec_flush_buffers(vCodecCtx_);
+            skipToKeyframe = false;
+        }
+
+        // Only time spent inside the codec counts; waiting on a full frame
+        // queue would otherwise hide the gain from threading
+        qint64 decodeStart = av_gettime_relative();
+        if (sendPacket(vCodecCtx_, packet) == 0) {
+            while (receiveFrame(vCodecCtx_, frame) == 0) {
+                if (hidden) {
+                    av_frame_unref(frame);
+                    continue;
+                }
+                const qint64 decodedAtUs = av_gettime_relative();
+                const qint64 decodeUs = decodedAtUs - decodeStart;
+                decodeRate_.add(decodeUs, 1);
+                // A backlog being drained on purpose says nothing about decode
+                // capacity; only the cost per frame counts meanwhile
+                const int backlog = catchingUp ? 0 : static_cast<int>(videoPackets_.depth());
+                if (degrader_.update(backlog, static_cast<int>(videoPackets_.capacity()),
+                                     decodeUs / 1000.0, frameIntervalMs, decodedAtUs)) {
+                    UncountedAllocScope reporting;
+                    applyVideoSkip(catchingUp);
+                    degradeLevel_ = degrader_.level();
+                    degradeChanges_++;
+                    emit statusMessage(QString("Decode quality: %1 (backlog %2 packets)")
+                                           .arg(degradeLevelName(degrader_.level()))
+                                           .arg(static_cast<int>(videoPackets_.depth())));
+                }
+                if (decodedFrames_++ == 0 && streamCacheHit_) {
+                    checkCachedParams(frame);
                 }
-            } 
-            else if (packet->stream_index == audioStreamIndex_ && audioStreamIndex_ != -1) {
-                if (avcodec_send_packet(aCodecCtx_, packet) == 0) {
-                    while (avcodec_receive_frame(aCodecCtx_, frame) == 0) {
-                         // Resample
-                         int dst_nb_samples = av_rescale_rnd(swr_get_delay(swrCtx_, aCodecCtx_->sample_rate) +
-                                                            frame->nb_samples, aCodecCtx_->sample_rate, aCodecCtx_->sample_rate, AV_ROUND_UP);
-                         
-                         QByteArray outputBytes;
-                         outputBytes.resize(dst_nb_samples * 2); // 2 bytes per sample (S16)
-                         uint8_t* outData[1] = { (uint8_t*)outputBytes.data() };
-                         
-                         int ret = swr_convert(swrCtx_, outData, dst_nb_samples, (const uint8_t**)frame->data, frame->nb_samples);
-                         if (ret > 0) {
-                             outputBytes.resize(ret * 2); // Adjust size to actual converted samples
-                             emit audioDataReady(outputBytes);
-                         }
-                    }
+                // Before the convert stage gets to drop it: analytics want every frame
+                if (frameExport_ && !frameExport_->publish(frame, frameTimeUs(frame, videoTimeBase_)) &&
+                    frameExport_->failed() == 1) {
+                    UncountedAllocScope reporting;
+                    emit statusMessage(QString("Frame export to %1 failed: %2")
+                                           .arg(QString::fromStdString(frameExport_->config().name))
+                                           .arg(QString::fromStdString(frameExport_->lastError())));
                 }
+                if (!videoFrames_.push(frame, stagesRunning_)) break;
+                // Ownership moved to the next stage
+                frame = allocFrame(freeVideoFrames_);
+                decodeStart = av_gettime_relative();
             }
-            av_packet_unref(packet);
-        } else {
-             // Loop or error
         }
+        recyclePacket(packet, freeVideoPackets_);
+        allocCheck.unitDone();
     }
 
-    if (buffer) av_free(buffer);
-    if (frameRGB) av_frame_free(&frameRGB);
     av_frame_free(&frame);
-    av_packet_free(&packet);
+}
+
+// The load degrader and the latency controller share skip_frame; the
+// stronger of the two wins
+void VideoThread::applyVideoSkip(bool catchingUp)
+{
+    applyDegradeLevel(vCodecCtx_, degrader_.level());
+    if (catchingUp && vCodecCtx_->skip_frame < AVDISCARD_NONREF) {
+        vCodecCtx_->skip_frame = AVDISCARD_NONREF;
+    }
+}
+
+void VideoThread::checkCachedParams(const AVFrame *frame)
+{
+    // The decoder copes with a changed stream by itself; only the next
+    // connect needs to probe properly again
+    // Our own copy: formatCtx_ belongs to the demux stage and is replaced on reconnect
+    // lowres frames come out smaller than the stream by design
+    const AVCodecParameters* par = videoParams_;
+    if (par && (frame->width != AV_CEIL_RSHIFT(par->width, lowres_) ||
+                frame->height != AV_CEIL_RSHIFT(par->height, lowres_) || frame->format != par->format)) {
+        qDebug() << "Stream no longer matches its cached parameters, dropping the cache entry";
+        streamCache_.remove(url_.toStdString());
+    }
+}
+
+void VideoThread::filterLoop()
+{
+    placeThread(THREAD_ROLE_FILTER);
+    ThreadCpuGroup::Scope cpuScope(cpu_);
+    // A rebuilt pipeline may bring another stream; the graph follows the first frame
+    filter_->reset();
+    AVFrame* frame = nullptr;
+    AVFrame* out = allocFrame(freeFilteredFrames_);
+    SteadyStateAllocCheck allocCheck("filter", kAllocCheckWarmup);
+    qint64 errors = 0;
+
+    while (videoFrames_.pop(frame, stagesRunning_)) {
+        int ret;
+        {
+            // libavfilter refs its own pooled buffers per frame
+            UncountedAllocScope libav;
+            ret = filter_->push(frame, videoTimeBase_);
+        }
+        // A graph that cannot be built for this input: better unfiltered than black
+        const bool passThrough = ret < 0 && filter_->buildFailed();
+        if (passThrough) av_frame_move_ref(out, frame);
+        // The graph holds the reference now; only the shell goes back
+        recycleFrame(frame, freeVideoFrames_);
+        if (ret < 0) {
+            if (errors++ == 0) {
+                UncountedAllocScope reporting;
+                emit statusMessage(QString(passThrough ? "Video filter unusable, frames are shown unfiltered: %1"
+                                                       : "Video filter failed, frames are dropped: %1")
+                                       .arg(QString::fromStdString(filter_->lastError())));
+            }
+            if (!passThrough) continue;
+            if (!filteredFrames_.push(out, stagesRunning_)) {
+                av_frame_unref(out);
+                continue;
+            }
+            out = allocFrame(freeFilteredFrames_);
+            allocCheck.unitDone();
+            continue;
+        }
+
+        for (;;) {
+            bool got;
+            {
+                UncountedAllocScope libav;
+                got = filter_->pull(out);
+            }
+            if (!got) break;
+            if (!filteredFrames_.push(out, stagesRunning_)) {
+                av_frame_unref(out);
+                break;
+            }
+            out = allocFrame(freeFilteredFrames_);
+        }
+        allocCheck.unitDone();
+    }
+
+    av_frame_free(&out);
+}
+
+void VideoThread::convertLoop()
+{
+    placeThread(THREAD_ROLE_CONVERT);
+    ThreadCpuGroup::Scope cpuScope(cpu_);
+    AVFrame* frame = nullptr;
+    scheduler_.reset(streamFps_ > 0 ? static_cast<qint64>(1000000 / streamFps_) : 0);
+    sceneDetector_.invalidate();
+    quint64 lastZoom = 0;
+    QSize lastOutput;
+    qint64 handledFrames = 0;
+    SteadyStateAllocCheck allocCheck("convert", kAllocCheckWarmup);
+
+    while (convertInput_->pop(frame, stagesRunning_)) {
+        // Counted on every frame, so stats keep flowing when most are skipped
+        if (++handledFrames % 25 == 0) {
+            publishStats();
+        }
+        allocCheck.unitDone();
+
+        // Frames queued before the view was hidden are not worth converting
+        if (!viewVisible_) {
+            recycleFrame(frame, *convertFreeList_);
+            continue;
+        }
+
+        // Pace by PTS. A frame that would be shown late anyway is not worth
+        // converting while a newer one is already waiting.
+        const int64_t ptsUs = frameTimeUs(frame, videoTimeBase_);
+        qint64 presentAtUs = 0;
+        if (ptsUs != AV_NOPTS_VALUE) {
+            qint64 waitUs = 0;
+            qint64 nowUs = av_gettime_relative();
+            if (scheduler_.schedule(ptsUs, nowUs, convertInput_->depth() > 0, waitUs) == PresentScheduler::DROP_LATE) {
+                recycleFrame(frame, *convertFreeList_);
+                continue;
+            }
+            presentAtUs = nowUs + waitUs;
+        }
+
+        // Zoomed in: only the visible part of the planes gets converted
+        const QRectF zoom = unpackZoomRegion(zoomRegion_);
+        CropRect crop = { static_cast<int>(zoom.x() * frame->width), static_cast<int>(zoom.y() * frame->height),
+                          qMax(1, static_cast<int>(zoom.width() * frame->width)),
+                          qMax(1, static_cast<int>(zoom.height() * frame->height)) };
+        const int srcWidth = qMin(crop.width, frame->width);
+        const int srcHeight = qMin(crop.height, frame->height);
+
+        // Aspect-fit the source into the display area, so the GUI can draw 1:1.
+        // For GPU colour conversion the planes keep the source resolution
+        // (even, for 4:2:0) and the GPU scales them.
+        int width = srcWidth;
+        int height = srcHeight;
+        const int boxWidth = targetWidth_.load();
+        const int boxHeight = targetHeight_.load();
+        if (outputYuv_) {
+            width = qMax(srcWidth & ~1, 2);
+            height = qMax(srcHeight & ~1, 2);
+        } else if (boxWidth > 0 && boxHeight > 0 && srcWidth > 0 && srcHeight > 0) {
+            QSize fitted = QSize(srcWidth, srcHeight).scaled(boxWidth, boxHeight, Qt::KeepAspectRatio);
+            width = qMax(fitted.width(), 1);
+            height = qMax(fitted.height(), 1);
+        }
+
+        // Static scene: what is on screen is still right, so neither convert
+        // nor repaint. A new zoom or output size always needs a fresh frame.
+        const quint64 zoomPacked = zoomRegion_;
+        if (zoomPacked != lastZoom || QSize(width, height) != lastOutput) {
+            sceneDetector_.invalidate();
+            lastZoom = zoomPacked;
+            lastOutput = QSize(width, height);
+        }
+        if (sceneDetector_.unchanged(frame)) {
+            staticSkips_++;
+            recycleFrame(frame, *convertFreeList_);
+            continue;
+        }
+
+        // Render straight into a pooled image that comes back once the GUI drops it
+        QImage img;
+        uchar* bits = nullptr;
+        if (frame->width > 0 && frame->height > 0) {
+            img = outputYuv_ ? framePool_->acquire(width, height * 3 / 2, QImage::Format_Grayscale8, &bits)
+                             : framePool_->acquire(width, height, QImage::Format_RGB32, &bits);
+        }
+        if (img.isNull()) {
+            // Every buffer is still held by the GUI: drop rather than allocate
+            recycleFrame(frame, *convertFreeList_);
+            continue;
+        }
+
+        // Follow the decoded frame rather than the codec context, which belongs
+        // to the decode stage and may change under us. Same-size yuv420p/nv12
+        // frames take the SIMD kernels; anything else goes through a cached
+        // swscale context that is only rebuilt when the format or size changes.
+        // AV_PIX_FMT_RGB32 has the same in-memory layout as QImage::Format_RGB32.
+        frameCount_++;
+        if (timeToFirstFrameMs_ < 0) {
+            timeToFirstFrameMs_ = QDateTime::currentMSecsSinceEpoch() - openStartMs_;
+            qDebug() << "Time to first frame:" << timeToFirstFrameMs_ << "ms"
+                     << (streamCacheHit_ ? "(cached stream parameters)" : "(full probe)");
+        }
+        converter_.convert(frame, crop, bits, img.bytesPerLine(), width, height,
+                           outputYuv_ ? AV_PIX_FMT_YUV420P : AV_PIX_FMT_RGB32);
+        if (converter_.lastUsedSimd()) simdFrames_++;
+        recycleFrame(frame, *convertFreeList_);
+
+        // Convert first and wait afterwards, so conversion time does not
+        // shift the presentation
+        if (!waitUntil(presentAtUs)) break;
+        if (ptsUs != AV_NOPTS_VALUE) {
+            scheduler_.presented(ptsUs, av_gettime_relative());
+        }
+
+        // Overwrites any frame the GUI has not painted yet
+        if (mailbox_.post(img)) {
+            UncountedAllocScope event;
+            emit frameReady();
+        }
+
+        if (frameCount_ == kPoolWarmupFrames) {
+            framePool_->markWarm();
+            pipelineWarm_ = true;
+        }
+    }
+}
+
+// Sleeps in short slices so stopping the stages is not held up; false when stopped
+bool VideoThread::waitUntil(qint64 deadlineUs)
+{
+    while (stagesRunning_) {
+        qint64 remainingUs = deadlineUs - av_gettime_relative();
+        if (remainingUs <= 0) return true;
+        std::this_thread::sleep_for(std::chrono::microseconds(qMin<qint64>(remainingUs, 10000)));
+    }
+    return false;
+}
+
+void VideoThread::audioDecodeLoop()
+{
+    AVPacket* packet = nullptr;
+    placeThread(THREAD_ROLE_AUDIO_DECODE);
+    ThreadCpuGroup::Scope cpuScope(cpu_);
+    AVFrame* frame = av_frame_alloc();
+    SteadyStateAllocCheck allocCheck("audio decode", kAllocCheckWarmup);
+    qint64 chunks = 0;
+
+    while (audioPackets_.pop(packet, stagesRunning_)) {
+        if (isFlushPacket(packet)) {
+            avcodec_flush_buffers(aCodecCtx_);
+            audioClock_.reset();
+            recyclePacket(packet, freeAudioPackets_);
+            continue;
+        }
+
+        if (sendPacket(aCodecCtx_, packet) == 0) {
+            while (receiveFrame(aCodecCtx_, frame) == 0) {
+                 // Resample
+                 int dst_nb_samples = av_rescale_rnd(swr_get_delay(swrCtx_, aCodecCtx_->sample_rate) +
+                                                    frame->nb_samples, aCodecCtx_->sample_rate, aCodecCtx_->sample_rate, AV_ROUND_UP);
+
+                 // Pooled chunk: reused once the visualizer and ASR are done with it
+                 uint8_t* outData[1] = { (uint8_t*)audioChunks_.begin(dst_nb_samples * 2) }; // 2 bytes per sample (S16)
+
+                 int ret;
+                 {
+                     UncountedAllocScope libav;
+                     ret = swr_convert(swrCtx_, outData, dst_nb_samples, (const uint8_t**)frame->data, frame->nb_samples);
+                 }
+                 QByteArray outputBytes = audioChunks_.commit(ret > 0 ? ret * 2 : 0); // actual converted samples
+                 if (ret > 0) {
+                     {
+                         UncountedAllocScope event;
+                         emit audioDataReady(outputBytes);
+                     }
+                     if (++chunks == kAllocCheckWarmup) audioChunks_.markWarm();
+
+                     // Audio is consumed as it is emitted, so the end of this
+                     // frame is "now" on the audio clock
+                     int64_t ptsUs = frameTimeUs(frame, audioTimeBase_);
+                     if (ptsUs != AV_NOPTS_VALUE && frame->sample_rate > 0) {
+                         audioClock_.set(ptsUs + av_rescale(frame->nb_samples, AV_TIME_BASE, frame->sample_rate),
+                                         av_gettime_relative());
+                     }
+                 }
+            }
+        }
+        recyclePacket(packet, freeAudioPackets_);
+        allocCheck.unitDone();
+    }
+
+    av_frame_free(&frame);
+}
+
+void VideoThread::publishStats()
+{
+    // Reporting, not the data path
+    UncountedAllocScope reporting;
+    VideoStats stats;
+    stats.frameCount = frameCount_;
+    stats.framesDecoded = decodedFrames_.load();
+    stats.framesDisplayed = mailbox_.taken();
+    stats.framesDropped = mailbox_.dropped();
+
+    int64_t now = QDateTime::currentMSecsSinceEpoch();
+    double elapsed = (now - startTime_) / 1000.0;
+    if (elapsed > 0) {
+        stats.fps = frameCount_ / elapsed;
+    }
+
+    fillQueueStats(stats.videoPackets, videoPackets_.depth(), videoPackets_.highWater(), videoPackets_.capacity());
+    fillQueueStats(stats.audioPackets, audioPackets_.depth(), audioPackets_.highWater(), audioPackets_.capacity());
+    fillQueueStats(stats.videoFrames, videoFrames_.depth(), videoFrames_.highWater(), videoFrames_.capacity());
+    if (filter_) {
+        VideoFilterStage::Stats fs = filter_->stats();
+        fillQueueStats(stats.filteredFrames, filteredFrames_.depth(), filteredFrames_.highWater(), filteredFrames_.capacity());
+        stats.filterGraph = QString::fromStdString(fs.description);
+        stats.filterMsPerFrame = fs.msPerFrame;
+        stats.filterFramesIn = fs.framesIn;
+        stats.filterFramesOut = fs.framesOut;
+        stats.filterGraphs = fs.graphs;
+        stats.filterThreads = fs.threads;
+    }
+
+    FramePool::Stats pool = framePool_->stats();
+    stats.poolSlots = pool.slotCount;
+    stats.poolInUse = pool.inUse;
+    stats.poolExhausted = pool.exhausted;
+    stats.poolAllocations = pool.allocations;
+    stats.poolSteadyAllocations = pool.steadyAllocations;
+    stats.steadyPacketAllocations = steadyPacketAllocs_;
+    stats.steadyFrameAllocations = steadyFrameAllocs_;
+    stats.audioChunkAllocations = audioChunks_.allocations();
+    stats.audioChunkSteadyAllocations = audioChunks_.steadyAllocations();
+
+    stats.simdLevel = yuvSimdLevelName(yuvSimdLevel());
+    stats.simdFrames = simdFrames_;
+    stats.staticSkips = staticSkips_;
+
+    stats.decoderThreading = decoderThreadingInfo_;
+    stats.lowres = lowres_;
+    stats.cpuUs = cpu_.cpuUs();
+    stats.decoderLatencyFrames = decoderLatencyFrames_;
+    stats.decodeMsPerFrame = decodeRate_.msPerFrame();
+    stats.decodeCapacityFps = decodeRate_.capacityFps();
+    stats.streamFps = streamFps_;
+    stats.degradeLevel = degradeLevel_;
+    stats.degradeName = degradeLevelName(static_cast<DegradeLevel>(stats.degradeLevel));
+    stats.degradeChanges = degradeChanges_;
+
+    stats.latencyMs = latencyMs_;
+    stats.targetLatencyMs = latencyControl_.targetMs();
+    stats.catchUpMode = catchUpModeName(static_cast<CatchUpMode>(catchUpMode_.load()));
+    stats.keyframeSkips = keyframeSkips_;
+    stats.skippedPackets = skippedPackets_;
+    stats.viewVisible = viewVisible_;
+    stats.hiddenSkippedPackets = hiddenSkippedPackets_;
+    if (frameExport_) {
+        stats.exportName = QString::fromStdString(frameExport_->config().name);
+        stats.exportedFrames = frameExport_->published();
+        stats.exportFailures = frameExport_->failed();
+    }
+
+    const PresentScheduler::Stats &pacing = scheduler_.stats();
+    stats.syncMaster = pacing.audioMaster ? "audio" : "wall";
+    stats.avDriftMs = pacing.avDriftUs / 1000.0;
+    stats.pacingJitterMs = pacing.jitterUs / 1000.0;
+    stats.lateDrops = pacing.lateDrops;
+    stats.clockResyncs = pacing.resyncs;
+
+    stats.streamCacheHit = streamCacheHit_;
+    stats.timeToFirstFrameMs = timeToFirstFrameMs_;
+
+    stats.reconnects = reconnects_;
+    stats.lastRecoverMs = lastRecoverMs_;
+    stats.maxRecoverMs = maxRecoverMs_;
+
+    emit statsUpdated(stats);
 }
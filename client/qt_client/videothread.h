@@ -3,9 +3,32 @@
 
 #include <QThread>
 #include <QImage>
-#include <QMutex>
 #include <string>
 #include <QByteArray>
+#include <QSize>
+#include <QRectF>
+#include <atomic>
+#include <thread>
+
+#include "spscqueue.h"
+#include "videostats.h"
+#include "framepool.h"
+#include "framemailbox.h"
+#include "audiochunkpool.h"
+#include "presentscheduler.h"
+#include "yuvconvert.h"
+#include "staticscene.h"
+#include "decoderthreading.h"
+#include "decoderselect.h"
+#include "decodedegrade.h"
+#include "livelatency.h"
+#include "streamcache.h"
+#include "reconnect.h"
+#include "iointerrupt.h"
+#include "alloccount.h"
+#include "threadplacement.h"
+#include "frameexport.h"
+#include "videofilter.h"
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -15,6 +38,18 @@ extern "C" {
 #include <libswresample/swresample.h>
 }
 
+// Receives an RTSP stream as a small staged pipeline:
+//
+//   run() [demux] --videoPackets_--> videoDecodeLoop() --videoFrames_--> convertLoop() --> mailbox_
+//                 --audioPackets_--> audioDecodeLoop() --> audioDataReady
+//
+// With a filter graph configured, filterLoop() sits between decode and convert:
+//
+//   videoDecodeLoop() --videoFrames_--> filterLoop() --filteredFrames_--> convertLoop()
+//
+// Every arrow is a bounded SPSC queue, so a slow colour conversion only backs up
+// the video branch and never delays audio decode. The convert stage releases
+// frames at their PTS, against the audio clock when there is audio.
 class VideoThread : public QThread
 {
     Q_OBJECT
@@ -22,36 +57,199 @@ public:
     explicit VideoThread(const QString &url, QObject *parent = nullptr);
     ~VideoThread();
 
+    // Safe from any thread; aborts a blocking open/read and returns promptly
     void stop();
 
+    // Takes the newest converted frame; call from the GUI after frameReady
+    bool takeFrame(QImage &image);
+
+    // Size of the widget the frames are shown in. The convert stage scales
+    // straight to an aspect-fit frame of this size; empty means source size.
+    void setTargetSize(const QSize &size);
+
+    // Hand out I420 frames for GPU colour conversion instead of RGB32: a
+    // Format_Grayscale8 image 3/2 the frame height holding the Y plane, then
+    // U and V at half the stride (see FrameConverter). Such frames keep the
+    // source resolution. Call before start().
+    void setOutputYuv(bool yuv);
+
+    // Digital zoom/pan: the part of the source to show, normalized to 0..1
+    // (QRectF(0, 0, 1, 1) is the whole frame). Only that region of the YUV
+    // planes is converted and scaled. Safe from any thread.
+    void setZoomRegion(const QRectF &region);
+    QRectF zoomRegion() const;
+
+    // Decoder threading for the video stream; call before start()
+    void setDecoderThreading(const DecoderThreadingPolicy &policy);
+    // Which software decoder each codec prefers; call before start()
+    void setDecoderSelection(const DecoderSelection &selection);
+
+    // Open/read deadlines for the network; call before start()
+    void setIoTimeouts(const IoTimeouts &timeouts);
+
+    // Whether anyone can see the video. While hidden (window minimized or
+    // another page shown) only keyframes are decoded and nothing is converted;
+    // full decode resumes at the next keyframe. Safe from any thread.
+    void setViewVisible(bool visible);
+
+    // How far behind live the picture may fall before the decode stage
+    // drops frames to catch up; 0 disables. Call before start().
+    void setTargetLatency(int ms);
+
+    // CPU sets and scheduling class per pipeline thread; call before start()
+    void setThreadPlacement(const ThreadPlacementConfig &config);
+
+    // Also publish every decoded frame into a shared-memory ring for other
+    // processes (see frameshm.h). While exporting, decoding no longer drops
+    // to keyframes when the view is hidden. Call before start().
+    void setFrameExport(const FrameExportConfig &config);
+
+    // libavfilter graph (deinterlace, crop, denoise, scale...) applied to
+    // decoded frames in a stage of its own; empty graph = none. Call before start().
+    void setVideoFilter(const VideoFilterConfig &config);
+
+    // Decode no larger than needed to fill this size: codecs that can
+    // decode at reduced resolution (lowres: MPEG-1/2/4, MJPEG...) drop to
+    // the smallest 1/2, 1/4 or 1/8 that still covers it; for the rest the
+    // convert stage scales down as usual. Empty = full resolution. Call before start().
+    void setMaxDecodeSize(const QSize &size);
+
+    // Ignore the audio stream (mosaic tiles). Call before start().
+    void setVideoOnly(bool videoOnly);
+
 signals:
-    void frameReady(const QImage &image);
+    // A frame is waiting in the mailbox (only sent when it was empty)
+    void frameReady();
     void audioDataReady(const QByteArray &data);
     void errorOccurred(const QString &msg);
-    void statsUpdated(int frameCount, double fps);
+    // Informational, e.g. stream lost / recovered
+    void statusMessage(const QString &msg);
+    void statsUpdated(const VideoStats &stats);
 
 protected:
     void run() override;
 
 private:
     QString url_;
-    bool running_;
-    QMutex mutex_;
+    std::atomic<bool> running_;
+    IoInterrupter interrupter_;   // aborts libavformat calls once running_ drops
 
     AVFormatContext* formatCtx_;
-    
+    // Parameters the open decoders were set up from, to tell on reconnect
+    // whether they can simply be flushed and reused
+    AVCodecParameters* videoParams_;
+    AVCodecParameters* audioParams_;
+    StreamReconnector reconnector_;   // demux stage only
+    // Copies of the reconnector's counters for publishStats() on the convert stage
+    std::atomic<int> reconnects_;
+    std::atomic<qint64> lastRecoverMs_;
+    std::atomic<qint64> maxRecoverMs_;
+    StreamParamCache streamCache_;
+    ThreadPlacementConfig placement_;
+    ThreadCpuGroup cpu_;              // every stage thread of this pipeline
+    QSize maxDecodeSize_;             // set before start()
+    bool videoOnly_;                  // set before start()
+    std::atomic<bool> streamCacheHit_;   // set by the demux stage on every (re)open
+    qint64 openStartMs_;
+    qint64 timeToFirstFrameMs_;   // -1 until the first frame is converted
+
     // Video
     AVCodecContext* vCodecCtx_;
     const AVCodec* vCodec_;
-    SwsContext* swsCtx_;
+    FrameConverter converter_;   // owned by the convert stage
     int videoStreamIndex_;
+    DecoderThreadingPolicy decoderThreading_;
+    DecoderSelection decoderSelection_;
+    QString decoderThreadingInfo_;   // set once the decoder is open
+    int lowres_;                     // set once the decoder is open
+    int decoderLatencyFrames_;
+    double streamFps_;
+    AVRational videoTimeBase_;
+    PresentScheduler scheduler_;   // convert stage only
     int frameCount_;
+    int64_t startTime_;
 
     // Audio
     AVCodecContext* aCodecCtx_;
     const AVCodec* aCodec_;
     SwrContext* swrCtx_;
     int audioStreamIndex_;
+    AVRational audioTimeBase_;
+    MediaClock audioClock_;   // set by the audio stage, master for video pacing
+
+    // Pipeline stages (owned by run())
+    std::atomic<bool> stagesRunning_;
+    SpscQueue<AVPacket*> videoPackets_;
+    SpscQueue<AVPacket*> audioPackets_;
+    SpscQueue<AVFrame*> videoFrames_;
+    SpscQueue<AVFrame*> filteredFrames_;
+    // Packet and frame shells handed back by the consuming stage for reuse,
+    // so the steady state needs no av_packet_alloc()/av_frame_alloc()
+    SpscQueue<AVPacket*> freeVideoPackets_;
+    SpscQueue<AVPacket*> freeAudioPackets_;
+    SpscQueue<AVFrame*> freeVideoFrames_;     // back to the decode stage
+    SpscQueue<AVFrame*> freeFilteredFrames_;  // back to the filter stage
+    // What the convert stage reads and returns frames to: the filter stage's
+    // queues when there is a filter, the decode stage's otherwise
+    SpscQueue<AVFrame*>* convertInput_;
+    SpscQueue<AVFrame*>* convertFreeList_;
+    std::atomic<bool> pipelineWarm_;
+    std::atomic<qint64> steadyPacketAllocs_;
+    std::atomic<qint64> steadyFrameAllocs_;
+    AudioChunkPool audioChunks_;   // audio stage only
+    std::thread videoDecodeThread_;
+    std::thread audioDecodeThread_;
+    std::thread filterThread_;
+    std::thread convertThread_;
+    FramePool* framePool_;
+    std::atomic<int> targetWidth_;
+    std::atomic<int> targetHeight_;
+    std::atomic<quint64> zoomRegion_;   // x, y, w, h as 16-bit fractions of the frame
+    FrameMailbox mailbox_;
+    std::atomic<qint64> decodedFrames_;
+    StaticSceneDetector sceneDetector_;   // convert stage only
+    qint64 staticSkips_;
+    DecodeRateMeter decodeRate_;
+    DecodeDegrader degrader_;        // decode stage only
+    std::atomic<int> degradeLevel_;
+    std::atomic<int> degradeChanges_;
+    LiveLatencyTracker latency_;            // arrivals fed by the demux stage
+    LiveLatencyController latencyControl_;  // decode stage only
+    std::atomic<qint64> latencyMs_;
+    std::atomic<int> catchUpMode_;
+    std::atomic<int> keyframeSkips_;
+    std::atomic<qint64> skippedPackets_;
+    std::atomic<bool> viewVisible_;
+    std::atomic<qint64> hiddenSkippedPackets_;
+    FrameShmExporter* frameExport_;   // null unless exporting; published from the video decode stage
+    VideoFilterStage* filter_;        // null without a filter graph; filter stage only
+    bool outputYuv_;                  // set before start()
+    qint64 simdFrames_;
+
+    bool openInput(QString &error);
+    bool openDecoders();
+    void closeDecoders();
+    bool streamsUnchanged() const;
+    bool reconnect();
+    void placeThread(ThreadRole role);
+    void placeThread(ThreadRole role, const ThreadPlacement &placement);
+    void queueDecoderFlush(SpscQueue<AVPacket*> &queue);
+    AVPacket* allocPacket(SpscQueue<AVPacket*> &freeList);
+    void recyclePacket(AVPacket *&packet, SpscQueue<AVPacket*> &freeList);
+    AVFrame* allocFrame(SpscQueue<AVFrame*> &freeList);
+    void recycleFrame(AVFrame *&frame, SpscQueue<AVFrame*> &freeList);
+    void drainFreeLists();
+    void applyVideoSkip(bool catchingUp);
+
+    void startStages();
+    void stopStages();
+    void videoDecodeLoop();
+    void filterLoop();
+    void audioDecodeLoop();
+    void convertLoop();
+    bool waitUntil(qint64 deadlineUs);
+    void checkCachedParams(const AVFrame *frame);
+    void publishStats();
 
     void cleanup();
 };
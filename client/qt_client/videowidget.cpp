@@ -0,0 +1,332 @@
+#include "videowidget.h"
+
+#include <QPainter>
+#include <QPaintEvent>
+#include <QResizeEvent>
+#include <QEvent>
+#include <QWindow>
+#include <QElapsedTimer>
+#include <QDebug>
+
+#ifndef QT_NO_OPENGL
+#include <QOpenGLWidget>
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#endif
+
+const QColor VideoWidget::kBackground(0, 0, 0);
+
+namespace {
+
+// Aspect-fit box for a picture of the given size, centred in area
+QRect fitRect(const QSize &picture, const QRect &area)
+{
+    if (picture.isEmpty() || area.isEmpty()) return QRect();
+    const QSize fitted = picture.scaled(area.size(), Qt::KeepAspectRatio);
+    return QRect(area.x() + (area.width() - fitted.width()) / 2,
+                 area.y() + (area.height() - fitted.height()) / 2,
+                 fitted.width(), fitted.height());
+}
+
+} // namespace
+
+#ifndef QT_NO_OPENGL
+
+// Three single-channel textures (Y, U, V) and a BT.601 limited-range
+// shader. GLSL 1.00 and GL_LUMINANCE keep it working on GLES 2, desktop
+// compatibility profiles and llvmpipe alike. The textures are as wide as
+// the image stride, so rows upload without GL_UNPACK_ROW_LENGTH; texture
+// coordinates cut the padding off.
+class YuvGlWidget : public QOpenGLWidget, protected QOpenGLFunctions
+{
+public:
+    explicit YuvGlWidget(VideoWidget *owner)
+        : QOpenGLWidget(owner), owner_(owner), program_(nullptr), uploaded_(false)
+    {
+        textures_[0] = textures_[1] = textures_[2] = 0;
+        // Mouse and wheel events fall through to VideoWidget (zoom/pan)
+        setAttribute(Qt::WA_TransparentForMouseEvents);
+    }
+
+    ~YuvGlWidget()
+    {
+        makeCurrent();
+        if (textures_[0]) glDeleteTextures(3, textures_);
+        delete program_;
+        doneCurrent();
+    }
+
+    void setFrame(const QImage &image)
+    {
+        frame_ = image;
+        uploaded_ = false;
+    }
+
+protected:
+    void initializeGL() override
+    {
+        initializeOpenGLFunctions();
+
+        program_ = new QOpenGLShaderProgram();
+        program_->addShaderFromSourceCode(QOpenGLShader::Vertex,
+            "attribute vec2 position;\n"
+            "attribute vec2 texCoord;\n"
+            "varying vec2 v_texCoord;\n"
+            "void main() {\n"
+            "    gl_Position = vec4(position, 0.0, 1.0);\n"
+            "    v_texCoord = texCoord;\n"
+            "}\n");
+        program_->addShaderFromSourceCode(QOpenGLShader::Fragment,
+            "#ifdef GL_ES\n"
+            "precision mediump float;\n"
+            "#endif\n"
+            "uniform sampler2D texY;\n"
+            "uniform sampler2D texU;\n"
+            "uniform sampler2D texV;\n"
+            "varying vec2 v_texCoord;\n"
+            "void main() {\n"
+            "    float y = 1.164 * (texture2D(texY, v_texCoord).r - 0.0625);\n"
+            "    float u = texture2D(texU, v_texCoord).r - 0.5;\n"
+            "    float v = texture2D(texV, v_texCoord).r - 0.5;\n"
+            "    gl_FragColor = vec4(y + 1.596 * v, y - 0.392 * u - 0.813 * v, y + 2.017 * u, 1.0);\n"
+            "}\n");
+        program_->bindAttributeLocation("position", 0);
+        program_->bindAttributeLocation("texCoord", 1);
+        if (!program_->link()) {
+            qWarning() << "YUV shader:" << program_->log();
+        }
+        program_->bind();
+        program_->setUniformValue("texY", 0);
+        program_->setUniformValue("texU", 1);
+        program_->setUniformValue("texV", 2);
+        program_->release();
+
+        glGenTextures(3, textures_);
+        for (int i = 0; i < 3; ++i) {
+            glBindTexture(GL_TEXTURE_2D, textures_[i]);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        }
+        textureSize_ = QSize();
+        uploaded_ = false;
+    }
+
+    void paintGL() override
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        glClearColor(VideoWidget::kBackground.redF(), VideoWidget::kBackground.greenF(),
+                     VideoWidget::kBackground.blueF(), 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        const QSize picture = VideoWidget::pictureSize(frame_);
+        const QRect target = fitRect(picture, rect());
+        if (target.isEmpty() || !program_->isLinked()) return;
+
+        const bool newFrame = !uploaded_;
+        if (newFrame) upload(picture);
+
+        // The viewport does the aspect fit; GL counts rows from the bottom
+        const qreal ratio = devicePixelRatioF();
+        glViewport(qRound(target.x() * ratio), qRound((height() - target.bottom() - 1) * ratio),
+                   qRound(target.width() * ratio), qRound(target.height() * ratio));
+
+        const GLfloat right = static_cast<GLfloat>(picture.width()) / frame_.bytesPerLine();
+        const GLfloat vertices[] = { -1.0f, -1.0f,  1.0f, -1.0f,  -1.0f, 1.0f,  1.0f, 1.0f };
+        const GLfloat texCoords[] = { 0.0f, 1.0f,  right, 1.0f,  0.0f, 0.0f,  right, 0.0f };
+
+        program_->bind();
+        for (int i = 0; i < 3; ++i) {
+            glActiveTexture(GL_TEXTURE0 + i);
+            glBindTexture(GL_TEXTURE_2D, textures_[i]);
+        }
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, vertices);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, texCoords);
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        glDisableVertexAttribArray(1);
+        glDisableVertexAttribArray(0);
+        program_->release();
+        glActiveTexture(GL_TEXTURE0);
+
+        if (newFrame) owner_->framePainted(timer.nsecsElapsed());
+    }
+
+private:
+    void upload(const QSize &picture)
+    {
+        const int stride = frame_.bytesPerLine();
+        const uchar *y = frame_.constBits();
+        const uchar *u = y + static_cast<size_t>(stride) * picture.height();
+        const uchar *v = u + static_cast<size_t>(stride / 2) * (picture.height() / 2);
+        const QSize size(stride, picture.height());
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        const uchar *planes[3] = { y, u, v };
+        for (int i = 0; i < 3; ++i) {
+            const int w = i == 0 ? size.width() : size.width() / 2;
+            const int h = i == 0 ? size.height() : size.height() / 2;
+            glBindTexture(GL_TEXTURE_2D, textures_[i]);
+            // Reallocate only when the frame size changes
+            if (size != textureSize_) {
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, w, h, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, planes[i]);
+            } else {
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_LUMINANCE, GL_UNSIGNED_BYTE, planes[i]);
+            }
+        }
+        textureSize_ = size;
+        uploaded_ = true;
+    }
+
+    VideoWidget *owner_;
+    QOpenGLShaderProgram *program_;
+    GLuint textures_[3];
+    QSize textureSize_;
+    QImage frame_;
+    bool uploaded_;
+};
+
+#endif // QT_NO_OPENGL
+
+VideoWidget::VideoWidget(QWidget *parent)
+    : QWidget(parent), paintPending_(false), updateRequested_(false),
+      watchedWindow_(nullptr), gl_(nullptr)
+{
+    // Every pixel is painted each time: the frame plus the bars around it
+    setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+bool VideoWidget::setUseOpenGL(bool use)
+{
+#ifndef QT_NO_OPENGL
+    if (use && !gl_) {
+        gl_ = new YuvGlWidget(this);
+        gl_->setGeometry(rect());
+        gl_->show();
+    } else if (!use && gl_) {
+        delete gl_;
+        gl_ = nullptr;
+    }
+    update();
+    return true;
+#else
+    return !use;
+#endif
+}
+
+QSize VideoWidget::pictureSize(const QImage &image)
+{
+    if (image.format() == QImage::Format_Grayscale8) {
+        return QSize(image.width(), image.height() * 2 / 3);
+    }
+    return image.size();
+}
+
+void VideoWidget::setFrame(const QImage &image)
+{
+    if (paintPending_) stats_.coalesced++;
+    frame_ = image;
+    paintPending_ = true;
+#ifndef QT_NO_OPENGL
+    if (gl_) gl_->setFrame(image);
+#endif
+    requestRepaint();
+}
+
+void VideoWidget::clearFrame()
+{
+    frame_ = QImage();
+    paintPending_ = false;
+#ifndef QT_NO_OPENGL
+    if (gl_) gl_->setFrame(QImage());
+#endif
+    requestRepaint();
+}
+
+QRect VideoWidget::frameRect() const
+{
+    return fitRect(pictureSize(frame_), rect());
+}
+
+void VideoWidget::framePainted(qint64 nsecs)
+{
+    paintPending_ = false;
+    stats_.painted++;
+    const double ms = nsecs / 1e6;
+    stats_.msPerFrame = stats_.painted == 1 ? ms : stats_.msPerFrame * 0.9 + ms * 0.1;
+}
+
+// One repaint per display refresh: further frames before it only replace frame_
+void VideoWidget::requestRepaint()
+{
+    if (updateRequested_) return;
+    QWindow *window = this->window()->windowHandle();
+    if (!window) {
+        update();
+        return;
+    }
+    if (window != watchedWindow_) {
+        if (watchedWindow_) watchedWindow_->removeEventFilter(this);
+        window->installEventFilter(this);
+        watchedWindow_ = window;
+    }
+    updateRequested_ = true;
+    window->requestUpdate();
+}
+
+bool VideoWidget::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == watchedWindow_ && event->type() == QEvent::UpdateRequest && updateRequested_) {
+        updateRequested_ = false;
+        // Marked dirty in step with the platform's frame timing; every view
+        // of the window marked at this tick is painted in one backing-store pass
+#ifndef QT_NO_OPENGL
+        if (gl_) {
+            gl_->update();
+            return false;
+        }
+#endif
+        update();
+    }
+    return false;
+}
+
+void VideoWidget::resizeEvent(QResizeEvent *event)
+{
+#ifndef QT_NO_OPENGL
+    if (gl_) gl_->setGeometry(rect());
+#endif
+    QWidget::resizeEvent(event);
+}
+
+void VideoWidget::paintEvent(QPaintEvent *)
+{
+    if (gl_) return;   // the OpenGL child covers the whole widget
+
+    QElapsedTimer timer;
+    timer.start();
+    QPainter painter(this);
+    const QRect target = frameRect();
+    if (target.isEmpty()) {
+        painter.fillRect(rect(), kBackground);
+        return;
+    }
+
+    // Only the bars around the frame need clearing
+    painter.fillRect(QRect(0, 0, width(), target.top()), kBackground);
+    painter.fillRect(QRect(0, target.bottom() + 1, width(), height() - target.bottom() - 1), kBackground);
+    painter.fillRect(QRect(0, target.top(), target.left(), target.height()), kBackground);
+    painter.fillRect(QRect(target.right() + 1, target.top(), width() - target.right() - 1, target.height()),
+                     kBackground);
+
+    // The convert stage already scaled to this size, so this is normally a plain blit
+    if (frame_.size() == target.size()) {
+        painter.drawImage(target.topLeft(), frame_);
+    } else {
+        painter.drawImage(target, frame_);
+    }
+    if (paintPending_) framePainted(timer.nsecsElapsed());
+}
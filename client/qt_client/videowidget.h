@@ -0,0 +1,69 @@
+#ifndef VIDEOWIDGET_H
+#define VIDEOWIDGET_H
+
+#include <QWidget>
+#include <QImage>
+#include <QColor>
+
+class QWindow;
+class YuvGlWidget;
+
+// Shows the newest video frame, painted straight from the QImage the
+// convert stage produced: no QPixmap conversion, no label layout.
+//
+// setFrame() only keeps the frame and asks the window for an update
+// (QWindow::requestUpdate), so however many frames arrive in between, one
+// paint per display refresh shows the latest of them. The frame is drawn
+// aspect-fit into the widget.
+//
+// RGB32 frames are painted with QPainter. I420 frames (Format_Grayscale8,
+// see VideoThread::setOutputYuv) go to an OpenGL child that uploads the
+// planes and converts colour in a shader; this also runs on software Mesa.
+class VideoWidget : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit VideoWidget(QWidget *parent = nullptr);
+
+    // Switches to the OpenGL path; false when this Qt has no OpenGL support
+    bool setUseOpenGL(bool use);
+    bool usesOpenGL() const { return gl_ != nullptr; }
+
+    void setFrame(const QImage &image);
+    void clearFrame();
+
+    // Where the current frame is drawn, in widget coordinates; empty without a frame
+    QRect frameRect() const;
+
+    struct PaintStats {
+        qint64 painted = 0;
+        qint64 coalesced = 0;     // frames replaced before they were painted
+        double msPerFrame = 0.0;  // recent average, upload included on the GL path
+    };
+    PaintStats paintStats() const { return stats_; }
+
+    // Called by the paint paths with the time one frame took
+    void framePainted(qint64 nsecs);
+
+    // Size of the picture a frame holds (I420 images are 3/2 as tall)
+    static QSize pictureSize(const QImage &image);
+
+    static const QColor kBackground;
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    void requestRepaint();
+
+    QImage frame_;
+    bool paintPending_;        // frame_ has not been painted yet
+    bool updateRequested_;     // an UpdateRequest is on its way
+    QWindow *watchedWindow_;
+    YuvGlWidget *gl_;
+    PaintStats stats_;
+};
+
+#endif // VIDEOWIDGET_H
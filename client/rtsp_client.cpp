@@ -8,6 +8,22 @@
 #include <ctime>
 #include <iomanip>
 #include <sstream>
+#include <cstdlib>
+#include <atomic>
+#include <algorithm>
+
+#include "clientoptions.h"
+#include "convertbench.h"
+#include "decodebench.h"
+#include "decoderthreading.h"
+#include "decoderselect.h"
+#include "streamcache.h"
+#include "reconnect.h"
+#include "iointerrupt.h"
+#include "livelatency.h"
+#include "frameexport.h"
+#include "packetwriter.h"
+#include "segmentrecorder.h"
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -17,28 +33,109 @@ extern "C" {
 #include <libswscale/swscale.h>
 }
 
-static bool g_running = true;
+// 信号处理函数里只做原子写；阻塞中的网络调用由 IoInterrupter 检查 g_running 后中断
+static std::atomic<bool> g_running(true);
+static std::atomic<int64_t> g_stopRequestedUs(0);
+
+// 显示模式下 OpenCV 单次读取的超时，也是 Ctrl+C 最长的等待时间
+static const int kCaptureReadSliceMs = 100;
 
 void signalHandler(int signum) {
     std::cout << "\n接收到停止信号，正在退出..." << std::endl;
+    g_stopRequestedUs = av_gettime_relative();
     g_running = false;
 }
 
 class RtspClient {
 public:
-    RtspClient(const std::string& url) : url_(url), 
+    RtspClient(const std::string& url, const DecoderThreadingPolicy& threading = DecoderThreadingPolicy(),
+               const IoTimeouts& timeouts = IoTimeouts())
+        : url_(url), threading_(threading),
         formatCtx_(nullptr), codecCtx_(nullptr), 
         codec_(nullptr), swsCtx_(nullptr),
-        videoStreamIndex_(-1), frameCount_(0) {}
+        videoStreamIndex_(-1), frameCount_(0), streamCacheHit_(false),
+        interrupter_(timeouts) {
+        interrupter_.watch(&g_running);
+    }
     
     ~RtspClient() {
         cleanup();
     }
     
+    // 显示模式下允许落后直播的最大延迟，0 表示不追帧
+    void setTargetLatency(int ms) {
+        latencyControl_.setTargetMs(ms);
+    }
+    
+    // 各编码格式优先使用的软件解码器
+    void setDecoderSelection(const DecoderSelection& selection) {
+        decoderSelection_ = selection;
+    }
+    
+    // 录制模式的写入队列大小和队列满时的处理方式
+    void setPacketWriter(const PacketWriterConfig& config) {
+        writerConfig_ = config;
+    }
+    
+    // 分段录制：按时长或大小在关键帧处切分，name 给出第 N 段的文件名
+    void setSegmentRecording(const SegmentConfig& config, const SegmentRecorder::NameFn& name) {
+        segmentConfig_ = config;
+        segmentName_ = name;
+    }
+    
     bool init() {
+        openStart_ = std::chrono::steady_clock::now();
+        
+        if (!openInput()) {
+            return false;
+        }
+        
+        // 获取解码器
+        AVCodecParameters* codecParams = formatCtx_->streams[videoStreamIndex_]->codecpar;
+        codec_ = selectDecoder(codecParams->codec_id, decoderSelection_);
+        if (!codec_) {
+            std::cerr << "未找到解码器: " << avcodec_get_name(codecParams->codec_id) << std::endl;
+            return false;
+        }
+        
+        codecCtx_ = avcodec_alloc_context3(codec_);
+        if (avcodec_parameters_to_context(codecCtx_, codecParams) < 0) {
+            std::cerr << "无法复制解码器参数" << std::endl;
+            return false;
+        }
+        
+        // 按分辨率和核数选择帧/切片多线程，低延迟标志也由策略统一设置
+        // （帧多线程与 LOW_DELAY/CHUNKS 互斥，不能再通过选项字典强制打开）
+        applyDecoderThreading(codecCtx_, threading_);
+        // 编解码器私有的低延迟参数（如 libdav1d 只保留一帧在途）
+        applyCodecLowLatency(codecCtx_);
+        
+        if (avcodec_open2(codecCtx_, codec_, nullptr) < 0) {
+            std::cerr << "无法打开解码器" << std::endl;
+            return false;
+        }
+        
+        std::cout << "连接成功！" << std::endl;
+        std::cout << "视频信息: " << codecCtx_->width << "x" << codecCtx_->height 
+                  << " " << av_get_pix_fmt_name(codecCtx_->pix_fmt) << std::endl;
+        std::cout << "解码器: " << codec_->name << " (" << avcodec_get_name(codec_->id) << ")" << std::endl;
+        std::cout << "解码线程: " << describeDecoderThreading(codecCtx_)
+                  << " (策略: " << decoderThreadingModeName(threading_.mode) << ")" << std::endl;
+        
+        return true;
+    }
+    
+    // 打开输入并找到视频流，首次连接和断流重连共用
+    bool openInput() {
+        auto openedAt = std::chrono::steady_clock::now();
+        
         // 打开RTSP流或SDP文件
         formatCtx_ = avformat_alloc_context();
         
+        // 打开和探测都受超时限制，Ctrl+C 也能打断
+        interrupter_.install(formatCtx_);
+        interrupter_.beginOpen();
+        
         AVDictionary* options = nullptr;
         
         // 检查是否是SDP文件
@@ -69,8 +166,8 @@ public:
         formatCtx_->max_analyze_duration = 5 * AV_TIME_BASE; // 5秒超时
         formatCtx_->probesize = 10000000; // 10MB探测大小
         
-        // 获取流信息
-        ret = avformat_find_stream_info(formatCtx_, nullptr);
+        // 获取流信息：见过的流直接用缓存的参数，只做极小的探测
+        ret = streamCache_.findStreamInfo(formatCtx_, url_, &streamCacheHit_);
         if (ret < 0) {
             char errbuf[128];
             av_strerror(ret, errbuf, sizeof(errbuf));
@@ -78,9 +175,11 @@ public:
             return false;
         }
         
-        std::cout << "流信息获取成功" << std::endl;
+        std::cout << "流信息获取成功 (" << (streamCacheHit_ ? "参数缓存命中" : "完整探测") << ", "
+                  << elapsedMs(openedAt) << " ms)" << std::endl;
         
         // 查找视频流
+        videoStreamIndex_ = -1;
         for (unsigned int i = 0; i < formatCtx_->nb_streams; i++) {
             if (formatCtx_->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
                 videoStreamIndex_ = i;
@@ -93,85 +192,51 @@ public:
             return false;
         }
         
-        // 获取解码器
-        AVCodecParameters* codecParams = formatCtx_->streams[videoStreamIndex_]->codecpar;
-        codec_ = avcodec_find_decoder(codecParams->codec_id);
-        if (!codec_) {
-            std::cerr << "未找到解码器" << std::endl;
-            return false;
-        }
-        
-        codecCtx_ = avcodec_alloc_context3(codec_);
-        if (avcodec_parameters_to_context(codecCtx_, codecParams) < 0) {
-            std::cerr << "无法复制解码器参数" << std::endl;
-            return false;
-        }
-        
-        // 设置解码器选项，允许缺少参数集时继续解码
-        codecCtx_->flags2 |= AV_CODEC_FLAG2_CHUNKS;
-        codecCtx_->flags |= AV_CODEC_FLAG_LOW_DELAY;
-        
-        AVDictionary* codecOpts = nullptr;
-        av_dict_set(&codecOpts, "flags", "low_delay", 0);
-        
-        if (avcodec_open2(codecCtx_, codec_, &codecOpts) < 0) {
-            std::cerr << "无法打开解码器" << std::endl;
-            av_dict_free(&codecOpts);
-            return false;
-        }
-        av_dict_free(&codecOpts);
-        
-        std::cout << "连接成功！" << std::endl;
-        std::cout << "视频信息: " << codecCtx_->width << "x" << codecCtx_->height 
-                  << " " << av_get_pix_fmt_name(codecCtx_->pix_fmt) << std::endl;
-        
         return true;
     }
     
     void receiveAndSaveMP4(const std::string& outputFile, int durationSeconds = 0) {
-        // 创建输出格式上下文
-        AVFormatContext* outFormatCtx = nullptr;
-        avformat_alloc_output_context2(&outFormatCtx, nullptr, nullptr, outputFile.c_str());
-        if (!outFormatCtx) {
-            std::cerr << "无法创建输出格式上下文" << std::endl;
-            return;
-        }
-        
-        // 创建视频流
-        AVStream* outStream = avformat_new_stream(outFormatCtx, nullptr);
-        if (!outStream) {
-            std::cerr << "无法创建输出视频流" << std::endl;
-            avformat_free_context(outFormatCtx);
-            return;
-        }
-        
-        // 复制编解码器参数
         AVStream* inStream = formatCtx_->streams[videoStreamIndex_];
-        avcodec_parameters_copy(outStream->codecpar, inStream->codecpar);
-        outStream->codecpar->codec_tag = 0;
-        outStream->time_base = inStream->time_base;
         
-        // 打开输出文件
-        if (!(outFormatCtx->oformat->flags & AVFMT_NOFILE)) {
-            if (avio_open(&outFormatCtx->pb, outputFile.c_str(), AVIO_FLAG_WRITE) < 0) {
-                std::cerr << "无法打开输出文件: " << outputFile << std::endl;
-                avformat_free_context(outFormatCtx);
+        // 分段录制时每段由 SegmentRecorder 自己打开，否则写一个 MP4 文件
+        AVFormatContext* outFormatCtx = nullptr;
+        SegmentRecorder* segments = nullptr;
+        AVRational recordTimeBase = inStream->time_base;
+        if (segmentConfig_.enabled()) {
+            segments = new SegmentRecorder(segmentConfig_, segmentName_);
+            segments->setStream(inStream->codecpar, inStream->time_base);
+        } else {
+            outFormatCtx = openOutputFile(outputFile, inStream);
+            if (!outFormatCtx) {
                 return;
             }
-        }
-        
-        // 写入文件头
-        if (avformat_write_header(outFormatCtx, nullptr) < 0) {
-            std::cerr << "无法写入文件头" << std::endl;
-            if (!(outFormatCtx->oformat->flags & AVFMT_NOFILE))
-                avio_closep(&outFormatCtx->pb);
-            avformat_free_context(outFormatCtx);
-            return;
+            // 写文件头时复用器可能改了时间基
+            recordTimeBase = outFormatCtx->streams[0]->time_base;
         }
         
         AVPacket* packet = av_packet_alloc();
+        
+        // 写文件放到单独的线程：磁盘慢或 fsync 卡住时只会让队列变长，不会停止从网络读取
+        PacketWriter writer(writerConfig_, [outFormatCtx, segments](AVPacket* pkt) {
+            int ret = segments ? segments->write(pkt) : av_interleaved_write_frame(outFormatCtx, pkt);
+            if (ret < 0) {
+                char errBuf[128];
+                av_strerror(ret, errBuf, sizeof(errBuf));
+                std::cerr << "写入失败: " << errBuf << std::endl;
+            }
+            return ret;
+        });
 
-        std::cout << "开始录制视频到: " << outputFile << std::endl;
+        if (segments) {
+            std::cout << "分段录制 (" << (segmentConfig_.format == SEGMENT_MPEGTS ? "MPEG-TS" : "fMP4") << "): 在关键帧处切分，每段";
+            if (segmentConfig_.seconds > 0) std::cout << " " << segmentConfig_.seconds << " 秒";
+            if (segmentConfig_.maxBytes > 0) std::cout << " " << segmentConfig_.maxBytes / (1024 * 1024) << " MB";
+            std::cout << std::endl;
+        } else {
+            std::cout << "开始录制视频到: " << outputFile << std::endl;
+        }
+        std::cout << "写入队列: " << writerConfig_.maxBytes / 1024 << " KB, 队列满时: "
+                  << writeQueuePolicyName(writerConfig_.policy) << std::endl;
         if (durationSeconds > 0) {
             std::cout << "录制时长: " << durationSeconds << " 秒" << std::endl;
         } else {
@@ -179,7 +244,12 @@ public:
         }
 
         auto startTime = std::chrono::steady_clock::now();
-        int readErrorCount = 0;
+        auto lastWriteTime = startTime;
+        bool waitForKeyframe = false;
+        
+        // 重连后 formatCtx_ 会被重新打开，这里留一份参数用来判断还能不能接着写
+        AVCodecParameters* recordedParams = avcodec_parameters_alloc();
+        avcodec_parameters_copy(recordedParams, inStream->codecpar);
 
         // 根据输入流估算帧率，生成恒定间隔时间戳
         AVRational fps = inStream->avg_frame_rate.num > 0 && inStream->avg_frame_rate.den > 0
@@ -190,35 +260,67 @@ public:
             fps.den = 1;
         }
 
-        int64_t ticksPerFrame = av_rescale_q(1, av_inv_q(fps), outStream->time_base);
+        int64_t ticksPerFrame = av_rescale_q(1, av_inv_q(fps), recordTimeBase);
         if (ticksPerFrame <= 0) {
             // 兜底：如果计算失败，默认按 25fps 计算
             AVRational defaultFps = {25, 1};
-            ticksPerFrame = av_rescale_q(1, av_inv_q(defaultFps), outStream->time_base);
+            ticksPerFrame = av_rescale_q(1, av_inv_q(defaultFps), recordTimeBase);
         }
         int64_t frameIndex = 0;
 
         int readResult = 0;
         while (g_running) {
+            interrupter_.beginRead();
             readResult = av_read_frame(formatCtx_, packet);
 
             if (readResult < 0) {
-                readErrorCount++;
-                if (readErrorCount > 100) {
-                    std::cerr << "\n读取数据包失败次数过多，停止录制" << std::endl;
-                    char errBuf[128];
-                    av_strerror(readResult, errBuf, sizeof(errBuf));
-                    std::cerr << "错误: " << errBuf << std::endl;
+                if (!g_running) {
+                    break; // Ctrl+C 打断了读取
+                }
+                if (readResult == AVERROR(EAGAIN)) {
+                    av_usleep(10000); // 暂时没有数据，等待 10ms
+                    continue;
+                }
+                
+                char errBuf[128];
+                av_strerror(readResult, errBuf, sizeof(errBuf));
+                std::cerr << "\n读取数据包失败: " << errBuf;
+                if (interrupter_.timedOut()) {
+                    std::cerr << " (" << interrupter_.timeouts().readMs << " ms 内没有收到数据)";
+                }
+                std::cerr << std::endl;
+                
+                // 断流：重连后继续写同一个文件，而不是提前结束录制
+                if (!reconnect()) {
+                    break;
+                }
+                if (!sameCodecParameters(recordedParams, formatCtx_->streams[videoStreamIndex_]->codecpar)) {
+                    std::cerr << "重连后视频参数已变化，无法继续写入同一个文件，停止录制" << std::endl;
                     break;
                 }
-                av_usleep(10000); // 等待 10ms
+                waitForKeyframe = true;
                 continue;
             }
 
-            readErrorCount = 0; // 重置错误计数
-
             if (packet->stream_index == videoStreamIndex_) {
+                // 重连后从关键帧开始写，断流的时长计入时间轴，保持和真实时间对齐
+                if (waitForKeyframe) {
+                    if (!(packet->flags & AV_PKT_FLAG_KEY)) {
+                        av_packet_unref(packet);
+                        continue;
+                    }
+                    waitForKeyframe = false;
+                    double gap = std::chrono::duration<double>(std::chrono::steady_clock::now() - lastWriteTime).count();
+                    int64_t gapFrames = static_cast<int64_t>(gap * av_q2d(fps)) - 1;
+                    if (gapFrames > 0) {
+                        frameIndex += gapFrames;
+                    }
+                }
+                
                 frameCount_++;
+                if (frameCount_ == 1) {
+                    logTimeToFirstFrame();
+                }
 
                 // 使用恒定帧率生成时间戳，完全忽略网络抖动带来的原始时间戳
                 packet->stream_index = 0;
@@ -227,19 +329,23 @@ public:
                 packet->duration = ticksPerFrame;
                 frameIndex++;
 
-                // 写入数据包
-                int ret = av_interleaved_write_frame(outFormatCtx, packet);
-                if (ret < 0) {
-                    char errBuf[128];
-                    av_strerror(ret, errBuf, sizeof(errBuf));
-                    std::cerr << "写入失败: " << errBuf << std::endl;
-                }
+                // 交给写线程（只增加引用计数，不拷贝数据）；被丢弃的帧在时间轴上留空
+                writer.push(packet, g_running);
+                lastWriteTime = std::chrono::steady_clock::now();
 
                 if (frameCount_ % 30 == 0) {
                     auto currentTime = std::chrono::steady_clock::now();
                     double elapsed = std::chrono::duration<double>(currentTime - startTime).count();
+                    PacketWriter::Stats ws = writer.stats();
                     std::cout << "已录制 " << frameCount_ << " 帧 (" 
-                              << std::fixed << std::setprecision(1) << elapsed << " 秒)" << std::endl;
+                              << std::fixed << std::setprecision(1) << elapsed << " 秒)"
+                              << " | 写入队列 " << ws.queuedPackets << " 包 / " << ws.queuedBytes / 1024 << " KB"
+                              << ", 最长写入 " << ws.maxWriteMs << " ms"
+                              << ", 丢弃 " << ws.dropped;
+                    if (segments) {
+                        std::cout << " | 分段 #" << segments->stats().segments;
+                    }
+                    std::cout << std::endl;
                 }
 
                 // 检查是否达到指定录制时长（按真实时间判断）
@@ -256,14 +362,26 @@ public:
             av_packet_unref(packet);
         }
         
-        // 写入文件尾
-        av_write_trailer(outFormatCtx);
+        // 先把队列里的包写完，再写文件尾
+        writer.finish();
+        PacketWriter::Stats writerStats = writer.stats();
+        SegmentRecorder::Stats segmentStats;
+        if (segments) {
+            // 等后台线程把所有分段收尾关闭
+            segments->close();
+            segmentStats = segments->stats();
+            delete segments;
+            segments = nullptr;
+        } else {
+            av_write_trailer(outFormatCtx);
+            if (!(outFormatCtx->oformat->flags & AVFMT_NOFILE))
+                avio_closep(&outFormatCtx->pb);
+            avformat_free_context(outFormatCtx);
+        }
         
         // 清理资源
         av_packet_free(&packet);
-        if (!(outFormatCtx->oformat->flags & AVFMT_NOFILE))
-            avio_closep(&outFormatCtx->pb);
-        avformat_free_context(outFormatCtx);
+        avcodec_parameters_free(&recordedParams);
         
         auto endTime = std::chrono::steady_clock::now();
         double totalTime = std::chrono::duration<double>(endTime - startTime).count();
@@ -272,13 +390,40 @@ public:
         std::cout << "总帧数: " << frameCount_ << " 帧" << std::endl;
         std::cout << "总时长: " << std::fixed << std::setprecision(2) << totalTime << " 秒" << std::endl;
         std::cout << "平均帧率: " << std::fixed << std::setprecision(2) << (frameCount_ / totalTime) << " fps" << std::endl;
-        std::cout << "文件已保存到: " << outputFile << std::endl;
+        std::cout << "写入队列: 写入 " << writerStats.written << " 包, 丢弃 " << writerStats.dropped
+                  << ", 写入失败 " << writerStats.writeErrors << ", 最高 " << writerStats.highWaterBytes / 1024 << " KB"
+                  << ", 最长写入 " << std::setprecision(1) << writerStats.maxWriteMs << " ms"
+                  << ", 读取线程等待 " << writerStats.blockedMs << " ms" << std::endl;
+        if (segmentConfig_.enabled()) {
+            std::cout << "分段: " << segmentStats.segments << " 个, 共 " << segmentStats.bytes / 1024 << " KB"
+                      << ", 打开新分段最长 " << segmentStats.maxOpenMs << " ms";
+            if (segmentStats.openFailures > 0) {
+                std::cout << ", 打开失败 " << segmentStats.openFailures << " 次";
+            }
+            std::cout << std::endl;
+            std::cout << "最后一个分段: " << segmentStats.current << std::endl;
+        } else {
+            std::cout << "文件已保存到: " << outputFile << std::endl;
+        }
+        printReconnectStats();
     }
     
     void receiveAndDisplay() {
         std::cout << "尝试使用 OpenCV 打开流: " << url_ << std::endl;
-        // 使用 FFmpeg 后端
-        cv::VideoCapture cap(url_, cv::CAP_FFMPEG);
+        cv::VideoCapture cap;
+        
+        // 参数缓存命中时让 OpenCV 也只做极小的探测；打不开再按默认参数重试
+        // （用户自己设置了该环境变量时不覆盖）
+        const char* kCaptureOptions = "OPENCV_FFMPEG_CAPTURE_OPTIONS";
+        bool tinyProbe = streamCacheHit_ && !getenv(kCaptureOptions);
+        if (tinyProbe) {
+            setenv(kCaptureOptions, "rtsp_transport;tcp|probesize;32768|analyzeduration;200000", 1);
+        }
+        if (!openCapture(cap) && tinyProbe) {
+            std::cout << "极小探测打不开流，改用完整探测" << std::endl;
+            unsetenv(kCaptureOptions);
+            openCapture(cap);
+        }
         
         if (!cap.isOpened()) {
             std::cerr << "OpenCV 无法打开流" << std::endl;
@@ -291,23 +436,69 @@ public:
         int width = (int)cap.get(cv::CAP_PROP_FRAME_WIDTH);
         int height = (int)cap.get(cv::CAP_PROP_FRAME_HEIGHT);
         std::cout << "分辨率: " << width << "x" << height << std::endl;
+        
+        // 实际分辨率和缓存的参数对不上，说明摄像头配置变了，下次重新完整探测
+        const AVCodecParameters* par = formatCtx_->streams[videoStreamIndex_]->codecpar;
+        if (streamCacheHit_ && (width != par->width || height != par->height)) {
+            std::cout << "流参数与缓存不一致，已清除缓存" << std::endl;
+            streamCache_.remove(url_);
+        }
 
         cv::Mat frame;
         auto startTime = std::chrono::steady_clock::now();
         frameCount_ = 0;
 
+        latency_.reset();
+        latencyControl_.reset();
+        long long skippedFrames = 0;
+        int64_t latencyMs = -1;
+        int64_t lastGrabUs = av_gettime_relative();
+
         while (g_running) {
-            if (!cap.read(frame)) {
-                 // 如果读取失败，可能是流断了或者结束了
-                 // 尝试简单的重连或者退出
-                 // 这里选择退出，让外层决定
-                 std::cout << "读取帧失败或流结束" << std::endl;
-                 break;
+            if (!cap.grab()) {
+                 // OpenCV 的单次读取超时被截短成一小段，这样 Ctrl+C 最多等这一段；
+                 // 累计没读到帧的时间没到 --read-timeout 之前都算卡顿，接着读
+                 if (g_running && av_gettime_relative() - lastGrabUs < interrupter_.timeouts().readMs * 1000LL) {
+                     av_usleep(10000);
+                     continue;
+                 }
+                 if (!g_running) break;
+                 // 读取失败，可能是流断了：按退避策略重新打开，窗口保持不动
+                 std::cout << "\n读取帧失败或流结束" << std::endl;
+                 if (!reconnectCapture(cap)) {
+                     break;
+                 }
+                 // 时间戳重新开始，直播边缘要重新估计
+                 latency_.reset();
+                 latencyControl_.reset();
+                 lastGrabUs = av_gettime_relative();
+                 continue;
+            }
+            lastGrabUs = av_gettime_relative();
+            
+            // 用帧的 PTS 对比拿到它的时间估算落后直播多少。OpenCV 看不到包，
+            // 也没法只解参考帧或跳到关键帧，落后时只 grab 不转换、不显示，尽快追上
+            int64_t nowUs = av_gettime_relative();
+            int64_t ptsUs = static_cast<int64_t>(cap.get(cv::CAP_PROP_POS_MSEC) * 1000);
+            latency_.packetArrived(ptsUs, nowUs);
+            int64_t latencyUs = latency_.latencyUs(ptsUs, nowUs);
+            latencyMs = latencyUs < 0 ? -1 : latencyUs / 1000;   // -1: 还没有基准
+            if (latencyControl_.update(latencyMs) != CATCHUP_NONE) {
+                skippedFrames++;
+                // 追帧时也要处理窗口事件，否则窗口卡住、按 q 也没反应
+                char c = (char)cv::waitKey(1);
+                if (c == 'q' || c == 27) {
+                    g_running = false;
+                }
+                continue;
             }
             
-            if (frame.empty()) continue;
+            if (!cap.retrieve(frame) || frame.empty()) continue;
             
             frameCount_++;
+            if (frameCount_ == 1) {
+                logTimeToFirstFrame();
+            }
             cv::imshow("RTSP Player", frame);
             
             // 必须有 waitKey 才能刷新窗口
@@ -320,15 +511,236 @@ public:
                 auto currentTime = std::chrono::steady_clock::now();
                 double elapsed = std::chrono::duration<double>(currentTime - startTime).count();
                 double fps = frameCount_ / elapsed;
-                std::cout << "已播放 " << frameCount_ << " 帧 | FPS: " << std::fixed << std::setprecision(1) << fps << "\r" << std::flush;
+                std::cout << "已播放 " << frameCount_ << " 帧 | FPS: " << std::fixed << std::setprecision(1) << fps
+                          << " | 延迟 " << (latencyMs < 0 ? std::string("?") : std::to_string(latencyMs))
+                          << "/" << latencyControl_.targetMs() << " ms"
+                          << " | 追帧跳过 " << skippedFrames << "\r" << std::flush;
             }
         }
         cv::destroyAllWindows();
         cap.release();
         std::cout << "\n播放结束" << std::endl;
+        if (skippedFrames > 0) {
+            std::cout << "为追上直播跳过显示 " << skippedFrames << " 帧" << std::endl;
+        }
+        printReconnectStats();
+    }
+    
+    // 无界面导出：解码后把帧发布到共享内存环形缓冲区，同机的分析进程直接映射，
+    // 不用各自再连一次流、再解一次码
+    void receiveAndExport(const FrameExportConfig& config, int durationSeconds = 0) {
+        FrameShmExporter exporter(config);
+        AVPacket* packet = av_packet_alloc();
+        AVFrame* frame = av_frame_alloc();
+        AVRational timeBase = formatCtx_->streams[videoStreamIndex_]->time_base;
+        
+        std::cout << "开始导出解码帧到共享内存: " << config.name
+                  << " (" << config.slotCount << " 个槽)" << std::endl;
+        std::cout << "读取端示例: shm_consumer " << config.name << std::endl;
+        
+        auto startTime = std::chrono::steady_clock::now();
+        frameCount_ = 0;
+        bool waitForKeyframe = false;
+        
+        while (g_running) {
+            interrupter_.beginRead();
+            int ret = av_read_frame(formatCtx_, packet);
+            if (ret < 0) {
+                if (!g_running) break;
+                if (ret == AVERROR(EAGAIN)) {
+                    av_usleep(10000);
+                    continue;
+                }
+                std::cout << "\n读取数据包失败" << std::endl;
+                if (!reconnect()) break;
+                // 解码器里剩下的参考帧属于断开前的流
+                avcodec_flush_buffers(codecCtx_);
+                timeBase = formatCtx_->streams[videoStreamIndex_]->time_base;
+                waitForKeyframe = true;
+                continue;
+            }
+            
+            if (packet->stream_index != videoStreamIndex_ ||
+                (waitForKeyframe && !(packet->flags & AV_PKT_FLAG_KEY))) {
+                av_packet_unref(packet);
+                continue;
+            }
+            waitForKeyframe = false;
+            
+            if (avcodec_send_packet(codecCtx_, packet) == 0) {
+                while (avcodec_receive_frame(codecCtx_, frame) == 0) {
+                    int64_t pts = frame->best_effort_timestamp;
+                    int64_t ptsUs = pts == AV_NOPTS_VALUE ? INT64_MIN : av_rescale_q(pts, timeBase, AV_TIME_BASE_Q);
+                    if (!exporter.publish(frame, ptsUs) && exporter.failed() == 1) {
+                        std::cerr << "无法导出帧: "
+                                  << (exporter.lastError().empty() ? av_get_pix_fmt_name((AVPixelFormat)frame->format)
+                                                                   : exporter.lastError())
+                                  << std::endl;
+                    }
+                    av_frame_unref(frame);
+                    
+                    frameCount_++;
+                    if (frameCount_ == 1) {
+                        logTimeToFirstFrame();
+                    }
+                    if (frameCount_ % 100 == 0) {
+                        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+                        std::cout << "已导出 " << exporter.published() << " 帧 | FPS: " << std::fixed << std::setprecision(1)
+                                  << frameCount_ / elapsed << " | 失败 " << exporter.failed() << "\r" << std::flush;
+                    }
+                }
+            }
+            av_packet_unref(packet);
+            
+            if (durationSeconds > 0 &&
+                std::chrono::steady_clock::now() - startTime >= std::chrono::seconds(durationSeconds)) {
+                break;
+            }
+        }
+        
+        av_frame_free(&frame);
+        av_packet_free(&packet);
+        std::cout << "\n导出结束，共 " << exporter.published() << " 帧" << std::endl;
+        printReconnectStats();
     }
     
 private:
+    // 打开单文件录制的输出，流参数和时间基取自输入流
+    AVFormatContext* openOutputFile(const std::string& outputFile, AVStream* inStream) {
+        // 创建输出格式上下文
+        AVFormatContext* outFormatCtx = nullptr;
+        avformat_alloc_output_context2(&outFormatCtx, nullptr, nullptr, outputFile.c_str());
+        if (!outFormatCtx) {
+            std::cerr << "无法创建输出格式上下文" << std::endl;
+            return nullptr;
+        }
+        
+        // 创建视频流
+        AVStream* outStream = avformat_new_stream(outFormatCtx, nullptr);
+        if (!outStream) {
+            std::cerr << "无法创建输出视频流" << std::endl;
+            avformat_free_context(outFormatCtx);
+            return nullptr;
+        }
+        
+        // 复制编解码器参数
+        avcodec_parameters_copy(outStream->codecpar, inStream->codecpar);
+        outStream->codecpar->codec_tag = 0;
+        outStream->time_base = inStream->time_base;
+        
+        // 打开输出文件
+        if (!(outFormatCtx->oformat->flags & AVFMT_NOFILE)) {
+            if (avio_open(&outFormatCtx->pb, outputFile.c_str(), AVIO_FLAG_WRITE) < 0) {
+                std::cerr << "无法打开输出文件: " << outputFile << std::endl;
+                avformat_free_context(outFormatCtx);
+                return nullptr;
+            }
+        }
+        
+        // 写入文件头
+        if (avformat_write_header(outFormatCtx, nullptr) < 0) {
+            std::cerr << "无法写入文件头" << std::endl;
+            if (!(outFormatCtx->oformat->flags & AVFMT_NOFILE))
+                avio_closep(&outFormatCtx->pb);
+            avformat_free_context(outFormatCtx);
+            return nullptr;
+        }
+        return outFormatCtx;
+    }
+    
+    static long long elapsedMs(std::chrono::steady_clock::time_point since) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now() - since).count();
+    }
+    
+    // 从开始连接到拿到第一帧，用来对比参数缓存命中和完整探测
+    void logTimeToFirstFrame() {
+        std::cout << "首帧耗时: " << elapsedMs(openStart_) << " ms ("
+                  << (streamCacheHit_ ? "参数缓存命中" : "完整探测") << ")" << std::endl;
+    }
+    
+    // 断流后按指数退避（带抖动）重连，成功时 formatCtx_ 已重新打开并找到视频流
+    bool reconnect() {
+        reconnector_.streamLost();
+        std::cout << "流已断开，正在重连..." << std::endl;
+        while (g_running) {
+            if (!waitBackoff()) break;
+            avformat_close_input(&formatCtx_);
+            if (!openInput()) {
+                reconnector_.attemptFailed();
+                continue;
+            }
+            reportRecovered();
+            return true;
+        }
+        return false;
+    }
+    
+    bool reconnectCapture(cv::VideoCapture& cap) {
+        reconnector_.streamLost();
+        std::cout << "流已断开，正在重连..." << std::endl;
+        while (g_running) {
+            if (!waitBackoff()) break;
+            cap.release();
+            if (!openCapture(cap)) {
+                reconnector_.attemptFailed();
+                continue;
+            }
+            reportRecovered();
+            return true;
+        }
+        return false;
+    }
+    
+    // 分段睡眠，Ctrl+C 不用等完整个退避时间
+    bool waitBackoff() {
+        int delay = reconnector_.nextDelayMs();
+        for (int waited = 0; waited < delay && g_running; waited += 10) {
+            av_usleep(10000);
+        }
+        return g_running;
+    }
+    
+    void reportRecovered() {
+        int64_t ms = reconnector_.recovered();
+        std::cout << "重连成功，恢复耗时 " << ms << " ms (第 "
+                  << reconnector_.stats().attempts << " 次尝试)" << std::endl;
+    }
+    
+    void printReconnectStats() {
+        const StreamReconnector::Stats& st = reconnector_.stats();
+        if (st.drops == 0) return;
+        std::cout << "断流 " << st.drops << " 次，恢复 " << st.recoveries << " 次";
+        if (st.recoveries > 0) {
+            std::cout << "，平均恢复耗时 " << st.totalRecoverMs / st.recoveries
+                      << " ms，最长 " << st.maxRecoverMs << " ms";
+        }
+        std::cout << std::endl;
+    }
+    
+    bool openCapture(cv::VideoCapture& cap) {
+        // 使用 FFmpeg 后端。OpenCV 自己打开解码器，只能把线程数传过去，
+        // 线程类型由 OpenCV 决定
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 6)
+        int cvThreads = codecCtx_ ? codecCtx_->thread_count : 0;
+        std::vector<int> capParams;
+        capParams.push_back(cv::CAP_PROP_N_THREADS);
+        capParams.push_back(cvThreads);
+        // OpenCV 用自己的中断回调，看不到 g_running，超时只能通过参数传进去。
+        // 读取超时只给一小段（kCaptureReadSliceMs），由 receiveAndDisplay 循环累计到
+        // --read-timeout，否则 Ctrl+C 要等满整个读取超时才能退出
+        capParams.push_back(cv::CAP_PROP_OPEN_TIMEOUT_MSEC);
+        capParams.push_back(interrupter_.timeouts().openMs);
+        capParams.push_back(cv::CAP_PROP_READ_TIMEOUT_MSEC);
+        capParams.push_back(std::min(interrupter_.timeouts().readMs, kCaptureReadSliceMs));
+        cap.open(url_, cv::CAP_FFMPEG, capParams);
+        std::cout << "OpenCV 解码线程数: " << cvThreads << std::endl;
+#else
+        cap.open(url_, cv::CAP_FFMPEG);
+#endif
+        return cap.isOpened() && cap.get(cv::CAP_PROP_FRAME_WIDTH) > 0;
+    }
+    
     void cleanup() {
         if (swsCtx_) {
             sws_freeContext(swsCtx_);
@@ -342,15 +754,29 @@ private:
     }
     
     std::string url_;
+    DecoderThreadingPolicy threading_;
+    DecoderSelection decoderSelection_;
+    PacketWriterConfig writerConfig_;
+    SegmentConfig segmentConfig_;
+    SegmentRecorder::NameFn segmentName_;
     AVFormatContext* formatCtx_;
     AVCodecContext* codecCtx_;
     const AVCodec* codec_;
     SwsContext* swsCtx_;
     int videoStreamIndex_;
     int frameCount_;
+    StreamParamCache streamCache_;
+    bool streamCacheHit_;
+    std::chrono::steady_clock::time_point openStart_;
+    StreamReconnector reconnector_;
+    IoInterrupter interrupter_;
+    LiveLatencyTracker latency_;
+    LiveLatencyController latencyControl_;
 };
 
-std::string generateTimestampFilename(const std::string& prefix = "video") {
+// segment >= 0 时加上分段序号，如 video_20250101_120000_0003.mp4；时间取调用时刻，即分段开始时间
+std::string generateTimestampFilename(const std::string& prefix = "video", const std::string& extension = ".mp4",
+                                      int segment = -1) {
     auto now = std::chrono::system_clock::now();
     auto time_t_now = std::chrono::system_clock::to_time_t(now);
     std::tm tm_now;
@@ -364,8 +790,11 @@ std::string generateTimestampFilename(const std::string& prefix = "video") {
         << std::setw(2) << tm_now.tm_mday << "_"
         << std::setw(2) << tm_now.tm_hour
         << std::setw(2) << tm_now.tm_min
-        << std::setw(2) << tm_now.tm_sec
-        << ".mp4";
+        << std::setw(2) << tm_now.tm_sec;
+    if (segment >= 0) {
+        oss << "_" << std::setw(4) << segment;
+    }
+    oss << extension;
     return oss.str();
 }
 
@@ -390,8 +819,35 @@ bool createDirectory(const std::string& path) {
 }
 
 int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        std::cout << "用法: " << argv[0] << " <rtsp_url|sdp_file> [record|display] [duration_seconds]" << std::endl;
+    ClientOptions opts(argc, argv);
+    const std::vector<std::string>& args = opts.positional();
+    
+    if (opts.has("bench-convert")) {
+        return runConvertBenchmark();
+    }
+    if (opts.has("bench-decode")) {
+        return runDecodeBenchmark(opts.get("bench-decode"), opts);
+    }
+    
+    if (args.empty()) {
+        std::cout << "用法: " << argv[0] << " <rtsp_url|sdp_file> [record|display|export] [duration_seconds] [选项]" << std::endl;
+        std::cout << "\n选项:" << std::endl;
+        std::cout << "  --decode-threading=auto|frame|slice|off  解码多线程方式" << std::endl;
+        std::cout << "      frame (throughput) 吞吐高，每多一个线程多一帧延迟" << std::endl;
+        std::cout << "      slice (low-latency) 不增加延迟，需要编码端输出多切片" << std::endl;
+        std::cout << "  --decode-threads=N  解码线程数，0 表示按核数自动选择" << std::endl;
+        std::cout << "  --decoder-h264|hevc|av1|vp9=名称[,名称]  指定优先使用的解码器，如 --decoder-av1=libaom-av1" << std::endl;
+        std::cout << "  --open-timeout=ms  连接和探测超时 (默认 10000)" << std::endl;
+        std::cout << "  --read-timeout=ms  读取超时，超过后按断流重连 (默认 5000)" << std::endl;
+        std::cout << "  --target-latency=ms  显示模式允许落后直播的延迟，超过就跳帧追赶 (默认 1000，0 关闭)" << std::endl;
+        std::cout << "  --write-queue-kb=N  录制模式写入队列大小 (默认 8192)" << std::endl;
+        std::cout << "  --write-full=block|drop-nonkey|drop-until-key  写入队列满时：等待、丢非关键帧、丢到下一个关键帧" << std::endl;
+        std::cout << "  --segment-seconds=N  分段录制，每段约 N 秒，在关键帧处切分" << std::endl;
+        std::cout << "  --segment-mb=N  分段录制，每段约 N MB（可与时长同时使用，先到先切）" << std::endl;
+        std::cout << "  --segment-format=fmp4|ts  分段格式 (默认 fmp4，崩溃时最多丢失最后一个片段)" << std::endl;
+        std::cout << "  --shm-export=/name  export 模式发布解码帧的共享内存名" << std::endl;
+        std::cout << "  --shm-slots=N  共享内存环形缓冲区的槽数 (默认 8)" << std::endl;
+        std::cout << "  --shm-mode=0640  共享内存的权限 (默认 0600，只有本用户可读)" << std::endl;
         std::cout << "\n示例:" << std::endl;
         std::cout << "  " << argv[0] << " rtsp://172.22.248.47:8554/live display" << std::endl;
         std::cout << "    - 仅显示统计信息，不保存文件" << std::endl;
@@ -399,17 +855,34 @@ int main(int argc, char* argv[]) {
         std::cout << "    - 持续录制到 output/ 目录，按 Ctrl+C 停止" << std::endl;
         std::cout << "\n  " << argv[0] << " rtsp://172.22.248.47:8554/live record 30" << std::endl;
         std::cout << "    - 录制30秒后自动停止" << std::endl;
+        std::cout << "\n  " << argv[0] << " rtsp://172.22.248.47:8554/live record --segment-seconds=60" << std::endl;
+        std::cout << "    - 每分钟一个分段文件 (fMP4)，持续录制" << std::endl;
         std::cout << "\n  " << argv[0] << " stream.sdp record 60" << std::endl;
         std::cout << "    - 从SDP文件录制60秒" << std::endl;
+        std::cout << "\n  " << argv[0] << " rtsp://172.22.248.47:8554/live export --shm-export=/rtsp_cam1" << std::endl;
+        std::cout << "    - 不显示，解码后发布到共享内存，供 shm_consumer 等分析进程读取" << std::endl;
+        std::cout << "\n  " << argv[0] << " --bench-convert" << std::endl;
+        std::cout << "    - 对比 SIMD 颜色转换与 swscale 的结果和速度" << std::endl;
+        std::cout << "\n  " << argv[0] << " --bench-decode=test.mp4 [--bench-frames=250] [--bench-bitrate=1000]" << std::endl;
+        std::cout << "    - 把同一段内容编码成 H.264/HEVC/AV1，对比各解码器每帧的耗时和码率" << std::endl;
         return -1;
     }
     
     signal(SIGINT, signalHandler);
     
-    std::string url = argv[1];
-    std::string mode = argc > 2 ? argv[2] : "display";
+    std::string url = args[0];
+    std::string mode = args.size() > 1 ? args[1] : "display";
     
-    RtspClient client(url);
+    DecoderThreadingPolicy threading = decoderThreadingFromOptions(opts);
+    RtspClient client(url, threading, ioTimeoutsFromOptions(opts));
+    client.setTargetLatency(targetLatencyFromOptions(opts));
+    client.setDecoderSelection(decoderSelectionFromOptions(opts));
+    client.setPacketWriter(packetWriterFromOptions(opts));
+    SegmentConfig segmentConfig = segmentConfigFromOptions(opts);
+    const std::string segmentExt = segmentExtension(segmentConfig.format);
+    client.setSegmentRecording(segmentConfig, [segmentExt](int index) {
+        return "output/" + generateTimestampFilename("video", segmentExt, index);
+    });
     
     if (!client.init()) {
         std::cerr << "初始化失败" << std::endl;
@@ -427,11 +900,24 @@ int main(int argc, char* argv[]) {
         std::string filename = generateTimestampFilename("video");
         std::string outputPath = "output/" + filename;
         
-        int duration = argc > 3 ? std::stoi(argv[3]) : 0;
+        int duration = args.size() > 2 ? std::stoi(args[2]) : 0;
         client.receiveAndSaveMP4(outputPath, duration);
+    } else if (mode == "export") {
+        FrameExportConfig exportConfig = frameExportFromOptions(opts);
+        if (exportConfig.name.empty()) {
+            std::cerr << "export 模式需要 --shm-export=/name" << std::endl;
+            return -1;
+        }
+        int duration = args.size() > 2 ? std::stoi(args[2]) : 0;
+        client.receiveAndExport(exportConfig, duration);
     } else {
         client.receiveAndDisplay();
     }
     
+    // 从收到 Ctrl+C 到接收/录制结束（录制模式包含写文件尾）
+    if (g_stopRequestedUs > 0) {
+        std::cout << "停止耗时: " << (av_gettime_relative() - g_stopRequestedUs) / 1000 << " ms" << std::endl;
+    }
+    
     return 0;
 }
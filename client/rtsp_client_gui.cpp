@@ -2,85 +2,69 @@
 #include <string>
 #include <signal.h>
 #include <chrono>
+#include <atomic>
 #include <opencv2/opencv.hpp>
 
+#include "clientoptions.h"
+#include "decoderthreading.h"
+#include "decoderselect.h"
+#include "streamcache.h"
+#include "reconnect.h"
+#include "iointerrupt.h"
+#include "yuvconvert.h"
+#include "videofilter.h"
+#include "frameanalytics.h"
+
 extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
 #include <libavutil/imgutils.h>
+#include <libavutil/time.h>
 #include <libswscale/swscale.h>
 }
 
-static bool g_running = true;
+// 阻塞中的网络调用由 IoInterrupter 检查 g_running 后中断
+static std::atomic<bool> g_running(true);
+static std::atomic<int64_t> g_stopRequestedUs(0);
 
 void signalHandler(int signum) {
     std::cout << "\n接收到停止信号，正在退出..." << std::endl;
+    g_stopRequestedUs = av_gettime_relative();
     g_running = false;
     cv::destroyAllWindows();
 }
 
 class RtspClientGUI {
 public:
-    RtspClientGUI(const std::string& url, const std::string& windowName = "Video Transmission") 
-        : url_(url), windowName_(windowName),
+    RtspClientGUI(const std::string& url, const std::string& windowName = "Video Transmission",
+                  const DecoderThreadingPolicy& threading = DecoderThreadingPolicy(),
+                  const IoTimeouts& timeouts = IoTimeouts(),
+                  const VideoFilterConfig& filter = VideoFilterConfig(),
+                  const AnalyticsConfig& analytics = AnalyticsConfig(),
+                  const DecoderSelection& decoders = DecoderSelection()) 
+        : url_(url), windowName_(windowName), threading_(threading), decoderSelection_(decoders),
           formatCtx_(nullptr), codecCtx_(nullptr), 
-          codec_(nullptr), swsCtx_(nullptr),
-          videoStreamIndex_(-1), frameCount_(0) {}
+          codec_(nullptr), filter_(filter), analyticsConfig_(analytics), analytics_(nullptr),
+          motionActive_(false), videoStreamIndex_(-1), frameCount_(0), streamCacheHit_(false),
+          interrupter_(timeouts) {
+        interrupter_.watch(&g_running);
+    }
     
     ~RtspClientGUI() {
         cleanup();
     }
     
     bool init() {
-        formatCtx_ = avformat_alloc_context();
-        
-        AVDictionary* options = nullptr;
-        av_dict_set(&options, "rtsp_transport", "tcp", 0);
-        av_dict_set(&options, "max_delay", "500000", 0);
-        
-        std::cout << "正在连接RTSP流: " << url_ << std::endl;
-        
-        int ret = avformat_open_input(&formatCtx_, url_.c_str(), nullptr, &options);
-        av_dict_free(&options);
-        
-        if (ret != 0) {
-            char errbuf[128];
-            av_strerror(ret, errbuf, sizeof(errbuf));
-            std::cerr << "无法打开流: " << errbuf << std::endl;
-            return false;
-        }
-        
-        std::cout << "流已打开，正在获取流信息..." << std::endl;
-        
-        formatCtx_->max_analyze_duration = 5 * AV_TIME_BASE;
-        formatCtx_->probesize = 10000000;
-        
-        ret = avformat_find_stream_info(formatCtx_, nullptr);
-        if (ret < 0) {
-            char errbuf[128];
-            av_strerror(ret, errbuf, sizeof(errbuf));
-            std::cerr << "无法获取流信息: " << errbuf << std::endl;
-            return false;
-        }
-        
-        // 查找视频流
-        for (unsigned int i = 0; i < formatCtx_->nb_streams; i++) {
-            if (formatCtx_->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-                videoStreamIndex_ = i;
-                break;
-            }
-        }
-        
-        if (videoStreamIndex_ == -1) {
-            std::cerr << "未找到视频流" << std::endl;
+        openStart_ = std::chrono::steady_clock::now();
+        if (!openInput()) {
             return false;
         }
         
         // 获取解码器
         AVCodecParameters* codecParams = formatCtx_->streams[videoStreamIndex_]->codecpar;
-        codec_ = avcodec_find_decoder(codecParams->codec_id);
+        codec_ = selectDecoder(codecParams->codec_id, decoderSelection_);
         if (!codec_) {
-            std::cerr << "未找到解码器" << std::endl;
+            std::cerr << "未找到解码器: " << avcodec_get_name(codecParams->codec_id) << std::endl;
             return false;
         }
         
@@ -90,8 +74,9 @@ public:
             return false;
         }
         
-        codecCtx_->flags2 |= AV_CODEC_FLAG2_CHUNKS;
-        codecCtx_->flags |= AV_CODEC_FLAG_LOW_DELAY;
+        // 解码多线程策略（同时决定是否开启 LOW_DELAY/CHUNKS）
+        applyDecoderThreading(codecCtx_, threading_);
+        applyCodecLowLatency(codecCtx_);
         
         if (avcodec_open2(codecCtx_, codec_, nullptr) < 0) {
             std::cerr << "无法打开解码器" << std::endl;
@@ -100,6 +85,9 @@ public:
         
         std::cout << "连接成功！" << std::endl;
         std::cout << "视频信息: " << codecCtx_->width << "x" << codecCtx_->height << std::endl;
+        std::cout << "解码器: " << codec_->name << " (" << avcodec_get_name(codec_->id) << ")" << std::endl;
+        std::cout << "解码线程: " << describeDecoderThreading(codecCtx_)
+                  << " (策略: " << decoderThreadingModeName(threading_.mode) << ")" << std::endl;
         
         // 创建显示窗口
         cv::namedWindow(windowName_, cv::WINDOW_NORMAL);
@@ -124,22 +112,92 @@ public:
         return true;
     }
     
+    // 打开输入并找到视频流，首次连接和断流重连共用
+    bool openInput() {
+        formatCtx_ = avformat_alloc_context();
+        interrupter_.install(formatCtx_);
+        interrupter_.beginOpen();
+        
+        AVDictionary* options = nullptr;
+        av_dict_set(&options, "rtsp_transport", "tcp", 0);
+        av_dict_set(&options, "max_delay", "500000", 0);
+        
+        std::cout << "正在连接RTSP流: " << url_ << std::endl;
+        
+        int ret = avformat_open_input(&formatCtx_, url_.c_str(), nullptr, &options);
+        av_dict_free(&options);
+        
+        if (ret != 0) {
+            char errbuf[128];
+            av_strerror(ret, errbuf, sizeof(errbuf));
+            std::cerr << "无法打开流: " << errbuf << std::endl;
+            return false;
+        }
+        
+        std::cout << "流已打开，正在获取流信息..." << std::endl;
+        
+        formatCtx_->max_analyze_duration = 5 * AV_TIME_BASE;
+        formatCtx_->probesize = 10000000;
+        
+        // 见过的流直接用缓存的参数，只做极小的探测
+        ret = streamCache_.findStreamInfo(formatCtx_, url_, &streamCacheHit_);
+        if (ret < 0) {
+            char errbuf[128];
+            av_strerror(ret, errbuf, sizeof(errbuf));
+            std::cerr << "无法获取流信息: " << errbuf << std::endl;
+            return false;
+        }
+        
+        // 查找视频流
+        videoStreamIndex_ = -1;
+        for (unsigned int i = 0; i < formatCtx_->nb_streams; i++) {
+            if (formatCtx_->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+                videoStreamIndex_ = i;
+                break;
+            }
+        }
+        
+        if (videoStreamIndex_ == -1) {
+            std::cerr << "未找到视频流" << std::endl;
+            return false;
+        }
+        
+        return true;
+    }
+    
     void displayVideo() {
         AVPacket* packet = av_packet_alloc();
         AVFrame* frame = av_frame_alloc();
+        AVFrame* filtered = av_frame_alloc();
         AVFrame* frameRGB = av_frame_alloc();
         
-        int numBytes = av_image_get_buffer_size(AV_PIX_FMT_BGR24, codecCtx_->width, 
-                                                 codecCtx_->height, 1);
-        uint8_t* buffer = (uint8_t*)av_malloc(numBytes * sizeof(uint8_t));
+        // 输出尺寸固定为第一帧（经过滤镜之后）的尺寸；缓存的参数过期或流中途改分辨率时，
+        // 后面的帧会被缩放到这个尺寸，而不是重新分配缓冲区
+        int outWidth = 0;
+        int outHeight = 0;
+        uint8_t* buffer = nullptr;
         
-        av_image_fill_arrays(frameRGB->data, frameRGB->linesize, buffer, 
-                            AV_PIX_FMT_BGR24, codecCtx_->width, codecCtx_->height, 1);
+        // 颜色转换：同尺寸 yuv420p/nv12 走 SIMD 内核，其余格式回退到 swscale
+        std::cout << "颜色转换 SIMD: " << yuvSimdLevelName(yuvSimdLevel()) << std::endl;
+        if (filter_.enabled()) {
+            std::cout << "滤镜: " << filter_.config().graph << std::endl;
+        }
         
-        // 创建转换上下文
-        swsCtx_ = sws_getContext(codecCtx_->width, codecCtx_->height, codecCtx_->pix_fmt,
-                                 codecCtx_->width, codecCtx_->height, AV_PIX_FMT_BGR24,
-                                 SWS_BILINEAR, nullptr, nullptr, nullptr);
+        // 画面分析在独立的线程池里做，解码线程只把帧的引用放进有界队列，
+        // 分析跟不上时丢帧而不是等待
+        if (analyticsConfig_.enabled) {
+            analytics_ = new FrameAnalytics(analyticsConfig_,
+                                            new MotionDetector(analyticsConfig_.analysisWidth,
+                                                               analyticsConfig_.motionThreshold));
+            analytics_->setEventCallback([this](const AnalyticsEvent& event) {
+                motionActive_ = event.active;
+                std::cout << (event.active ? "检测到运动" : "运动结束") << ": 分析帧 #" << event.seq
+                          << " (" << event.ptsUs / 1000 << " ms), 变化 " << event.score * 100 << "%" << std::endl;
+            });
+            std::cout << "画面分析: 运动检测, " << analyticsConfig_.workers << " 个线程, 队列 "
+                      << analyticsConfig_.queueFrames << " 帧, 缩到 " << analyticsConfig_.analysisWidth
+                      << " 宽, 阈值 " << analyticsConfig_.motionThreshold * 100 << "%" << std::endl;
+        }
         
         std::cout << "开始接收视频流并显示" << std::endl;
         std::cout << "按 'q' 或 ESC 键退出，按 's' 键截图" << std::endl;
@@ -147,50 +205,149 @@ public:
         auto startTime = std::chrono::steady_clock::now();
         int screenshotCount = 0;
         
-        while (g_running && av_read_frame(formatCtx_, packet) >= 0) {
+        // 解码耗时只统计 send/receive 本身，用来对比不同线程策略的吞吐
+        DecodeRateMeter decodeRate;
+        AVStream* stream = formatCtx_->streams[videoStreamIndex_];
+        AVRational timeBase = stream->time_base;
+        double streamFps = stream->avg_frame_rate.num > 0 && stream->avg_frame_rate.den > 0
+                               ? av_q2d(stream->avg_frame_rate) : 0.0;
+        
+        // 转换、叠加信息、显示并处理按键，返回 false 表示要退出
+        auto present = [&](AVFrame* shown) -> bool {
+            if (analytics_) {
+                // 只增加一个引用，不复制像素，也不会阻塞
+                int64_t pts = shown->best_effort_timestamp;
+                analytics_->submit(shown, pts == AV_NOPTS_VALUE ? 0 : av_rescale_q(pts, timeBase, AV_TIME_BASE_Q));
+            }
+            
+            if (!buffer) {
+                outWidth = shown->width;
+                outHeight = shown->height;
+                int numBytes = av_image_get_buffer_size(AV_PIX_FMT_BGR24, outWidth, outHeight, 1);
+                buffer = (uint8_t*)av_malloc(numBytes * sizeof(uint8_t));
+                av_image_fill_arrays(frameRGB->data, frameRGB->linesize, buffer,
+                                     AV_PIX_FMT_BGR24, outWidth, outHeight, 1);
+            }
+            
+            // 转换为BGR格式
+            converter_.convert(shown, frameRGB->data[0], frameRGB->linesize[0],
+                               outWidth, outHeight, AV_PIX_FMT_BGR24);
+            
+            // 创建OpenCV Mat
+            cv::Mat img(outHeight, outWidth, CV_8UC3, 
+                       frameRGB->data[0], frameRGB->linesize[0]);
+            
+            // 添加信息叠加
+            auto currentTime = std::chrono::steady_clock::now();
+            double elapsed = std::chrono::duration<double>(currentTime - startTime).count();
+            double fps = frameCount_ / elapsed;
+            
+            std::string info = "FPS: " + std::to_string((int)fps) + 
+                             " | Frames: " + std::to_string(frameCount_);
+            FrameAnalytics::Stats as;
+            if (analytics_) {
+                as = analytics_->stats();
+                info += " | Analytics: " + std::to_string((int)(as.analyzed / elapsed)) + " fps, drop " +
+                        std::to_string(as.submitted > 0 ? (int)(100 * as.dropped / as.submitted) : 0) + "%";
+            }
+            cv::putText(img, info, cv::Point(10, 30), 
+                       cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(0, 255, 0), 2);
+            if (analytics_) {
+                char motion[64];
+                snprintf(motion, sizeof(motion), "Motion: %.1f%%%s", as.lastScore * 100,
+                         motionActive_ ? " DETECTED" : "");
+                cv::putText(img, motion, cv::Point(10, 60), cv::FONT_HERSHEY_SIMPLEX, 0.7,
+                            motionActive_ ? cv::Scalar(0, 0, 255) : cv::Scalar(0, 255, 0), 2);
+            }
+            
+            // 显示图像
+            cv::imshow(windowName_, img);
+            
+            // 处理键盘事件
+            int key = cv::waitKey(1);
+            if (key == 'q' || key == 27) { // 'q' 或 ESC
+                g_running = false;
+                return false;
+            } else if (key == 's') { // 截图
+                std::string filename = "screenshot_" + 
+                                     std::to_string(++screenshotCount) + ".jpg";
+                cv::imwrite(filename, img);
+                std::cout << "截图已保存: " << filename << std::endl;
+            }
+            
+            // 每25帧打印一次统计
+            if (frameCount_ % 25 == 0) {
+                std::cout << "已接收 " << frameCount_ << " 帧 | "
+                          << "实时帧率: " << fps << " fps | "
+                          << "解码 " << decodeRate.msPerFrame() << " ms/帧, 可达 "
+                          << (int)decodeRate.capacityFps() << " fps";
+                if (streamFps > 0) {
+                    std::cout << " (" << decodeRate.capacityFps() / streamFps << "x 码流帧率)";
+                }
+                std::cout << " | 线程延迟 +" << decoderThreadingLatencyFrames(codecCtx_) << " 帧";
+                if (filter_.enabled()) {
+                    VideoFilterStage::Stats fs = filter_.stats();
+                    std::cout << " | 滤镜 " << fs.msPerFrame << " ms/帧 (" << fs.threads << " 线程)";
+                }
+                if (analytics_) {
+                    std::cout << " | 分析 " << as.analyzed / elapsed << " fps, 丢弃 " << as.dropped << "/"
+                              << as.submitted << ", " << as.msPerFrame << " ms/帧, 运动 " << as.lastScore * 100 << "%";
+                }
+                std::cout << std::endl;
+            }
+            return true;
+        };
+        
+        while (g_running) {
+            interrupter_.beginRead();
+            int readResult = av_read_frame(formatCtx_, packet);
+            if (readResult < 0) {
+                if (!g_running) {
+                    break; // Ctrl+C 打断了读取
+                }
+                if (readResult == AVERROR(EAGAIN)) {
+                    av_usleep(10000);
+                    continue;
+                }
+                // 断流：重连，参数没变就继续用现有的解码器、转换器和缓冲区
+                if (!reconnect()) {
+                    break;
+                }
+                // 滤镜里缓存的帧属于断开前的流
+                filter_.reset();
+                timeBase = formatCtx_->streams[videoStreamIndex_]->time_base;
+                continue;
+            }
+            
             if (packet->stream_index == videoStreamIndex_) {
+                auto decodeStart = std::chrono::steady_clock::now();
                 if (avcodec_send_packet(codecCtx_, packet) == 0) {
-                    while (avcodec_receive_frame(codecCtx_, frame) == 0) {
+                    bool keepGoing = true;
+                    while (keepGoing && avcodec_receive_frame(codecCtx_, frame) == 0) {
                         frameCount_++;
+                        if (frameCount_ == 1) {
+                            checkFirstFrame(frame);
+                        }
+                        auto decodeEnd = std::chrono::steady_clock::now();
+                        decodeRate.add(std::chrono::duration_cast<std::chrono::microseconds>(
+                                           decodeEnd - decodeStart).count(), 1);
                         
-                        // 转换为BGR格式
-                        sws_scale(swsCtx_, frame->data, frame->linesize, 0, 
-                                 codecCtx_->height, frameRGB->data, frameRGB->linesize);
-                        
-                        // 创建OpenCV Mat
-                        cv::Mat img(codecCtx_->height, codecCtx_->width, CV_8UC3, 
-                                   frameRGB->data[0], frameRGB->linesize[0]);
-                        
-                        // 添加信息叠加
-                        auto currentTime = std::chrono::steady_clock::now();
-                        double elapsed = std::chrono::duration<double>(currentTime - startTime).count();
-                        double fps = frameCount_ / elapsed;
-                        
-                        std::string info = "FPS: " + std::to_string((int)fps) + 
-                                         " | Frames: " + std::to_string(frameCount_);
-                        cv::putText(img, info, cv::Point(10, 30), 
-                                   cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(0, 255, 0), 2);
-                        
-                        // 显示图像
-                        cv::imshow(windowName_, img);
-                        
-                        // 处理键盘事件
-                        int key = cv::waitKey(1);
-                        if (key == 'q' || key == 27) { // 'q' 或 ESC
+                        if (!filter_.enabled()) {
+                            keepGoing = present(frame);
+                        } else if (filter_.push(frame, timeBase) < 0) {
+                            std::cerr << "滤镜出错: " << filter_.lastError() << std::endl;
+                            keepGoing = false;
                             g_running = false;
-                            break;
-                        } else if (key == 's') { // 截图
-                            std::string filename = "screenshot_" + 
-                                                 std::to_string(++screenshotCount) + ".jpg";
-                            cv::imwrite(filename, img);
-                            std::cout << "截图已保存: " << filename << std::endl;
+                        } else {
+                            // 帧按引用进出滤镜图，不复制；去隔行 yadif=1 之类一帧可能出两帧
+                            while (keepGoing && filter_.pull(filtered)) {
+                                keepGoing = present(filtered);
+                                av_frame_unref(filtered);
+                            }
                         }
                         
-                        // 每25帧打印一次统计
-                        if (frameCount_ % 25 == 0) {
-                            std::cout << "已接收 " << frameCount_ << " 帧 | "
-                                      << "实时帧率: " << fps << " fps" << std::endl;
-                        }
+                        // 显示和按键等待不算进下一帧的解码耗时
+                        decodeStart = std::chrono::steady_clock::now();
                     }
                 }
             }
@@ -199,19 +356,93 @@ public:
         
         av_free(buffer);
         av_frame_free(&frameRGB);
+        av_frame_free(&filtered);
         av_frame_free(&frame);
         av_packet_free(&packet);
         
         cv::destroyAllWindows();
         
+        // 等分析线程处理完手上的帧再退出，剩下排队的帧直接丢弃
+        if (analytics_) {
+            FrameAnalytics::Stats as = analytics_->stats();
+            delete analytics_;
+            analytics_ = nullptr;
+            std::cout << "画面分析: 提交 " << as.submitted << " 帧, 分析 " << as.analyzed << " 帧, 丢弃 "
+                      << as.dropped << " 帧, " << as.msPerFrame << " ms/帧, 运动事件 " << as.events << " 次" << std::endl;
+        }
+        
         std::cout << "\n接收完成！总共接收 " << frameCount_ << " 帧" << std::endl;
+        if (filter_.enabled()) {
+            VideoFilterStage::Stats fs = filter_.stats();
+            std::cout << "滤镜图 " << fs.description << ": " << fs.msPerFrame << " ms/帧, 输入 "
+                      << fs.framesIn << " 帧, 输出 " << fs.framesOut << " 帧, 构建 " << fs.graphs << " 次" << std::endl;
+        }
+        const StreamReconnector::Stats& st = reconnector_.stats();
+        if (st.recoveries > 0) {
+            std::cout << "断流重连 " << st.recoveries << " 次，平均恢复耗时 "
+                      << st.totalRecoverMs / st.recoveries << " ms，最长 " << st.maxRecoverMs << " ms" << std::endl;
+        }
     }
     
 private:
-    void cleanup() {
-        if (swsCtx_) {
-            sws_freeContext(swsCtx_);
+    // 按指数退避（带抖动）重连。参数不变时只清空解码器里引用旧流的帧，
+    // 其余状态全部保留；参数变了（分辨率、编码格式）就无法继续显示
+    bool reconnect() {
+        reconnector_.streamLost();
+        std::cout << "\n流已断开，正在重连..." << std::endl;
+        
+        AVCodecParameters* oldParams = avcodec_parameters_alloc();
+        avcodec_parameters_copy(oldParams, formatCtx_->streams[videoStreamIndex_]->codecpar);
+        
+        bool recovered = false;
+        while (g_running) {
+            int delay = reconnector_.nextDelayMs();
+            for (int waited = 0; waited < delay && g_running; waited += 10) {
+                av_usleep(10000);
+            }
+            if (!g_running) break;
+            
+            avformat_close_input(&formatCtx_);
+            if (!openInput()) {
+                reconnector_.attemptFailed();
+                continue;
+            }
+            
+            if (!sameCodecParameters(oldParams, formatCtx_->streams[videoStreamIndex_]->codecpar)) {
+                std::cerr << "重连后视频参数已变化，请重新启动客户端" << std::endl;
+                break;
+            }
+            
+            avcodec_flush_buffers(codecCtx_);
+            int64_t ms = reconnector_.recovered();
+            std::cout << "重连成功，恢复耗时 " << ms << " ms (第 "
+                      << reconnector_.stats().attempts << " 次尝试)" << std::endl;
+            recovered = true;
+            break;
+        }
+        
+        avcodec_parameters_free(&oldParams);
+        return recovered;
+    }
+    
+    // 首帧耗时（从开始连接算起），并核对缓存的参数是否还和实际的流一致
+    void checkFirstFrame(const AVFrame* frame) {
+        long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                           std::chrono::steady_clock::now() - openStart_).count();
+        std::cout << "首帧耗时: " << ms << " ms ("
+                  << (streamCacheHit_ ? "参数缓存命中" : "完整探测") << ")" << std::endl;
+        
+        const AVCodecParameters* par = formatCtx_->streams[videoStreamIndex_]->codecpar;
+        if (streamCacheHit_ && (frame->width != par->width || frame->height != par->height ||
+                                frame->format != par->format)) {
+            std::cout << "流参数与缓存不一致，已清除缓存" << std::endl;
+            streamCache_.remove(url_);
         }
+    }
+    
+    void cleanup() {
+        delete analytics_;
+        analytics_ = nullptr;
         if (codecCtx_) {
             avcodec_free_context(&codecCtx_);
         }
@@ -222,29 +453,61 @@ private:
     
     std::string url_;
     std::string windowName_;
+    DecoderThreadingPolicy threading_;
+    DecoderSelection decoderSelection_;
     AVFormatContext* formatCtx_;
     AVCodecContext* codecCtx_;
     const AVCodec* codec_;
-    SwsContext* swsCtx_;
+    FrameConverter converter_;
+    VideoFilterStage filter_;
+    AnalyticsConfig analyticsConfig_;
+    FrameAnalytics* analytics_;
+    std::atomic<bool> motionActive_;   // 由分析线程的事件回调更新
     int videoStreamIndex_;
     int frameCount_;
+    StreamParamCache streamCache_;
+    bool streamCacheHit_;
+    std::chrono::steady_clock::time_point openStart_;
+    StreamReconnector reconnector_;
+    IoInterrupter interrupter_;
 };
 
 int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        std::cout << "用法: " << argv[0] << " <rtsp_url> [窗口标题]" << std::endl;
+    ClientOptions opts(argc, argv);
+    const std::vector<std::string>& args = opts.positional();
+    
+    if (args.empty()) {
+        std::cout << "用法: " << argv[0] << " <rtsp_url> [窗口标题] [选项]" << std::endl;
+        std::cout << "选项:" << std::endl;
+        std::cout << "  --decode-threading=auto|frame|slice|off  解码多线程方式" << std::endl;
+        std::cout << "  --decode-threads=N  解码线程数，0 表示按核数自动选择" << std::endl;
+        std::cout << "  --decoder-h264|hevc|av1|vp9=名称[,名称]  指定优先使用的解码器，如 --decoder-av1=libaom-av1" << std::endl;
+        std::cout << "  --open-timeout=ms  连接和探测超时 (默认 10000)" << std::endl;
+        std::cout << "  --read-timeout=ms  读取超时，超过后按断流重连 (默认 5000)" << std::endl;
+        std::cout << "  --vf=滤镜图  解码后、显示前的 libavfilter 处理，如 yadif,hqdn3d,scale=1280:-2" << std::endl;
+        std::cout << "  --filter-threads=N  滤镜切片线程数，0 表示按核数自动选择" << std::endl;
+        std::cout << "  --analytics  在独立线程池里做运动检测，不拖慢解码" << std::endl;
+        std::cout << "  --analytics-workers=N  分析线程数 (默认 2)" << std::endl;
+        std::cout << "  --analytics-queue=N  等待分析的最多帧数，超过就丢帧 (默认 4)" << std::endl;
+        std::cout << "  --analytics-width=px  分析前缩小到的宽度 (默认 160)" << std::endl;
+        std::cout << "  --motion-threshold=比例  画面变化超过这个比例算运动 (默认 0.02)" << std::endl;
         std::cout << "示例:" << std::endl;
         std::cout << "  " << argv[0] << " rtsp://localhost:8554/live" << std::endl;
         std::cout << "  " << argv[0] << " rtsp://192.168.100.2:8554/live \"无人机视频\"" << std::endl;
+        std::cout << "  " << argv[0] << " rtsp://localhost:8554/live --decode-threading=low-latency" << std::endl;
+        std::cout << "  " << argv[0] << " rtsp://localhost:8554/live --vf=yadif,crop=iw/2:ih/2" << std::endl;
+        std::cout << "  " << argv[0] << " rtsp://localhost:8554/live --analytics --analytics-workers=4" << std::endl;
         return -1;
     }
     
     signal(SIGINT, signalHandler);
     
-    std::string url = argv[1];
-    std::string windowName = argc > 2 ? argv[2] : "RTSP视频接收";
+    std::string url = args[0];
+    std::string windowName = args.size() > 1 ? args[1] : "RTSP视频接收";
     
-    RtspClientGUI client(url, windowName);
+    RtspClientGUI client(url, windowName, decoderThreadingFromOptions(opts), ioTimeoutsFromOptions(opts),
+                         videoFilterFromOptions(opts), analyticsFromOptions(opts),
+                         decoderSelectionFromOptions(opts));
     
     if (!client.init()) {
         std::cerr << "初始化失败" << std::endl;
@@ -253,5 +516,9 @@ int main(int argc, char* argv[]) {
     
     client.displayVideo();
     
+    if (g_stopRequestedUs > 0) {
+        std::cout << "停止耗时: " << (av_gettime_relative() - g_stopRequestedUs) / 1000 << " ms" << std::endl;
+    }
+    
     return 0;
 }
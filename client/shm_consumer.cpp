@@ -0,0 +1,105 @@
+// 共享内存帧的示例消费者：只依赖 frame_shm 库，不需要 FFmpeg。
+// 映射 rtsp_client export 模式或 Qt 客户端 --shm-export 发布的帧，
+// 原地计算亮度平均值，每秒打印一次处理的帧数、跳过的帧和读取冲突。
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <signal.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+
+#include "frameshm.h"
+
+static std::atomic<bool> g_running(true);
+
+void signalHandler(int) {
+    g_running = false;
+}
+
+// 平面 0 的亮度平均值，直接读共享内存，不拷贝
+static double meanLuma(const FrameShmFrame& frame) {
+    uint64_t sum = 0;
+    for (int y = 0; y < frame.height; y += 2) {
+        const uint8_t* row = frame.data[0] + static_cast<size_t>(y) * frame.linesize[0];
+        for (int x = 0; x < frame.width; x += 2) {
+            sum += row[x];
+        }
+    }
+    uint64_t samples = static_cast<uint64_t>((frame.width + 1) / 2) * ((frame.height + 1) / 2);
+    return samples ? static_cast<double>(sum) / samples : 0.0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cout << "用法: " << argv[0] << " <共享内存名> [处理耗时ms]" << std::endl;
+        std::cout << "\n示例:" << std::endl;
+        std::cout << "  " << argv[0] << " /rtsp_cam1" << std::endl;
+        std::cout << "    - 读取 rtsp_client ... export --shm-export=/rtsp_cam1 发布的帧" << std::endl;
+        std::cout << "  " << argv[0] << " /rtsp_cam1 50" << std::endl;
+        std::cout << "    - 模拟每帧 50ms 的分析，观察来不及处理时的丢帧" << std::endl;
+        return -1;
+    }
+
+    signal(SIGINT, signalHandler);
+    const std::string name = argv[1];
+    const int workMs = argc > 2 ? std::atoi(argv[2]) : 0;
+
+    FrameShmReader reader;
+    uint64_t lastSeq = 0;
+    long long frames = 0, skipped = 0, torn = 0;
+    double lastMean = 0;
+    auto reportAt = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+
+    while (g_running) {
+        if (!reader.isOpen()) {
+            std::string error;
+            if (!reader.open(name, &error)) {
+                std::cerr << "等待发布端: " << error << std::endl;
+                sleep(1);
+                continue;
+            }
+            std::cout << "已映射 " << name << " (" << reader.slotCount() << " 个槽)" << std::endl;
+            lastSeq = 0;
+        }
+
+        FrameShmReader::WaitResult result = reader.waitNewer(lastSeq, 500);
+        if (result == FrameShmReader::WAIT_CLOSED) {
+            std::cout << "发布端已关闭或重建了环形缓冲区，重新打开" << std::endl;
+            reader.close();
+            continue;
+        }
+
+        if (result == FrameShmReader::WAIT_FRAME) {
+            // 总是取最新的一帧：分析跟不上时跳过中间的帧，而不是越积越多
+            FrameShmFrame frame;
+            if (reader.latest(&frame)) {
+                if (lastSeq > 0 && frame.seq > lastSeq + 1) {
+                    skipped += static_cast<long long>(frame.seq - lastSeq - 1);
+                }
+                lastSeq = frame.seq;
+
+                double mean = meanLuma(frame);
+                if (workMs > 0) usleep(workMs * 1000);
+
+                // 读的过程中槽被发布端覆盖了，结果作废
+                if (reader.stillValid(frame)) {
+                    lastMean = mean;
+                    frames++;
+                } else {
+                    torn++;
+                }
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now >= reportAt) {
+            std::cout << "帧 " << frames << "  跳过 " << skipped << "  冲突 " << torn
+                      << "  最新帧 #" << lastSeq << "  亮度 " << std::fixed << std::setprecision(1) << lastMean
+                      << std::endl;
+            reportAt = now + std::chrono::seconds(1);
+        }
+    }
+    return 0;
+}